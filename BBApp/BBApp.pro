@@ -14,6 +14,9 @@ TEMPLATE = app
 SOURCES += src/main.cpp \
     src/mainwindow.cpp \
     src/lib/bb_lib.cpp \
+    src/lib/peak_index.cpp \
+    src/lib/decimation_plan.cpp \
+    src/lib/simd_kernels.cpp \
     src/lib/amplitude.cpp \
     src/lib/frequency.cpp \
     src/widgets/entry_widgets.cpp \
@@ -24,15 +27,23 @@ SOURCES += src/main.cpp \
     src/model/session.cpp \
     src/views/sweep_central.cpp \
     src/views/trace_view.cpp \
+    src/views/software_renderer.cpp \
+    src/views/waterfall_ring.cpp \
     src/model/trace.cpp \
     src/model/marker.cpp \
     src/model/device_bb60a.cpp \
     src/model/trace_manager.cpp \
     src/widgets/measure_panel.cpp \
+    src/model/channel_power.cpp \
+    src/model/occupancy.cpp \
+    src/model/spectrogram_store.cpp \
+    src/model/trace_math.cpp \
+    src/model/peak_table.cpp \
     src/model/persistence.cpp \
     src/model/audio_settings.cpp \
     src/lib/time_type.cpp \
     src/model/playback_toolbar.cpp \
+    src/model/playback_reader.cpp \
     src/widgets/audio_dialog.cpp \
     src/widgets/status_bar.cpp \
     src/model/device.cpp \
@@ -47,6 +58,10 @@ SOURCES += src/main.cpp \
     src/views/demod_sweep_plot.cpp \
     src/widgets/measuring_receiver_dialog.cpp \
     src/model/device_sa.cpp \
+    src/model/device_sim.cpp \
+    src/model/device_telemetry.cpp \
+    src/model/realtime_colorizer.cpp \
+    src/model/device_group.cpp \
     src/lib/device_traits.cpp \
     src/views/harmonics_central.cpp \
     src/views/gl_sub_view.cpp \
@@ -74,6 +89,8 @@ HEADERS += src/mainwindow.h \
     src/model/session.h \
     src/views/sweep_central.h \
     src/views/trace_view.h \
+    src/views/software_renderer.h \
+    src/views/waterfall_ring.h \
     src/model/trace.h \
     src/model/marker.h \
     src/model/device.h \
@@ -82,13 +99,25 @@ HEADERS += src/mainwindow.h \
     src/lib/bb_api.h \
     src/model/trace_manager.h \
     src/widgets/measure_panel.h \
+    src/model/channel_power.h \
+    src/model/occupancy.h \
+    src/model/spectrogram_store.h \
+    src/model/trace_math.h \
+    src/model/peak_table.h \
     src/model/persistence.h \
     src/model/audio_settings.h \
     src/views/idle_view.h \
     src/views/persistence_view.h \
     src/model/color_prefs.h \
     src/model/playback_toolbar.h \
-    src/lib/threadsafe_queue.h \
+    src/model/playback_reader.h \
+    src/lib/peak_index.h \
+    src/lib/decimation_plan.h \
+    src/lib/triple_buffer.h \
+    src/lib/spsc_ring.h \
+    src/lib/simd_kernels.h \
+    src/model/trace_pool.h \
+    src/model/device_config.h \
     src/model/preferences.h \
     src/widgets/audio_dialog.h \
     src/widgets/status_bar.h \
@@ -107,6 +136,10 @@ HEADERS += src/mainwindow.h \
     src/views/demod_sweep_plot.h \
     src/widgets/measuring_receiver_dialog.h \
     src/model/device_sa.h \
+    src/model/device_sim.h \
+    src/model/device_telemetry.h \
+    src/model/realtime_colorizer.h \
+    src/model/device_group.h \
     src/lib/sa_api.h \
     src/lib/device_traits.h \
     src/views/harmonics_central.h \
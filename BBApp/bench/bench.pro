@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Micro-benchmarks for the trace processing kernels
+# Console application, independent of the main project
+#
+#-------------------------------------------------
+
+QT -= gui
+
+TARGET = bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += trace_update_bench.cpp \
+    ../src/lib/simd_kernels.cpp
+
+HEADERS += ../src/lib/simd_kernels.h
+
+INCLUDEPATH += ../src
@@ -0,0 +1,143 @@
+// Compares the cached DecimationPlan at each SIMD level against the
+//   per sweep loop normalize_trace used before, reducing sweeps of up
+//   to a few million bins onto a 2000 pixel graticule
+//
+// decimation_bench [iterations]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <functional>
+
+#include "lib/decimation_plan.h"
+#include "lib/simd_kernels.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Reference loop, as in the original normalize_trace
+static void refNormalize(const float *sweepMin, const float *sweepMax, int length,
+                         std::vector<float> &v, int width, double ref, double botRef)
+{
+    v.clear();
+
+    int currentPix = 0;
+    double currentStep = 0.0;
+    double step = (float)(width) / (length - 1);
+    double xScale = 1.0 / (double)width;
+    double yScale = 1.0 / (ref - botRef);
+
+    v.reserve(width * 4);
+
+    if(length < width) {
+        for(int i = 0; i < length; i++) {
+            v.push_back(xScale * currentStep);
+            v.push_back(yScale * (sweepMax[i] - botRef));
+            v.push_back(xScale * currentStep);
+            v.push_back(yScale * (sweepMin[i] - botRef));
+            currentStep += step;
+        }
+        return;
+    }
+
+    float min = ref;
+    float max = botRef;
+
+    for(int i = 0; i < length; i++) {
+        double minVal = sweepMin[i];
+        double maxVal = sweepMax[i];
+
+        if(maxVal > max) max = maxVal;
+        if(minVal < min) min = minVal;
+
+        currentStep += step;
+
+        if(currentStep > currentPix) {
+            v.push_back(xScale * currentPix);
+            v.push_back(yScale * (min - botRef));
+            v.push_back(xScale * currentPix);
+            v.push_back(yScale * (max - botRef));
+
+            min = ref;
+            max = botRef;
+            currentPix++;
+        }
+    }
+}
+
+// Best of n runs, in microseconds per sweep
+static double timeIt(std::function<void()> fn, int iterations)
+{
+    double best = 1.0e30;
+    for(int i = 0; i < iterations; i++) {
+        Clock::time_point t0 = Clock::now();
+        fn();
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        if(us < best) best = us;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+    if(iterations < 1) iterations = 1;
+
+    const int width = 2000;
+    const double ref = -20.0, botRef = -120.0;
+    const int lengths[] = { 1000, 32768, 1048576, 4194304 };
+    const SimdLevel levels[] = { SimdScalar, SimdSSE2, SimdAVX2 };
+
+    printf("Widest supported level: %s\n", simdLevelString(simdMaxLevel()));
+    printf("us/sweep onto %d pixels, best of %d\n\n", width, iterations);
+    printf("%10s %10s %10s", "bins", "reference", "build");
+    for(SimdLevel lvl : levels) {
+        if(lvl <= simdMaxLevel()) printf(" %10s", simdLevelString(lvl));
+    }
+    printf("\n");
+
+    int failures = 0;
+
+    for(int len : lengths) {
+        std::vector<float> sweepMin(len), sweepMax(len);
+        for(int i = 0; i < len; i++) {
+            sweepMax[i] = -110.0f + 80.0f * (rand() / (float)RAND_MAX);
+            sweepMin[i] = sweepMax[i] - 3.0f;
+        }
+        const float *sMin = &sweepMin[0], *sMax = &sweepMax[0];
+        std::vector<float> expected, out;
+
+        printf("%10d %10.1f", len, timeIt([&]{
+            refNormalize(sMin, sMax, len, expected, width, ref, botRef);
+        }, iterations));
+
+        // Building the plan, paid once per change of sweep or view
+        printf(" %10.1f", timeIt([&]{
+            DecimationPlan plan;
+            plan.Prepare(len, width, ref, botRef);
+        }, iterations));
+
+        DecimationPlan plan;
+        plan.Prepare(len, width, ref, botRef);
+        for(SimdLevel lvl : levels) {
+            if(lvl > simdMaxLevel()) continue;
+            simdSetLevel(lvl);
+            printf(" %10.1f", timeIt([&]{ plan.Apply(sMin, sMax, out); }, iterations));
+
+            // Same points as the reference, to float rounding
+            if(out.size() != expected.size()) {
+                failures++;
+                continue;
+            }
+            for(size_t i = 0; i < out.size(); i++) {
+                if(fabs(out[i] - expected[i]) > 1.0e-6f) failures++;
+            }
+        }
+        printf("\n");
+    }
+
+    printf("\n%s\n", failures ? "MISMATCH" : "All levels match the reference");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Benchmark of the normalize_trace() decimation plan
+# Console application, independent of the main project
+#
+#-------------------------------------------------
+
+QT -= gui
+
+TARGET = decimation_bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += decimation_bench.cpp \
+    ../src/lib/decimation_plan.cpp \
+    ../src/lib/simd_kernels.cpp
+
+HEADERS += ../src/lib/decimation_plan.h \
+    ../src/lib/simd_kernels.h
+
+INCLUDEPATH += ../src
@@ -0,0 +1,149 @@
+// Drives the simulated device through injected disconnects, mid sweep
+//   and mid I/Q stream, and checks Device::Recover() brings it back
+//   without emitting connectionIssues(), which is only expected when
+//   recovery really fails and not when the user stops it
+//
+// recovery_check
+//   Exits non-zero on the first failed check
+
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <QCoreApplication>
+#include <QSettings>
+#include <QTemporaryDir>
+
+#include "model/device_sim.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+    if(!ok) failures++;
+}
+
+// Connected for interval seconds at a time, unplugged for duration
+static void configure(double interval, double duration)
+{
+    SimConfig config;
+    config.disconnectInterval = interval;
+    config.disconnectDuration = duration;
+    config.Save();
+}
+
+static void sweepCase()
+{
+    configure(0.2, 0.5);
+    DeviceSim device(nullptr);
+    int issues = 0;
+    QObject::connect(&device, &Device::connectionIssues, [&]() { issues++; });
+
+    SweepSettings settings;
+    Trace trace;
+    device.OpenDevice();
+    device.SetAutoRecover(true);
+    device.Reconfigure(&settings, &trace);
+
+    int sweeps = 0;
+    while(device.GetSweep(&settings, &trace)) {
+        sweeps++;
+    }
+    check(device.ConnectionLost(), "sweep: disconnect injected mid sweep");
+
+    std::atomic<bool> keepTrying(true);
+    check(device.Recover(keepTrying), "sweep: Recover() reopens and replays");
+    check(device.GetSweep(&settings, &trace), "sweep: sweeping resumes");
+    check(device.GetRecoveryStats().outages == 1, "sweep: one outage counted");
+    check(issues == 0, "sweep: no connectionIssues()");
+}
+
+static void streamCase()
+{
+    configure(0.2, 0.5);
+    DeviceSim device(nullptr);
+    int issues = 0;
+    QObject::connect(&device, &Device::connectionIssues, [&]() { issues++; });
+
+    DemodSettings settings;
+    IQDescriptor desc;
+    IQCapture capture;
+    device.OpenDevice();
+    device.SetAutoRecover(true);
+    device.Reconfigure(&settings, &desc);
+
+    while(device.GetIQ(&capture)) {}
+    check(device.ConnectionLost(), "stream: disconnect injected mid stream");
+
+    std::atomic<bool> keepTrying(true);
+    check(device.Recover(keepTrying), "stream: Recover() reopens and replays");
+    check(device.GetIQ(&capture), "stream: streaming resumes");
+    check(device.GetRecoveryStats().outages == 1, "stream: one outage counted");
+    check(issues == 0, "stream: no connectionIssues()");
+}
+
+// Unplugged far longer than the test, the user gives up waiting
+static void userStopCase()
+{
+    configure(0.2, 30.0);
+    DeviceSim device(nullptr);
+    int issues = 0;
+    QObject::connect(&device, &Device::connectionIssues, [&]() { issues++; });
+
+    SweepSettings settings;
+    Trace trace;
+    device.OpenDevice();
+    device.SetAutoRecover(true);
+    device.Reconfigure(&settings, &trace);
+    while(device.GetSweep(&settings, &trace)) {}
+
+    std::atomic<bool> keepTrying(true);
+    std::thread stopper([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        keepTrying = false;
+    });
+    bool recovered = device.Recover(keepTrying);
+    stopper.join();
+
+    check(!recovered, "stop: Recover() returns once stopped");
+    check(issues == 0, "stop: no connectionIssues()");
+    check(device.GetRecoveryStats().failures == 0, "stop: not counted as a failure");
+    check(device.GetRecoveryState() == RecoveryIdle, "stop: recovery left idle");
+}
+
+// Nothing was ever configured, there is nothing to replay
+static void failureCase()
+{
+    configure(0.0, 0.0);
+    DeviceSim device(nullptr);
+    int issues = 0;
+    QObject::connect(&device, &Device::connectionIssues, [&]() { issues++; });
+
+    device.OpenDevice();
+    device.SetAutoRecover(true);
+
+    std::atomic<bool> keepTrying(true);
+    check(!device.Recover(keepTrying), "failure: Recover() fails");
+    check(issues == 1, "failure: connectionIssues() emitted once");
+    check(device.GetRecoveryStats().failures == 1, "failure: counted as a failure");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Keep the injected configuration out of the user's SimDevice.ini
+    QTemporaryDir settingsDir;
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, settingsDir.path());
+
+    sweepCase();
+    streamCase();
+    userStopCase();
+    failureCase();
+
+    printf("\n%s\n", failures ? "FAILED" : "All recovery checks passed");
+
+    return failures ? 1 : 0;
+}
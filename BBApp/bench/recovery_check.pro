@@ -0,0 +1,15 @@
+#-------------------------------------------------
+#
+# Connection-loss recovery checks against the simulated device
+# Console application, independent of the main project
+#
+#-------------------------------------------------
+
+TARGET = recovery_check
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += recovery_check.cpp
+
+include(sim_device.pri)
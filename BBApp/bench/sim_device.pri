@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# The model sources behind the simulated device, for console
+#   programs which drive it without the Signal Hound APIs
+#
+#-------------------------------------------------
+
+QT += gui widgets opengl
+
+DEFINES += NO_DEVICE_API
+
+SOURCES += $$PWD/../src/model/device.cpp \
+    $$PWD/../src/model/device_sim.cpp \
+    $$PWD/../src/model/device_telemetry.cpp \
+    $$PWD/../src/model/sweep_settings.cpp \
+    $$PWD/../src/model/demod_settings.cpp \
+    $$PWD/../src/model/audio_settings.cpp \
+    $$PWD/../src/model/trace.cpp \
+    $$PWD/../src/model/marker.cpp \
+    $$PWD/../src/model/trace_math.cpp \
+    $$PWD/../src/lib/bb_lib.cpp \
+    $$PWD/../src/lib/peak_index.cpp \
+    $$PWD/../src/lib/decimation_plan.cpp \
+    $$PWD/../src/lib/simd_kernels.cpp \
+    $$PWD/../src/lib/amplitude.cpp \
+    $$PWD/../src/lib/frequency.cpp \
+    $$PWD/../src/lib/time_type.cpp \
+    $$PWD/../src/lib/device_traits.cpp \
+    $$PWD/../src/kiss_fft/kiss_fft.c
+
+HEADERS += $$PWD/../src/model/device.h \
+    $$PWD/../src/model/device_sim.h \
+    $$PWD/../src/model/device_telemetry.h \
+    $$PWD/../src/model/sweep_settings.h \
+    $$PWD/../src/model/demod_settings.h \
+    $$PWD/../src/model/audio_settings.h \
+    $$PWD/../src/model/trace.h
+
+INCLUDEPATH += $$PWD/../src
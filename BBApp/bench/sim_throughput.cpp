@@ -0,0 +1,104 @@
+// Headless sweep throughput of the simulated device, unpaced, for
+//   spans from a narrow sweep up to the full range, alone and with a
+//   max hold trace updated from every sweep
+// Runs without a display or the Signal Hound APIs, see sim_device.pri
+//
+// sim_throughput [seconds per case]
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QTemporaryDir>
+
+#include "model/device_sim.h"
+
+struct SweepCase {
+    double start, stop, rbw; // Hz
+};
+
+// Sweeps per second over seconds of sweeping, hold is updated from
+//   every sweep when given
+static double sweepRate(DeviceSim &device, const SweepSettings &settings,
+                        Trace &sweep, Trace *hold, double seconds)
+{
+    qint64 sweeps = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while(timer.elapsed() < seconds * 1000.0) {
+        if(!device.GetSweep(&settings, &sweep)) {
+            return 0.0;
+        }
+        if(hold) {
+            hold->Update(sweep);
+        }
+        sweeps++;
+    }
+    return sweeps / (timer.nsecsElapsed() * 1.0e-9);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    if(seconds <= 0.0) seconds = 2.0;
+
+    // Unpaced, the defaults otherwise, kept out of the user's
+    //   SimDevice.ini
+    QTemporaryDir settingsDir;
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, settingsDir.path());
+    SimConfig config;
+    config.sweepRate = 0.0;
+    config.scanRate = 0.0;
+    config.speedFactor = 0.0;
+    config.disconnectInterval = 0.0;
+    config.Save();
+
+    DeviceSim device(nullptr);
+    if(!device.OpenDevice()) {
+        printf("Unable to open the simulated device: %s\n", device.GetLastStatusString());
+        return 1;
+    }
+
+    const SweepCase cases[] = {
+        { 990.0e6, 1010.0e6, 30.0e3 },
+        { 900.0e6, 1100.0e6, 10.0e3 },
+        { 500.0e6, 1500.0e6, 3.0e3 },
+        { 9.0e3, 6.0e9, 10.0e3 }
+    };
+
+    printf("sweeps/s, unpaced, %.1f s per case\n\n", seconds);
+    printf("%12s %12s %10s %12s %12s\n", "span (MHz)", "RBW (kHz)", "bins", "device", "max hold");
+
+    int failures = 0;
+    for(const SweepCase &c : cases) {
+        SweepSettings settings;
+        settings.setStart(c.start);
+        settings.setStop(c.stop);
+        settings.setNativeRBW(false);
+        settings.setRBW(c.rbw);
+
+        Trace sweep;
+        if(!device.Reconfigure(&settings, &sweep)) {
+            failures++;
+            continue;
+        }
+        Trace hold(true);
+        hold.SetType(MAX_HOLD);
+
+        double plain = sweepRate(device, settings, sweep, nullptr, seconds);
+        double held = sweepRate(device, settings, sweep, &hold, seconds);
+        if(plain <= 0.0 || held <= 0.0) failures++;
+
+        printf("%12.3f %12.3f %10d %12.1f %12.1f\n",
+               settings.Span().Val() * 1.0e-6, settings.RBW().Val() * 1.0e-3,
+               sweep.Length(), plain, held);
+    }
+
+    device.CloseDevice();
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+#-------------------------------------------------
+#
+# Headless sweep throughput of the simulated device
+# Console application, independent of the main project,
+#   builds without the bb_api/sa_api libraries
+#
+#-------------------------------------------------
+
+TARGET = sim_throughput
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += sim_throughput.cpp
+
+include(sim_device.pri)
@@ -0,0 +1,186 @@
+// Compares a persistence frame drawn by the SoftwareRenderer, on one
+//   thread and on its band pool, against the framebuffer object path
+//   TraceView uses with OpenGL 3, one sweep added and the map drawn
+//   per frame
+//
+// software_render_bench [frames]
+//   Run with -platform offscreen where there is no display
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <functional>
+
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_2_1>
+
+#include "model/persistence.h"
+#include "views/software_renderer.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Sweep normalized to the graticule as normalize_trace() leaves it,
+//   x, max, x, min per point, a noise floor and a drifting peak
+static void makeSweep(GLVector &v, int points, int frame)
+{
+    v.resize(points * 4);
+    float peak = (frame % points) / (float)points;
+    for(int i = 0; i < points; i++) {
+        float x = i / (float)(points - 1);
+        float floor = 0.2f + 0.05f * (rand() / (float)RAND_MAX);
+        float d = (x - peak) * 40.0f;
+        float hi = floor + 0.6f / (1.0f + d * d);
+        v[i*4 + 0] = x;
+        v[i*4 + 1] = hi;
+        v[i*4 + 2] = x;
+        v[i*4 + 3] = hi - 0.02f;
+    }
+}
+
+// Average milliseconds per frame
+static double timeFrames(std::function<void(int)> fn, int frames)
+{
+    Clock::time_point t0 = Clock::now();
+    for(int i = 0; i < frames; i++) {
+        fn(i);
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / frames;
+}
+
+// The AddToPersistence()/DrawPersistence() pair of TraceView against
+//   an offscreen framebuffer, finished each frame so the GPU time counts
+class GLPersistence {
+public:
+    GLPersistence() : fbo(nullptr), view(nullptr) {}
+    ~GLPersistence()
+    {
+        if(context.isValid()) context.makeCurrent(&surface);
+        delete fbo;
+        delete view;
+    }
+
+    bool Init(int res, int viewW, int viewH)
+    {
+        QSurfaceFormat fmt;
+        fmt.setVersion(2, 1);
+        context.setFormat(fmt);
+        surface.setFormat(fmt);
+        surface.create();
+        if(!context.create() || !context.makeCurrent(&surface)) return false;
+        if(!gl.initializeOpenGLFunctions()) return false;
+
+        fbo = new QOpenGLFramebufferObject(res, res, QOpenGLFramebufferObject::Depth);
+        view = new QOpenGLFramebufferObject(viewW, viewH);
+        size = res;
+        return fbo->isValid() && view->isValid();
+    }
+
+    void Frame(const GLVector &v)
+    {
+        fbo->bind();
+        gl.glViewport(0, 0, size, size);
+        gl.glMatrixMode(GL_PROJECTION);
+        gl.glLoadIdentity();
+        gl.glOrtho(0, 1, 0, 1, -1, 1);
+        gl.glMatrixMode(GL_MODELVIEW);
+        gl.glLoadIdentity();
+
+        gl.glEnable(GL_BLEND);
+        gl.glBlendEquation(GL_FUNC_ADD);
+        gl.glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+        gl.glColor4f(0.0, 0.0, 0.0, 0.02);
+        gl.glBegin(GL_QUADS);
+        gl.glVertex2f(0,0); gl.glVertex2f(0,1);
+        gl.glVertex2f(1,1); gl.glVertex2f(1,0);
+        gl.glEnd();
+
+        gl.glBlendFunc(GL_ONE, GL_ONE);
+        gl.glColor3f(0.04, 0.04, 0.04);
+        gl.glEnableClientState(GL_VERTEX_ARRAY);
+        gl.glVertexPointer(2, GL_FLOAT, 0, &v[0]);
+        gl.glDrawArrays(GL_QUAD_STRIP, 0, v.size() / 2);
+        gl.glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        gl.glDrawArrays(GL_QUAD_STRIP, 0, v.size() / 2);
+        gl.glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        gl.glDisableClientState(GL_VERTEX_ARRAY);
+
+        // Draw the map over the view
+        view->bind();
+        gl.glViewport(0, 0, view->width(), view->height());
+        gl.glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        gl.glEnable(GL_TEXTURE_2D);
+        gl.glBindTexture(GL_TEXTURE_2D, fbo->texture());
+        gl.glColor4f(1.0, 1.0, 1.0, 1.0);
+        gl.glBegin(GL_QUADS);
+        gl.glTexCoord2f(0,0); gl.glVertex2f(0,0);
+        gl.glTexCoord2f(0,1); gl.glVertex2f(0,1);
+        gl.glTexCoord2f(1,1); gl.glVertex2f(1,1);
+        gl.glTexCoord2f(1,0); gl.glVertex2f(1,0);
+        gl.glEnd();
+        gl.glBindTexture(GL_TEXTURE_2D, 0);
+        gl.glDisable(GL_TEXTURE_2D);
+        gl.glDisable(GL_BLEND);
+        view->release();
+
+        gl.glFinish();
+    }
+
+private:
+    QOpenGLContext context;
+    QOffscreenSurface surface;
+    QOpenGLFunctions_2_1 gl;
+    QOpenGLFramebufferObject *fbo, *view;
+    int size;
+};
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    int frames = (argc > 1) ? atoi(argv[argc - 1]) : 200;
+    if(frames < 1) frames = 200;
+
+    const int viewW = 1600, viewH = 800;
+    const int points = 2000;
+    const int resolutions[] = { 256, 512, 1024, PERSIST_MAX_DIM };
+
+    printf("ms/frame, %d point sweeps, average of %d frames\n\n", points, frames);
+    printf("%10s %10s %10s %10s\n", "map", "1 thread", "pool", "OpenGL");
+
+    GLVector v;
+    for(int res : resolutions) {
+        printf("%10d", res);
+
+        for(int threads : { 1, 0 }) {
+            Persistence persistence;
+            persistence.SetResolution(res, res);
+            SoftwareRenderer renderer;
+            renderer.SetThreadCount(threads);
+            QImage image(res, res, QImage::Format_RGBA8888);
+
+            printf(" %10.3f", timeFrames([&](int frame) {
+                makeSweep(v, points, frame);
+                persistence.Accumulate(v);
+                renderer.RenderPersistence(&persistence, image);
+            }, frames));
+        }
+
+        GLPersistence glPersist;
+        if(glPersist.Init(res, viewW, viewH)) {
+            printf(" %10.3f", timeFrames([&](int frame) {
+                makeSweep(v, points, frame);
+                glPersist.Frame(v);
+            }, frames));
+        } else {
+            printf(" %10s", "n/a");
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
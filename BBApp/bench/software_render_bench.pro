@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Benchmark of the software persistence renderer against
+#   the OpenGL framebuffer object path
+# Console application, independent of the main project
+#
+#-------------------------------------------------
+
+QT += gui opengl
+
+TARGET = software_render_bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += software_render_bench.cpp \
+    ../src/model/persistence.cpp \
+    ../src/views/software_renderer.cpp \
+    ../src/lib/simd_kernels.cpp
+
+HEADERS += ../src/model/persistence.h \
+    ../src/views/software_renderer.h \
+    ../src/lib/simd_kernels.h
+
+INCLUDEPATH += ../src
@@ -0,0 +1,140 @@
+// Compares the trace update kernels at each SIMD level against the
+//   plain loops Trace::Update used before, over sweep lengths from a
+//   wide RBW sweep up to a narrow RBW sweep of a few million points
+//
+// bench [iterations]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <functional>
+
+#include "lib/simd_kernels.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Reference loops, as in the original Trace::Update
+static void refMaxHold(const float *src, float *mx, float *mn, int len)
+{
+    for(int i = 0; i < len; i++) {
+        mx[i] = mn[i] = (mx[i] > src[i]) ? mx[i] : src[i];
+    }
+}
+
+static void refMinAndMax(const float *srcMin, const float *srcMax,
+                         float *mn, float *mx, int len)
+{
+    for(int i = 0; i < len; i++) {
+        mn[i] = (mn[i] < srcMin[i]) ? mn[i] : srcMin[i];
+        mx[i] = (mx[i] > srcMax[i]) ? mx[i] : srcMax[i];
+    }
+}
+
+static void refAverage(const float *srcMin, const float *srcMax,
+                       float *mn, float *mx, float add, int len)
+{
+    float remove = 1.0f - add;
+    for(int i = 0; i < len; i++) {
+        mn[i] = mn[i] * remove + srcMin[i] * add;
+        mx[i] = mx[i] * remove + srcMax[i] * add;
+    }
+}
+
+// Best of n runs, in nanoseconds per bin
+static double timeIt(std::function<void()> fn, int len, int iterations)
+{
+    double best = 1.0e30;
+    for(int i = 0; i < iterations; i++) {
+        Clock::time_point t0 = Clock::now();
+        fn();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        if(ns < best) best = ns;
+    }
+    return best / len;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+    if(iterations < 1) iterations = 1;
+
+    const int lengths[] = { 8192, 131072, 1048576, 4194304 };
+    const SimdLevel levels[] = { SimdScalar, SimdSSE2, SimdAVX2 };
+
+    printf("Widest supported level: %s\n", simdLevelString(simdMaxLevel()));
+    printf("ns/bin, best of %d\n\n", iterations);
+    printf("%10s %-12s %10s", "bins", "mode", "reference");
+    for(SimdLevel lvl : levels) {
+        if(lvl <= simdMaxLevel()) printf(" %10s", simdLevelString(lvl));
+    }
+    printf("\n");
+
+    for(int len : lengths) {
+        std::vector<float> srcMin(len), srcMax(len), mn(len), mx(len);
+        for(int i = 0; i < len; i++) {
+            srcMax[i] = -100.0f + 40.0f * (rand() / (float)RAND_MAX);
+            srcMin[i] = srcMax[i] - 3.0f;
+            mn[i] = mx[i] = -90.0f;
+        }
+        const float *sMin = &srcMin[0], *sMax = &srcMax[0];
+        float *dMin = &mn[0], *dMax = &mx[0];
+
+        struct Mode {
+            const char *name;
+            std::function<void()> reference, kernel;
+        } modes[] = {
+            { "max hold",
+              [=]{ refMaxHold(sMax, dMax, dMin, len); },
+              [=]{ simdMax_32f(dMax, sMax, dMax, len);
+                   memcpy(dMin, dMax, len * sizeof(float)); } },
+            { "min/max",
+              [=]{ refMinAndMax(sMin, sMax, dMin, dMax, len); },
+              [=]{ simdMin_32f(dMin, sMin, dMin, len);
+                   simdMax_32f(dMax, sMax, dMax, len); } },
+            { "average",
+              [=]{ refAverage(sMin, sMax, dMin, dMax, 0.1f, len); },
+              [=]{ simdBlend_32f(sMin, dMin, 0.1f, len);
+                   simdBlend_32f(sMax, dMax, 0.1f, len); } }
+        };
+
+        for(Mode &m : modes) {
+            printf("%10d %-12s %10.3f", len, m.name, timeIt(m.reference, len, iterations));
+            for(SimdLevel lvl : levels) {
+                if(lvl > simdMaxLevel()) continue;
+                simdSetLevel(lvl);
+                printf(" %10.3f", timeIt(m.kernel, len, iterations));
+            }
+            printf("\n");
+        }
+    }
+
+    // Results must match the reference to rounding
+    int len = 1003;
+    std::vector<float> a(len), b(len), ref(len), unused(len), out(len);
+    for(int i = 0; i < len; i++) {
+        a[i] = -100.0f + 50.0f * (rand() / (float)RAND_MAX);
+        b[i] = -100.0f + 50.0f * (rand() / (float)RAND_MAX);
+    }
+    int failures = 0;
+    for(SimdLevel lvl : levels) {
+        if(lvl > simdMaxLevel()) continue;
+        simdSetLevel(lvl);
+        ref = a;
+        refAverage(&b[0], &b[0], &ref[0], &unused[0], 0.25f, len);
+        out = a;
+        simdBlend_32f(&b[0], &out[0], 0.25f, len);
+        for(int i = 0; i < len; i++) {
+            if(fabs(ref[i] - out[i]) > 1.0e-4f) failures++;
+        }
+        simdMax_32f(&a[0], &b[0], &out[0], len);
+        for(int i = 0; i < len; i++) {
+            if(out[i] != ((a[i] > b[i]) ? a[i] : b[i])) failures++;
+        }
+    }
+    printf("\n%s\n", failures ? "MISMATCH" : "All levels match the reference");
+
+    return failures ? 1 : 0;
+}
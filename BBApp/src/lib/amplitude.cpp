@@ -1,4 +1,8 @@
 #include "amplitude.h"
+#include "simd_kernels.h"
+
+#include <atomic>
+#include <cfloat>
 #include <cmath>
 
 // Index of unit must match enum value
@@ -33,3 +37,83 @@ double unit_convert(double in, AmpUnits unit_in, AmpUnits unit_out)
 {
     return cvt_table[int(unit_in)][int(unit_out)](in);
 }
+
+namespace {
+
+std::atomic<int> convertMode(AmpConvertFast);
+
+// Log offset of each unit from dBm
+const float DB_OFFSET[UNIT_COUNT] = { 0.0f, 46.9897f, 106.9897f, 0.0f };
+
+} // namespace
+
+void SetAmpConvertMode(AmpConvertMode mode)
+{
+    convertMode = mode;
+}
+
+AmpConvertMode GetAmpConvertMode()
+{
+    return (AmpConvertMode)convertMode.load();
+}
+
+void DBtoLinear_32f(const float *src, float *dst, int len, float scale, float offset)
+{
+    if(convertMode == AmpConvertFast) {
+        simdPow10_32f(src, dst, scale, offset, len);
+        return;
+    }
+
+    for(int i = 0; i < len; i++) {
+        dst[i] = (float)pow(10.0, (double)src[i] * scale + offset);
+    }
+}
+
+void LinearToDB_32f(const float *src, float *dst, int len, float scale, float offset)
+{
+    if(convertMode == AmpConvertFast) {
+        simdLog10_32f(src, dst, scale, offset, len);
+        return;
+    }
+
+    for(int i = 0; i < len; i++) {
+        double lin = (src[i] > FLT_MIN) ? src[i] : FLT_MIN;
+        dst[i] = (float)(scale * log10(lin) + offset);
+    }
+}
+
+void TraceToPower_32f(const float *src, float *dst, int len, bool logScale)
+{
+    if(logScale) {
+        DBMtoMW_32f(src, dst, len);
+    } else {
+        simdSqr_32f(src, dst, len);
+    }
+}
+
+void PowerToTrace_32f(const float *src, float *dst, int len, bool logScale)
+{
+    if(logScale) {
+        MWtoDBM_32f(src, dst, len);
+    } else {
+        simdSqrt_32f(src, dst, len);
+    }
+}
+
+// Log units differ by a constant, mV is 20 log10 from dBmV
+void unit_convert_32f(const float *src, float *dst, int len,
+                      AmpUnits unit_in, AmpUnits unit_out)
+{
+    if(unit_in == unit_out) {
+        if(src != dst) {
+            for(int i = 0; i < len; i++) dst[i] = src[i];
+        }
+    } else if(unit_out == MV) {
+        DBtoLinear_32f(src, dst, len, 0.05f, (DB_OFFSET[DBMV] - DB_OFFSET[unit_in]) * 0.05f);
+    } else if(unit_in == MV) {
+        LinearToDB_32f(src, dst, len, 20.0f, DB_OFFSET[unit_out] - DB_OFFSET[DBMV]);
+    } else {
+        float diff = DB_OFFSET[unit_out] - DB_OFFSET[unit_in];
+        for(int i = 0; i < len; i++) dst[i] = src[i] + diff;
+    }
+}
@@ -28,6 +28,39 @@ inline double MV2toMV(double mv2) { return sqrt(mv2); }
 extern pfn_convert cvt_table[UNIT_COUNT][UNIT_COUNT];
 double unit_convert(double in, AmpUnits unit_in, AmpUnits unit_out);
 
+// Batched conversions between log and linear scale
+// Exact mode runs each element through double pow/log10, fast mode uses
+//   the SIMD exp2/log2 approximations in simd_kernels.h, which stay
+//   within 3.1e-5 dB of exact over +/-300 dB.
+enum AmpConvertMode {
+    AmpConvertExact = 0,
+    AmpConvertFast = 1
+};
+
+void SetAmpConvertMode(AmpConvertMode mode);
+AmpConvertMode GetAmpConvertMode();
+
+// dst[i] = 10^(src[i] * scale + offset)
+void DBtoLinear_32f(const float *src, float *dst, int len, float scale, float offset = 0.0f);
+// dst[i] = scale * log10(src[i]) + offset
+// Zero and negative inputs are floored at FLT_MIN
+void LinearToDB_32f(const float *src, float *dst, int len, float scale, float offset = 0.0f);
+
+// Power in dBm <-> mW
+inline void DBMtoMW_32f(const float *src, float *dst, int len) {
+    DBtoLinear_32f(src, dst, len, 0.1f);
+}
+inline void MWtoDBM_32f(const float *src, float *dst, int len) {
+    LinearToDB_32f(src, dst, len, 10.0f);
+}
+// Trace units to power and back, dBm <-> mW for log scales,
+//   mV <-> mV^2 for linear scales
+void TraceToPower_32f(const float *src, float *dst, int len, bool logScale);
+void PowerToTrace_32f(const float *src, float *dst, int len, bool logScale);
+// unit_convert() over an array, src and dst may alias
+void unit_convert_32f(const float *src, float *dst, int len,
+                      AmpUnits unit_in, AmpUnits unit_out);
+
 /* Amplitude class to represent values
  *  such as dBM, dBuV, mV
  * Not meant to be used for traces, just for
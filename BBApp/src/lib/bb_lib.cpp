@@ -47,39 +47,6 @@ char *persist_fs =
         "} \n"
         ;
 
-char *dot_persist_temp_vs =
-        //"#version 110 \n"
-        "void main() \n"
-        "{ \n"
-          "gl_Position = ftransform(); \n"
-          "gl_TexCoord[0] = gl_MultiTexCoord0; \n"
-        "} \n"
-        ;
-
-char *dot_persist_temp_fs =
-        //"#version 110 \n"
-        "uniform sampler2D texel; \n"
-        "uniform float scale; \n"
-        "void main() \n"
-        "{ \n"
-            // Get texel value
-            "vec4 px = texture2D( texel, gl_TexCoord[0].xy ); \n"
-
-            // Get luminance 0-1, all color channels have same value
-            "float L = px.x * scale; \n"
-
-            // Determine colors
-            "float R = clamp( (L-0.5)*4.0,       0.0, 1.0); \n"
-            "float MG = clamp( 4.0*L - 3.0,      0.0, 1.0 ); \n"
-            "float G =  clamp( 4.0*L,            0.0, 1.0 ) - MG; \n"
-            "float B = clamp( (0.5-L)*4.0,       0.0, 1.0); \n"
-            "float A =  px.w; \n"
-
-            // Output frag color
-            "gl_FragColor = vec4( R,G,B,A ); \n"
-        "} \n"
-        ;
-
 // Native bw look up table
 bandwidth_lut native_bw_lut[] = {
     { 0.301003456, 536870912 },  //0
@@ -905,6 +872,23 @@ void normalize_trace(const Trace *t,
                     grat_size, refLevel, dBdiv);
 }
 
+void normalize_trace(const Trace *t, GLVector &v, QPoint grat_size, DecimationPlan &plan)
+{
+    normalize_trace(t->Min(), t->Max(), t->Length(), v, grat_size,
+                    t->GetSettings()->RefLevel(), t->GetSettings()->Div(), plan);
+}
+
+void normalize_trace(const Trace *t,
+                     GLVector &v,
+                     QPoint grat_size,
+                     Amplitude refLevel,
+                     double dBdiv,
+                     DecimationPlan &plan)
+{
+    normalize_trace(t->Min(), t->Max(), t->Length(), v,
+                    grat_size, refLevel, dBdiv, plan);
+}
+
 //// Normalize frequency domain trace
 //void normalize_trace(const Trace *t,
 //                     GLVector &v,
@@ -996,79 +980,32 @@ void normalize_trace(const float *sweepMin,
                      Amplitude refLevel,
                      double dBdiv)
 {
-    v.clear();
-
-    if(length <= 0) {
-        return;
-    }
+    DecimationPlan plan;
+    normalize_trace(sweepMin, sweepMax, length, v, grat_size, refLevel, dBdiv, plan);
+}
 
-    // Data needed to transform sweep into a screen trace
-    int currentPix = 0;                                    // Step through all pixels
-    double currentStep = 0.0;                              // Our curr step
-    double step = (float)(grat_size.x()) / ( length - 1 );   // Step size
+void normalize_trace(const float *sweepMin,
+                     const float *sweepMax,
+                     int length,
+                     GLVector &v,
+                     QPoint grat_size,
+                     Amplitude refLevel,
+                     double dBdiv,
+                     DecimationPlan &plan)
+{
     double ref;                       // Value representing the top of graticule
     double botRef;                    // Value representing bottom of graticule
-    double xScale = 1.0 / (double)grat_size.x();
-    double yScale;
 
     if(refLevel.IsLogScale()) {
         ref = refLevel.ConvertToUnits(AmpUnits::DBM);
         botRef = ref - 10.0 * dBdiv;
-        yScale = 1.0 / (10.0 * dBdiv);
     } else {
         ref = refLevel.Val();
         botRef = 0.0;
-        yScale = (1.0 / ref);
-    }
-
-    v.reserve(grat_size.x() * 4);
-
-    // Less samples than pixels, create quads max1,min1,max2,min2,max3,min3,..
-    if(length < grat_size.x()) {
-
-        for(int i = 0; i < length; i++) {
-
-            double max = sweepMax[i];
-            double min = sweepMin[i];
-
-            v.push_back(xScale * (currentStep));
-            v.push_back(yScale * (max - botRef));
-            v.push_back(xScale * (currentStep));
-            v.push_back(yScale * (min - botRef));
-
-            currentStep += step;
-        }
-        return;
     }
 
-    // Keeps track of local max/mins
-    float min = ref;
-    float max = botRef;
-
-    // More samples than pixels, Create pixel resolution, keeps track
-    //   of min/max for each pixel, draws 1 pixel wide quads
-    for(int i = 0; i < length; i++) {
-
-        double minVal = sweepMin[i];
-        double maxVal = sweepMax[i];
-
-        if(maxVal > max) max = maxVal;
-        if(minVal < min) min = minVal;
-
-        currentStep += step;
-
-        if(currentStep > currentPix) {
-
-            v.push_back(xScale * currentPix);
-            v.push_back(yScale * (min - botRef));
-            v.push_back(xScale * currentPix);
-            v.push_back(yScale * (max - botRef));
-
-            min = ref;
-            max = botRef;
-            currentPix++;
-        }
-    }
+    plan.Prepare(length, grat_size.x(), ref, botRef);
+    plan.Apply(sweepMin, sweepMax, v);
 }
 
 //void normalize_trace(const Trace *t, LineList &ll, QSize grat_size)
@@ -1217,8 +1154,8 @@ void demod_am(const complex_f *src, float *dst, int len)
 {
     for(int i = 0; i < len; i++) {
         dst[i] = src[i].re * src[i].re + src[i].im * src[i].im;
-        dst[i] = 10.0 * log10(dst[i]);
     }
+    LinearToDB_32f(dst, dst, len, 10.0f);
 
     // if(linScale), convert to milliVolts?
 //    for(int i = 0; i < len; i++) {
@@ -24,6 +24,7 @@
 #include "kiss_fft/kissfft.hh"
 
 #include "lib/device_traits.h"
+#include "lib/decimation_plan.h"
 
 class Trace;
 
@@ -49,7 +50,6 @@ enum BBStyleSheet { LIGHT_STYLE_SHEET = 0, DARK_STYLE_SHEET = 1, BLUE_STYLE_SHEE
 
 // GLSL shaders
 extern char *persist_vs, *persist_fs;
-extern char *dot_persist_temp_vs, *dot_persist_temp_fs;
 
 // Software Mode/State, one value stored in Settings
 enum OperationalMode {
@@ -372,21 +372,6 @@ inline _Type lerp(_Type a, _Type b, float p) {
     return a * (1.f - p) + b * p;
 }
 
-// dB to linear voltage correction
-// Used for path-loss corrections
-inline void db_to_lin(float *srcDst, int len) {
-    for(int i = 0; i < len; i++) {
-        srcDst[i] = pow(10, srcDst[i] * 0.05);
-    }
-}
-
-// Convert dBm value to mV
-inline void dbm_to_mv(float *srcDst, int len) {
-    for(int i = 0; i < len; i++) {
-        srcDst[i] = pow(10,(srcDst[i] + 46.9897) * 0.05);
-    }
-}
-
 // a ^ n
 inline double power(double a, int n)
 {
@@ -555,6 +540,15 @@ void normalize_trace(const Trace *t, GLVector &vector, QPoint grat_size,
 void normalize_trace(const float *sweepMin, const float *sweepMax,
                      int length, GLVector &v, QPoint grat_size,
                      Amplitude refLevel, double dBdiv);
+// Reuse the bin to pixel mapping of plan while the sweep length,
+//   graticule width and vertical range stay the same
+void normalize_trace(const Trace *t, GLVector &vector, QPoint grat_size,
+                     DecimationPlan &plan);
+void normalize_trace(const Trace *t, GLVector &vector, QPoint grat_size,
+                     Amplitude refLevel, double div, DecimationPlan &plan);
+void normalize_trace(const float *sweepMin, const float *sweepMax,
+                     int length, GLVector &v, QPoint grat_size,
+                     Amplitude refLevel, double dBdiv, DecimationPlan &plan);
 
 //void normalize_trace(const Trace *t, LineList &ll, QSize grat_size);
 
@@ -0,0 +1,103 @@
+#include "decimation_plan.h"
+#include "simd_kernels.h"
+
+DecimationPlan::DecimationPlan() :
+    length(0),
+    width(0),
+    ref(0.0),
+    botRef(0.0),
+    yScale(0.0),
+    sparse(false),
+    points(0)
+{
+
+}
+
+void DecimationPlan::Prepare(int newLength, int newWidth, double newRef, double newBotRef)
+{
+    if(newLength == length && newWidth == width &&
+            newRef == ref && newBotRef == botRef) {
+        return;
+    }
+
+    length = newLength;
+    width = newWidth;
+    ref = newRef;
+    botRef = newBotRef;
+    Build();
+}
+
+// Steps the bins across the pixels exactly as the per sweep loop did,
+//   in double, so the plan places every point where it used to be
+void DecimationPlan::Build()
+{
+    x.clear();
+    spanEnd.clear();
+    points = 0;
+    yScale = (ref != botRef) ? 1.0 / (ref - botRef) : 0.0;
+
+    if(length <= 0 || width <= 0) return;
+
+    double currentStep = 0.0;
+    double step = (float)(width) / (length - 1);
+    double xScale = 1.0 / (double)width;
+
+    sparse = (length < width);
+
+    if(sparse) {
+        x.resize(length);
+        for(int i = 0; i < length; i++) {
+            x[i] = xScale * currentStep;
+            currentStep += step;
+        }
+        points = length;
+        return;
+    }
+
+    int currentPix = 0;
+    x.reserve(width);
+    spanEnd.reserve(width);
+    for(int i = 0; i < length; i++) {
+        currentStep += step;
+        if(currentStep > currentPix) {
+            x.push_back(xScale * currentPix);
+            spanEnd.push_back(i + 1);
+            currentPix++;
+        }
+    }
+    points = (int)spanEnd.size();
+}
+
+void DecimationPlan::Apply(const float *sweepMin, const float *sweepMax,
+                           std::vector<float> &v) const
+{
+    v.resize(points * 4);
+    if(points == 0) return;
+
+    float *dst = &v[0];
+
+    if(sparse) {
+        for(int i = 0; i < points; i++) {
+            *dst++ = x[i];
+            *dst++ = yScale * (sweepMax[i] - botRef);
+            *dst++ = x[i];
+            *dst++ = yScale * (sweepMin[i] - botRef);
+        }
+        return;
+    }
+
+    // Seeded as before, the min from the top of the graticule and the
+    //   max from the bottom
+    int first = 0;
+    for(int p = 0; p < points; p++) {
+        float min = ref;
+        float max = botRef;
+        simdMinMax_32f(sweepMin + first, sweepMax + first, spanEnd[p] - first, &min, &max);
+        first = spanEnd[p];
+
+        *dst++ = x[p];
+        *dst++ = yScale * (min - botRef);
+        *dst++ = x[p];
+        *dst++ = yScale * (max - botRef);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef DECIMATION_PLAN_H
+#define DECIMATION_PLAN_H
+
+#include <vector>
+
+#include "macros.h"
+
+/*
+ * Bin to pixel mapping of normalize_trace(), built once for a sweep
+ *   length, graticule width and vertical range and reused for every
+ *   sweep drawn with them
+ * With fewer bins than pixels each bin is one point, max then min
+ * Otherwise each pixel is the min then max of its span of bins,
+ *   reduced with simdMinMax_32f()
+ * Points are (x, y, x, y), x and y in [0,1] across the graticule
+ */
+class DecimationPlan {
+public:
+    DecimationPlan();
+    ~DecimationPlan() {}
+
+    // Rebuild if any of the keys changed, ref and botRef are the top
+    //   and bottom of the graticule in the units of the sweep
+    void Prepare(int length, int width, double ref, double botRef);
+    // Points the plan writes, 4 floats each
+    int Points() const { return points; }
+
+    // v is resized to Points() * 4 and written in place, it only
+    //   reallocates when it grows
+    void Apply(const float *sweepMin, const float *sweepMax, std::vector<float> &v) const;
+
+private:
+    void Build();
+
+    int length;
+    int width;
+    double ref;
+    double botRef;
+    double yScale;
+
+    bool sparse; // Fewer bins than pixels
+    int points;
+    // Sparse, x of each bin
+    // Decimating, x of each pixel and the end of its span of bins,
+    //   a span starts where the previous one ended
+    std::vector<float> x;
+    std::vector<int> spanEnd;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(DecimationPlan)
+};
+
+#endif // DECIMATION_PLAN_H
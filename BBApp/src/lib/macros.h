@@ -3,8 +3,10 @@
 
 // Data Defines
 #define MARKER_COUNT (6)
-#define TRACE_COUNT (6)
+#define TRACE_COUNT (6) // Default, see TraceManager::TraceCount()
+#define MAX_TRACE_COUNT (32)
 #define PRESET_COUNT (9)
+#define MAX_TITLE_LEN (127) // Session title, also stored in playback files
 
 #define TOOLBAR_H (30)
 
@@ -0,0 +1,235 @@
+#include "peak_index.h"
+
+#include <limits>
+
+#include "bb_lib.h"
+
+namespace {
+
+const float NEG_INF = -std::numeric_limits<float>::infinity();
+const float POS_INF = std::numeric_limits<float>::infinity();
+
+struct Above {
+    Above(float l) : level(l) {}
+    bool operator()(float v) const { return v > level; }
+    float level;
+};
+
+struct AtOrAbove {
+    AtOrAbove(float l) : level(l) {}
+    bool operator()(float v) const { return v >= level; }
+    float level;
+};
+
+struct AtOrBelow {
+    AtOrBelow(float l) : level(l) {}
+    bool operator()(float v) const { return v <= level; }
+    float level;
+};
+
+} // namespace
+
+PeakIndex::PeakIndex()
+{
+    Reset(0);
+}
+
+void PeakIndex::Reset(int newLen)
+{
+    len = (newLen > 0) ? newLen : 0;
+    blocks = (len + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+    leaves = 1;
+    while(leaves < blocks) leaves <<= 1;
+
+    maxTree.assign(2 * leaves, NEG_INF);
+    minTree.assign(2 * leaves, POS_INF);
+    blockSum.assign(blocks, 0.0);
+    blockSumSq.assign(blocks, 0.0);
+}
+
+void PeakIndex::CopyFrom(const PeakIndex &other)
+{
+    len = other.len;
+    blocks = other.blocks;
+    leaves = other.leaves;
+    maxTree = other.maxTree;
+    minTree = other.minTree;
+    blockSum = other.blockSum;
+    blockSumSq = other.blockSumSq;
+}
+
+void PeakIndex::Refresh(const float *data, int start, int stop)
+{
+    if(start < 0) start = 0;
+    if(stop > len) stop = len;
+    if(start >= stop) return;
+
+    int b0 = start >> BLOCK_SHIFT;
+    int b1 = (stop - 1) >> BLOCK_SHIFT;
+
+    for(int b = b0; b <= b1; b++) {
+        const float *p = data + (b << BLOCK_SHIFT);
+        int n = bb_lib::min2(BLOCK_SIZE, len - (b << BLOCK_SHIFT));
+        float mx = p[0], mn = p[0];
+        double sum = 0.0, sumSq = 0.0;
+        for(int i = 0; i < n; i++) {
+            mx = (p[i] > mx) ? p[i] : mx;
+            mn = (p[i] < mn) ? p[i] : mn;
+            sum += p[i];
+            sumSq += (double)p[i] * p[i];
+        }
+        maxTree[leaves + b] = mx;
+        minTree[leaves + b] = mn;
+        blockSum[b] = sum;
+        blockSumSq[b] = sumSq;
+    }
+
+    // Parents of the changed leaves, one level at a time
+    for(int lo = (leaves + b0) >> 1, hi = (leaves + b1) >> 1; lo >= 1; lo >>= 1, hi >>= 1) {
+        for(int n = lo; n <= hi; n++) {
+            maxTree[n] = bb_lib::max2(maxTree[2*n], maxTree[2*n+1]);
+            minTree[n] = bb_lib::min2(minTree[2*n], minTree[2*n+1]);
+        }
+    }
+}
+
+// Max over blocks [b0,b1]
+float PeakIndex::RangeMax(int b0, int b1) const
+{
+    float mx = NEG_INF;
+    for(int l = leaves + b0, r = leaves + b1 + 1; l < r; l >>= 1, r >>= 1) {
+        if(l & 1) mx = bb_lib::max2(mx, maxTree[l++]);
+        if(r & 1) mx = bb_lib::max2(mx, maxTree[--r]);
+    }
+    return mx;
+}
+
+// First (or last) block in [b0,b1] whose node value satisfies pred
+template<class Pred>
+int PeakIndex::FindBlock(const std::vector<float> &tree, int node, int lo, int hi,
+                         int b0, int b1, Pred pred, bool reverse) const
+{
+    if(hi < b0 || lo > b1 || !pred(tree[node])) {
+        return -1;
+    }
+    if(node >= leaves) {
+        return node - leaves;
+    }
+
+    int mid = (lo + hi) / 2;
+    int found;
+    if(!reverse) {
+        found = FindBlock(tree, 2*node, lo, mid, b0, b1, pred, reverse);
+        if(found < 0) found = FindBlock(tree, 2*node+1, mid+1, hi, b0, b1, pred, reverse);
+    } else {
+        found = FindBlock(tree, 2*node+1, mid+1, hi, b0, b1, pred, reverse);
+        if(found < 0) found = FindBlock(tree, 2*node, lo, mid, b0, b1, pred, reverse);
+    }
+    return found;
+}
+
+// Partial blocks at either end are scanned, whole blocks are found
+//   through the tree, then the found block is scanned
+template<class Pred>
+int PeakIndex::Find(const float *data, int start, int stop, const std::vector<float> &tree,
+                    Pred pred, bool reverse) const
+{
+    if(start < 0) start = 0;
+    if(stop > len) stop = len;
+    if(start >= stop) return -1;
+
+    int b0 = start >> BLOCK_SHIFT;
+    int b1 = (stop - 1) >> BLOCK_SHIFT;
+    int headStop = bb_lib::min2(stop, (b0 + 1) << BLOCK_SHIFT);
+    int tailStart = bb_lib::max2(headStop, b1 << BLOCK_SHIFT);
+
+    if(!reverse) {
+        for(int i = start; i < headStop; i++) {
+            if(pred(data[i])) return i;
+        }
+        if(b1 - b0 > 1) {
+            int b = FindBlock(tree, 1, 0, leaves - 1, b0 + 1, b1 - 1, pred, false);
+            if(b >= 0) {
+                int blockStop = bb_lib::min2(len, (b + 1) << BLOCK_SHIFT);
+                for(int i = b << BLOCK_SHIFT; i < blockStop; i++) {
+                    if(pred(data[i])) return i;
+                }
+            }
+        }
+        for(int i = tailStart; i < stop; i++) {
+            if(pred(data[i])) return i;
+        }
+    } else {
+        for(int i = stop - 1; i >= tailStart; i--) {
+            if(pred(data[i])) return i;
+        }
+        if(b1 - b0 > 1) {
+            int b = FindBlock(tree, 1, 0, leaves - 1, b0 + 1, b1 - 1, pred, true);
+            if(b >= 0) {
+                int blockStop = bb_lib::min2(len, (b + 1) << BLOCK_SHIFT);
+                for(int i = blockStop - 1; i >= (b << BLOCK_SHIFT); i--) {
+                    if(pred(data[i])) return i;
+                }
+            }
+        }
+        for(int i = headStop - 1; i >= start; i--) {
+            if(pred(data[i])) return i;
+        }
+    }
+
+    return -1;
+}
+
+int PeakIndex::ArgMax(const float *data, int start, int stop) const
+{
+    if(start < 0) start = 0;
+    if(stop > len) stop = len;
+    if(start >= stop) return -1;
+
+    int b0 = start >> BLOCK_SHIFT;
+    int b1 = (stop - 1) >> BLOCK_SHIFT;
+    int headStop = bb_lib::min2(stop, (b0 + 1) << BLOCK_SHIFT);
+    int tailStart = bb_lib::max2(headStop, b1 << BLOCK_SHIFT);
+
+    float mx = NEG_INF;
+    for(int i = start; i < headStop; i++) mx = bb_lib::max2(mx, data[i]);
+    if(b1 - b0 > 1) mx = bb_lib::max2(mx, RangeMax(b0 + 1, b1 - 1));
+    for(int i = tailStart; i < stop; i++) mx = bb_lib::max2(mx, data[i]);
+
+    int ix = Find(data, start, stop, maxTree, AtOrAbove(mx), false);
+    return (ix < 0) ? start : ix;
+}
+
+int PeakIndex::FirstAbove(const float *data, int start, int stop, float level) const
+{
+    return Find(data, start, stop, maxTree, Above(level), false);
+}
+
+int PeakIndex::LastAbove(const float *data, int start, int stop, float level) const
+{
+    return Find(data, start, stop, maxTree, Above(level), true);
+}
+
+int PeakIndex::FirstAtOrBelow(const float *data, int start, int stop, float level) const
+{
+    return Find(data, start, stop, minTree, AtOrBelow(level), false);
+}
+
+int PeakIndex::LastAtOrBelow(const float *data, int start, int stop, float level) const
+{
+    return Find(data, start, stop, minTree, AtOrBelow(level), true);
+}
+
+double PeakIndex::Sum() const
+{
+    double sum = 0.0;
+    for(int b = 0; b < blocks; b++) sum += blockSum[b];
+    return sum;
+}
+
+double PeakIndex::SumOfSquares() const
+{
+    double sum = 0.0;
+    for(int b = 0; b < blocks; b++) sum += blockSumSq[b];
+    return sum;
+}
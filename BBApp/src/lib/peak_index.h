@@ -0,0 +1,67 @@
+#ifndef PEAK_INDEX_H
+#define PEAK_INDEX_H
+
+#include <vector>
+
+#include "macros.h"
+
+/*
+ * Search index over a float array, typically the max buffer of a trace
+ * The array is split in blocks of BLOCK_SIZE values, a max and a min
+ *   segment tree over the blocks answer range and threshold queries
+ *   in O(log n) plus a scan of at most two partial blocks.
+ * The index does not own the array, every query takes the array it
+ *   was built from. After writing a range of the array call Refresh()
+ *   on that range, only the blocks it touches are recomputed.
+ */
+class PeakIndex {
+public:
+    static const int BLOCK_SHIFT = 6;
+    static const int BLOCK_SIZE = 1 << BLOCK_SHIFT;
+
+    PeakIndex();
+    ~PeakIndex() {}
+
+    // Size for an array of len values, nothing is indexed until Refresh()
+    void Reset(int len);
+    void CopyFrom(const PeakIndex &other);
+    int Length() const { return len; }
+
+    // Values [start,stop) of data changed
+    void Refresh(const float *data, int start, int stop);
+
+    // Index of the largest value in [start,stop), the first one on ties
+    // Returns -1 for an empty range
+    int ArgMax(const float *data, int start, int stop) const;
+    // First/last index in [start,stop) with data > level, or -1
+    int FirstAbove(const float *data, int start, int stop, float level) const;
+    int LastAbove(const float *data, int start, int stop, float level) const;
+    // First/last index in [start,stop) with data <= level, or -1
+    int FirstAtOrBelow(const float *data, int start, int stop, float level) const;
+    int LastAtOrBelow(const float *data, int start, int stop, float level) const;
+
+    // Sums over the whole array, for the mean and variance
+    double Sum() const;
+    double SumOfSquares() const;
+
+private:
+    template<class Pred>
+    int Find(const float *data, int start, int stop, const std::vector<float> &tree,
+             Pred pred, bool reverse) const;
+    template<class Pred>
+    int FindBlock(const std::vector<float> &tree, int node, int lo, int hi,
+                  int b0, int b1, Pred pred, bool reverse) const;
+    float RangeMax(int b0, int b1) const;
+
+    int len;
+    int blocks;
+    int leaves; // Power of two >= blocks
+    // Heap layout, node 1 is the root, block b is node leaves + b
+    std::vector<float> maxTree, minTree;
+    std::vector<double> blockSum, blockSumSq;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(PeakIndex)
+};
+
+#endif // PEAK_INDEX_H
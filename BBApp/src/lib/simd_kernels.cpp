@@ -0,0 +1,1020 @@
+#include "simd_kernels.h"
+
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC emits any intrinsic regardless of /arch
+#define SIMD_TARGET_SSE2
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_SSE2 __attribute__((target("sse2")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace {
+
+struct KernelTable {
+    void (*max)(const float*, const float*, float*, int);
+    void (*min)(const float*, const float*, float*, int);
+    void (*blend)(const float*, float*, float, int);
+    void (*sqr)(const float*, float*, int);
+    void (*sqrt)(const float*, float*, int);
+    int (*localMax)(const float*, int, float, int*);
+    void (*pow10)(const float*, float*, float, float, int);
+    void (*log10)(const float*, float*, float, float, int);
+    void (*welford)(const float*, const float*, double*, double*, float*, float*, int);
+    void (*p2Quantile)(const float*, const float*, float, float*, int, float*, int);
+    void (*countAbove)(const float*, float, unsigned int*, int);
+    void (*combine)(const float*, float, const float*, float, float, float*, int);
+    void (*decayAdd)(float*, int*, int, float, float, int);
+    void (*minMax)(const float*, const float*, int, float*, float*);
+};
+
+// 2^f on [-0.5,0.5], Taylor terms of exp(f ln2) through f^6
+//   truncation error (0.5 ln2)^7 / 7! = 1.2e-7 relative
+const float EXP2_C0 = 1.0f;
+const float EXP2_C1 = 0.693147180559945f;
+const float EXP2_C2 = 0.240226506959101f;
+const float EXP2_C3 = 0.0555041086648216f;
+const float EXP2_C4 = 0.00961812910762848f;
+const float EXP2_C5 = 0.00133335581464284f;
+const float EXP2_C6 = 0.000154035303933816f;
+// Exponent range of normal floats
+const float EXP2_MIN = -126.0f;
+const float EXP2_MAX = 127.99f;
+
+// log2(m) for m in [sqrt(1/2),sqrt(2)) as t * P(t^2), t = (m-1)/(m+1)
+//   atanh series through t^7, |t| <= 0.172, error 2 t^9 / 9 ln2 = 4e-8
+const float LOG2_C1 = 2.885390081777927f;
+const float LOG2_C3 = 0.961796693925976f;
+const float LOG2_C5 = 0.577078016355585f;
+const float LOG2_C7 = 0.412198583111132f;
+
+const float LOG2_10 = 3.32192809488736f;
+const float LOG10_2 = 0.301029995663981f;
+
+// Scalar, also finishes the tails of the vector kernels
+
+void maxScalar(const float *src1, const float *src2, float *dst, int len)
+{
+    for(int i = 0; i < len; i++) {
+        dst[i] = (src1[i] > src2[i]) ? src1[i] : src2[i];
+    }
+}
+
+void minScalar(const float *src1, const float *src2, float *dst, int len)
+{
+    for(int i = 0; i < len; i++) {
+        dst[i] = (src1[i] < src2[i]) ? src1[i] : src2[i];
+    }
+}
+
+void blendScalar(const float *src, float *srcDst, float weight, int len)
+{
+    for(int i = 0; i < len; i++) {
+        srcDst[i] += (src[i] - srcDst[i]) * weight;
+    }
+}
+
+void combineScalar(const float *src1, float a, const float *src2, float b, float c,
+                   float *dst, int len)
+{
+    for(int i = 0; i < len; i++) {
+        dst[i] = a * src1[i] + b * src2[i] + c;
+    }
+}
+
+void sqrScalar(const float *src, float *dst, int len)
+{
+    for(int i = 0; i < len; i++) {
+        dst[i] = src[i] * src[i];
+    }
+}
+
+void sqrtScalar(const float *src, float *dst, int len)
+{
+    for(int i = 0; i < len; i++) {
+        dst[i] = std::sqrt(src[i]);
+    }
+}
+
+// Also finishes the vector kernels from index i
+int localMaxFrom(const float *src, int len, float threshold, int *indices, int i)
+{
+    int count = 0;
+    for(; i < len - 1; i++) {
+        if(src[i] > threshold && src[i] > src[i-1] && src[i] >= src[i+1]) {
+            indices[count++] = i;
+        }
+    }
+    return count;
+}
+
+int localMaxScalar(const float *src, int len, float threshold, int *indices)
+{
+    return localMaxFrom(src, len, threshold, indices, 1);
+}
+
+// Same approximations as the vector kernels, so every level returns
+//   the same values to rounding
+inline float exp2Scalar(float x)
+{
+    x = (x < EXP2_MIN) ? EXP2_MIN : ((x > EXP2_MAX) ? EXP2_MAX : x);
+    float n = std::floor(x + 0.5f);
+    float f = x - n;
+    float p = EXP2_C6;
+    p = p * f + EXP2_C5;
+    p = p * f + EXP2_C4;
+    p = p * f + EXP2_C3;
+    p = p * f + EXP2_C2;
+    p = p * f + EXP2_C1;
+    p = p * f + EXP2_C0;
+    int bits;
+    memcpy(&bits, &p, 4);
+    bits += (int)n << 23;
+    memcpy(&p, &bits, 4);
+    return p;
+}
+
+inline float log2Scalar(float x)
+{
+    x = (x < FLT_MIN) ? FLT_MIN : x; // Also NaN-free for negatives
+    int bits;
+    memcpy(&bits, &x, 4);
+    // Mantissa to [sqrt(1/2),sqrt(2)) by borrowing from the exponent
+    int e = ((bits - 0x3f3504f3) >> 23);
+    bits -= e << 23;
+    float m;
+    memcpy(&m, &bits, 4);
+    float t = (m - 1.0f) / (m + 1.0f);
+    float t2 = t * t;
+    float p = LOG2_C7;
+    p = p * t2 + LOG2_C5;
+    p = p * t2 + LOG2_C3;
+    p = p * t2 + LOG2_C1;
+    return p * t + (float)e;
+}
+
+void pow10Scalar(const float *src, float *dst, float scale, float offset, int len)
+{
+    float a = scale * LOG2_10, b = offset * LOG2_10;
+    for(int i = 0; i < len; i++) {
+        dst[i] = exp2Scalar(src[i] * a + b);
+    }
+}
+
+void log10Scalar(const float *src, float *dst, float scale, float offset, int len)
+{
+    float a = scale * LOG10_2;
+    for(int i = 0; i < len; i++) {
+        dst[i] = log2Scalar(src[i]) * a + offset;
+    }
+}
+
+void countAboveScalar(const float *src, float threshold, unsigned int *counts, int len)
+{
+    for(int i = 0; i < len; i++) {
+        counts[i] += (src[i] > threshold) ? 1 : 0;
+    }
+}
+
+void decayAddScalar(float *value, int *stamp, int now, float log2Decay, float add, int len)
+{
+    for(int i = 0; i < len; i++) {
+        value[i] = value[i] * exp2Scalar((float)(now - stamp[i]) * log2Decay) + add;
+        stamp[i] = now;
+    }
+}
+
+void minMaxScalar(const float *srcMin, const float *srcMax, int len, float *mn, float *mx)
+{
+    float lo = *mn, hi = *mx;
+    for(int i = 0; i < len; i++) {
+        lo = (srcMin[i] < lo) ? srcMin[i] : lo;
+        hi = (srcMax[i] > hi) ? srcMax[i] : hi;
+    }
+    *mn = lo;
+    *mx = hi;
+}
+
+void welfordScalar(const float *src, const float *count, double *mean, double *m2,
+                   float *lo, float *hi, int len)
+{
+    for(int i = 0; i < len; i++) {
+        double n = count[i] + 1.0;
+        double delta = src[i] - mean[i];
+        mean[i] += delta / n;
+        m2[i] += delta * (src[i] - mean[i]);
+        double sd = sqrt(m2[i] / ((n > 1.0) ? (n - 1.0) : 1.0));
+        lo[i] = (float)(mean[i] - sd);
+        hi[i] = (float)(mean[i] + sd);
+    }
+}
+
+const float P2_MIN_GAP = 1.5f;
+
+// One P-square step for a single bin, m points at its row 0 entry
+// Positions are held as offsets from the desired positions, which keeps
+//   them small and exact in float no matter the count
+void p2Step(float x, float c, float p, float *m, int stride, float *dst)
+{
+    float q[5], e[5];
+    for(int k = 0; k < 5; k++) q[k] = m[k * stride];
+    e[0] = e[4] = 0.0f;
+    for(int k = 1; k < 4; k++) e[k] = m[(k + 4) * stride];
+
+    if(c < 5.0f) {
+        // Sorted insert until the five markers are filled
+        int n = (int)c;
+        int k = n;
+        for(; k > 0 && q[k - 1] > x; k--) q[k] = q[k - 1];
+        q[k] = x;
+        if(n == 4) {
+            e[1] = 1.0f - 2.0f * p;
+            e[2] = 2.0f - 4.0f * p;
+            e[3] = 1.0f - 2.0f * p;
+        }
+        for(k = 0; k <= n; k++) m[k * stride] = q[k];
+        for(k = 1; k < 4; k++) m[(k + 4) * stride] = e[k];
+        *dst = q[(int)(p * n + 0.5f)];
+        return;
+    }
+
+    // Desired positions advance by f, actual ones by one if x is below
+    const float f[5] = { 0.0f, p * 0.5f, p, (1.0f + p) * 0.5f, 1.0f };
+    for(int k = 1; k < 4; k++) {
+        e[k] += ((x < q[k]) ? 1.0f : 0.0f) - f[k];
+    }
+    q[0] = (x < q[0]) ? x : q[0];
+    q[4] = (x > q[4]) ? x : q[4];
+
+    // Marker spacing is the desired spacing for the new count plus the
+    //   offsets, move a marker one position if it is a position or more
+    //   from where it should be and there is room
+    // Spacings are whole numbers, tested against 1.5 so float rounding
+    //   of a spacing of 1 does not read as room
+    for(int k = 1; k < 4; k++) {
+        float right = c * (f[k + 1] - f[k]) + (e[k + 1] - e[k]);
+        float left = c * (f[k] - f[k - 1]) + (e[k] - e[k - 1]);
+        bool up = (e[k] <= -1.0f) && (right > P2_MIN_GAP);
+        bool down = (e[k] >= 1.0f) && (left > P2_MIN_GAP);
+        if(!up && !down) continue;
+
+        // Parabolic prediction, linear if it leaves the neighbors
+        float s = up ? 1.0f : -1.0f;
+        float qp = q[k] + s / (left + right) *
+                ((left + s) * (q[k + 1] - q[k]) / right +
+                 (right - s) * (q[k] - q[k - 1]) / left);
+        if(!(qp > q[k - 1] && qp < q[k + 1])) {
+            qp = up ? q[k] + (q[k + 1] - q[k]) / right
+                    : q[k] - (q[k] - q[k - 1]) / left;
+        }
+        q[k] = qp;
+        e[k] += s;
+    }
+
+    for(int k = 0; k < 5; k++) m[k * stride] = q[k];
+    for(int k = 1; k < 4; k++) m[(k + 4) * stride] = e[k];
+    *dst = q[2];
+}
+
+void p2QuantileScalar(const float *src, const float *count, float p, float *markers,
+                      int stride, float *dst, int len)
+{
+    for(int i = 0; i < len; i++) {
+        p2Step(src[i], count[i], p, markers + i, stride, dst + i);
+    }
+}
+
+#ifdef SIMD_X86
+
+// Index of the lowest set bit, mask must be non-zero
+inline int lowestBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long ix;
+    _BitScanForward(&ix, mask);
+    return (int)ix;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+SIMD_TARGET_SSE2 void maxSSE2(const float *src1, const float *src2, float *dst, int len)
+{
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_max_ps(_mm_loadu_ps(src1 + i), _mm_loadu_ps(src2 + i)));
+    }
+    maxScalar(src1 + i, src2 + i, dst + i, len - i);
+}
+
+SIMD_TARGET_SSE2 void minSSE2(const float *src1, const float *src2, float *dst, int len)
+{
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_min_ps(_mm_loadu_ps(src1 + i), _mm_loadu_ps(src2 + i)));
+    }
+    minScalar(src1 + i, src2 + i, dst + i, len - i);
+}
+
+SIMD_TARGET_SSE2 void blendSSE2(const float *src, float *srcDst, float weight, int len)
+{
+    const __m128 w = _mm_set1_ps(weight);
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m128 d = _mm_loadu_ps(srcDst + i);
+        __m128 diff = _mm_sub_ps(_mm_loadu_ps(src + i), d);
+        _mm_storeu_ps(srcDst + i, _mm_add_ps(d, _mm_mul_ps(diff, w)));
+    }
+    blendScalar(src + i, srcDst + i, weight, len - i);
+}
+
+SIMD_TARGET_SSE2 void combineSSE2(const float *src1, float a, const float *src2, float b,
+                                  float c, float *dst, int len)
+{
+    const __m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b), vc = _mm_set1_ps(c);
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m128 r = _mm_add_ps(_mm_mul_ps(va, _mm_loadu_ps(src1 + i)),
+                              _mm_mul_ps(vb, _mm_loadu_ps(src2 + i)));
+        _mm_storeu_ps(dst + i, _mm_add_ps(r, vc));
+    }
+    combineScalar(src1 + i, a, src2 + i, b, c, dst + i, len - i);
+}
+
+SIMD_TARGET_SSE2 void sqrSSE2(const float *src, float *dst, int len)
+{
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m128 s = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(s, s));
+    }
+    sqrScalar(src + i, dst + i, len - i);
+}
+
+SIMD_TARGET_SSE2 void sqrtSSE2(const float *src, float *dst, int len)
+{
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_sqrt_ps(_mm_loadu_ps(src + i)));
+    }
+    sqrtScalar(src + i, dst + i, len - i);
+}
+
+// Most bins are rejected by the compares, the mask is only walked
+//   for the few vectors holding a peak
+SIMD_TARGET_SSE2 int localMaxSSE2(const float *src, int len, float threshold, int *indices)
+{
+    const __m128 t = _mm_set1_ps(threshold);
+    int count = 0;
+    int i = 1;
+    for(; i + 4 < len; i += 4) {
+        __m128 c = _mm_loadu_ps(src + i);
+        __m128 peak = _mm_and_ps(_mm_cmpgt_ps(c, t),
+                      _mm_and_ps(_mm_cmpgt_ps(c, _mm_loadu_ps(src + i - 1)),
+                                 _mm_cmpge_ps(c, _mm_loadu_ps(src + i + 1))));
+        unsigned int mask = _mm_movemask_ps(peak);
+        while(mask) {
+            indices[count++] = i + lowestBit(mask);
+            mask &= mask - 1;
+        }
+    }
+    return count + localMaxFrom(src, len, threshold, indices + count, i);
+}
+
+// 2^x, same steps as exp2Scalar()
+SIMD_TARGET_SSE2 inline __m128 exp2SSE2(__m128 x)
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP2_MIN)), _mm_set1_ps(EXP2_MAX));
+    __m128i n = _mm_cvtps_epi32(x); // Round to nearest
+    __m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+    __m128 p = _mm_set1_ps(EXP2_C6);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C5));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C4));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C3));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C2));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C1));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C0));
+    __m128i bits = _mm_add_epi32(_mm_castps_si128(p), _mm_slli_epi32(n, 23));
+    return _mm_castsi128_ps(bits);
+}
+
+SIMD_TARGET_SSE2 void pow10SSE2(const float *src, float *dst, float scale, float offset, int len)
+{
+    const __m128 a = _mm_set1_ps(scale * LOG2_10), b = _mm_set1_ps(offset * LOG2_10);
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m128 x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i), a), b);
+        _mm_storeu_ps(dst + i, exp2SSE2(x));
+    }
+    pow10Scalar(src + i, dst + i, scale, offset, len - i);
+}
+
+SIMD_TARGET_SSE2 void log10SSE2(const float *src, float *dst, float scale, float offset, int len)
+{
+    const __m128 a = _mm_set1_ps(scale * LOG10_2), b = _mm_set1_ps(offset);
+    const __m128 one = _mm_set1_ps(1.0f), minNorm = _mm_set1_ps(FLT_MIN);
+    const __m128i sqrtHalf = _mm_set1_epi32(0x3f3504f3);
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m128i bits = _mm_castps_si128(_mm_max_ps(_mm_loadu_ps(src + i), minNorm));
+        __m128i e = _mm_srai_epi32(_mm_sub_epi32(bits, sqrtHalf), 23);
+        __m128 m = _mm_castsi128_ps(_mm_sub_epi32(bits, _mm_slli_epi32(e, 23)));
+        __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+        __m128 t2 = _mm_mul_ps(t, t);
+        __m128 p = _mm_set1_ps(LOG2_C7);
+        p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(LOG2_C5));
+        p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(LOG2_C3));
+        p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(LOG2_C1));
+        __m128 l = _mm_add_ps(_mm_mul_ps(p, t), _mm_cvtepi32_ps(e));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(l, a), b));
+    }
+    log10Scalar(src + i, dst + i, scale, offset, len - i);
+}
+
+// Compare masks are all ones, subtracting one adds one
+SIMD_TARGET_SSE2 void countAboveSSE2(const float *src, float threshold, unsigned int *counts, int len)
+{
+    const __m128 t = _mm_set1_ps(threshold);
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m128i above = _mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(src + i), t));
+        __m128i c = _mm_loadu_si128((const __m128i*)(counts + i));
+        _mm_storeu_si128((__m128i*)(counts + i), _mm_sub_epi32(c, above));
+    }
+    countAboveScalar(src + i, threshold, counts + i, len - i);
+}
+
+SIMD_TARGET_SSE2 void decayAddSSE2(float *value, int *stamp, int now, float log2Decay, float add, int len)
+{
+    const __m128i n = _mm_set1_epi32(now);
+    const __m128 l = _mm_set1_ps(log2Decay), a = _mm_set1_ps(add);
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m128i age = _mm_sub_epi32(n, _mm_loadu_si128((const __m128i*)(stamp + i)));
+        __m128 f = exp2SSE2(_mm_mul_ps(_mm_cvtepi32_ps(age), l));
+        _mm_storeu_ps(value + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(value + i), f), a));
+        _mm_storeu_si128((__m128i*)(stamp + i), n);
+    }
+    decayAddScalar(value + i, stamp + i, now, log2Decay, add, len - i);
+}
+
+SIMD_TARGET_SSE2 void welfordSSE2(const float *src, const float *count, double *mean,
+                                  double *m2, float *lo, float *hi, int len)
+{
+    const __m128d one = _mm_set1_pd(1.0);
+    int i = 0;
+    for(; i + 2 <= len; i += 2) {
+        __m128d x = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(src + i))));
+        __m128d n = _mm_add_pd(_mm_cvtps_pd(
+                _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(count + i)))), one);
+        __m128d m = _mm_loadu_pd(mean + i);
+        __m128d delta = _mm_sub_pd(x, m);
+        m = _mm_add_pd(m, _mm_div_pd(delta, n));
+        __m128d s = _mm_add_pd(_mm_loadu_pd(m2 + i), _mm_mul_pd(delta, _mm_sub_pd(x, m)));
+        _mm_storeu_pd(mean + i, m);
+        _mm_storeu_pd(m2 + i, s);
+        __m128d sd = _mm_sqrt_pd(_mm_div_pd(s, _mm_max_pd(_mm_sub_pd(n, one), one)));
+        _mm_storel_epi64((__m128i*)(lo + i), _mm_castps_si128(_mm_cvtpd_ps(_mm_sub_pd(m, sd))));
+        _mm_storel_epi64((__m128i*)(hi + i), _mm_castps_si128(_mm_cvtpd_ps(_mm_add_pd(m, sd))));
+    }
+    welfordScalar(src + i, count + i, mean + i, m2 + i, lo + i, hi + i, len - i);
+}
+
+// Smallest and largest of the four lanes into *mn and *mx
+SIMD_TARGET_SSE2 inline void reduceMinMaxSSE2(__m128 lo, __m128 hi, float *mn, float *mx)
+{
+    lo = _mm_min_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_min_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+    hi = _mm_max_ps(hi, _mm_movehl_ps(hi, hi));
+    hi = _mm_max_ss(hi, _mm_shuffle_ps(hi, hi, 1));
+    *mn = _mm_cvtss_f32(lo);
+    *mx = _mm_cvtss_f32(hi);
+}
+
+SIMD_TARGET_SSE2 void minMaxSSE2(const float *srcMin, const float *srcMax, int len,
+                                 float *mn, float *mx)
+{
+    __m128 lo = _mm_set1_ps(*mn);
+    __m128 hi = _mm_set1_ps(*mx);
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        lo = _mm_min_ps(lo, _mm_loadu_ps(srcMin + i));
+        hi = _mm_max_ps(hi, _mm_loadu_ps(srcMax + i));
+    }
+    reduceMinMaxSSE2(lo, hi, mn, mx);
+    minMaxScalar(srcMin + i, srcMax + i, len - i, mn, mx);
+}
+
+SIMD_TARGET_SSE2 inline __m128 selectSSE2(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// p2Step() on four bins, vectors with a bin still filling its markers
+//   go through p2Step()
+SIMD_TARGET_SSE2 void p2QuantileSSE2(const float *src, const float *count, float p,
+                                     float *markers, int stride, float *dst, int len)
+{
+    const __m128 one = _mm_set1_ps(1.0f), negOne = _mm_set1_ps(-1.0f);
+    const __m128 five = _mm_set1_ps(5.0f), minGap = _mm_set1_ps(P2_MIN_GAP);
+    const __m128 f[5] = { _mm_setzero_ps(), _mm_set1_ps(p * 0.5f), _mm_set1_ps(p),
+                          _mm_set1_ps((1.0f + p) * 0.5f), one };
+    const __m128 lower = _mm_set1_ps(p * 0.5f), upper = _mm_set1_ps((1.0f - p) * 0.5f);
+    const __m128 df[4] = { lower, lower, upper, upper };
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m128 c = _mm_loadu_ps(count + i);
+        if(_mm_movemask_ps(_mm_cmplt_ps(c, five))) {
+            p2QuantileScalar(src + i, count + i, p, markers + i, stride, dst + i, 4);
+            continue;
+        }
+
+        float *m = markers + i;
+        __m128 x = _mm_loadu_ps(src + i);
+        __m128 q[5], e[5];
+        for(int k = 0; k < 5; k++) q[k] = _mm_loadu_ps(m + k * stride);
+        e[0] = e[4] = _mm_setzero_ps();
+        for(int k = 1; k < 4; k++) {
+            e[k] = _mm_loadu_ps(m + (k + 4) * stride);
+            e[k] = _mm_add_ps(e[k], _mm_sub_ps(_mm_and_ps(_mm_cmplt_ps(x, q[k]), one), f[k]));
+        }
+        q[0] = _mm_min_ps(q[0], x);
+        q[4] = _mm_max_ps(q[4], x);
+
+        for(int k = 1; k < 4; k++) {
+            __m128 right = _mm_add_ps(_mm_mul_ps(c, df[k]), _mm_sub_ps(e[k + 1], e[k]));
+            __m128 left = _mm_add_ps(_mm_mul_ps(c, df[k - 1]), _mm_sub_ps(e[k], e[k - 1]));
+            __m128 up = _mm_and_ps(_mm_cmple_ps(e[k], negOne), _mm_cmpgt_ps(right, minGap));
+            __m128 down = _mm_and_ps(_mm_cmpge_ps(e[k], one), _mm_cmpgt_ps(left, minGap));
+            __m128 adjust = _mm_or_ps(up, down);
+            if(!_mm_movemask_ps(adjust)) continue;
+
+            __m128 s = selectSSE2(up, one, negOne);
+            __m128 dr = _mm_div_ps(_mm_sub_ps(q[k + 1], q[k]), right);
+            __m128 dl = _mm_div_ps(_mm_sub_ps(q[k], q[k - 1]), left);
+            __m128 qp = _mm_add_ps(_mm_mul_ps(_mm_add_ps(left, s), dr),
+                                   _mm_mul_ps(_mm_sub_ps(right, s), dl));
+            qp = _mm_add_ps(q[k], _mm_mul_ps(_mm_div_ps(s, _mm_add_ps(left, right)), qp));
+            __m128 inside = _mm_and_ps(_mm_cmpgt_ps(qp, q[k - 1]), _mm_cmplt_ps(qp, q[k + 1]));
+            __m128 linear = selectSSE2(up, _mm_add_ps(q[k], dr), _mm_sub_ps(q[k], dl));
+            qp = selectSSE2(inside, qp, linear);
+            q[k] = selectSSE2(adjust, qp, q[k]);
+            e[k] = _mm_add_ps(e[k], _mm_and_ps(adjust, s));
+        }
+
+        for(int k = 0; k < 5; k++) _mm_storeu_ps(m + k * stride, q[k]);
+        for(int k = 1; k < 4; k++) _mm_storeu_ps(m + (k + 4) * stride, e[k]);
+        _mm_storeu_ps(dst + i, q[2]);
+    }
+    p2QuantileScalar(src + i, count + i, p, markers + i, stride, dst + i, len - i);
+}
+
+// Two vectors per iteration, the loads of the second overlap the
+//   max/min latency of the first
+
+SIMD_TARGET_AVX2 void maxAVX2(const float *src1, const float *src2, float *dst, int len)
+{
+    int i = 0;
+    for(; i + 16 <= len; i += 16) {
+        __m256 a0 = _mm256_max_ps(_mm256_loadu_ps(src1 + i), _mm256_loadu_ps(src2 + i));
+        __m256 a1 = _mm256_max_ps(_mm256_loadu_ps(src1 + i + 8), _mm256_loadu_ps(src2 + i + 8));
+        _mm256_storeu_ps(dst + i, a0);
+        _mm256_storeu_ps(dst + i + 8, a1);
+    }
+    for(; i + 8 <= len; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_max_ps(_mm256_loadu_ps(src1 + i),
+                                                _mm256_loadu_ps(src2 + i)));
+    }
+    maxScalar(src1 + i, src2 + i, dst + i, len - i);
+}
+
+SIMD_TARGET_AVX2 void minAVX2(const float *src1, const float *src2, float *dst, int len)
+{
+    int i = 0;
+    for(; i + 16 <= len; i += 16) {
+        __m256 a0 = _mm256_min_ps(_mm256_loadu_ps(src1 + i), _mm256_loadu_ps(src2 + i));
+        __m256 a1 = _mm256_min_ps(_mm256_loadu_ps(src1 + i + 8), _mm256_loadu_ps(src2 + i + 8));
+        _mm256_storeu_ps(dst + i, a0);
+        _mm256_storeu_ps(dst + i + 8, a1);
+    }
+    for(; i + 8 <= len; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_min_ps(_mm256_loadu_ps(src1 + i),
+                                                _mm256_loadu_ps(src2 + i)));
+    }
+    minScalar(src1 + i, src2 + i, dst + i, len - i);
+}
+
+SIMD_TARGET_AVX2 void blendAVX2(const float *src, float *srcDst, float weight, int len)
+{
+    const __m256 w = _mm256_set1_ps(weight);
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        __m256 d = _mm256_loadu_ps(srcDst + i);
+        __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(src + i), d);
+        _mm256_storeu_ps(srcDst + i, _mm256_fmadd_ps(diff, w, d));
+    }
+    blendScalar(src + i, srcDst + i, weight, len - i);
+}
+
+SIMD_TARGET_AVX2 void combineAVX2(const float *src1, float a, const float *src2, float b,
+                                  float c, float *dst, int len)
+{
+    const __m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b), vc = _mm256_set1_ps(c);
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        __m256 r = _mm256_fmadd_ps(vb, _mm256_loadu_ps(src2 + i), vc);
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(src1 + i), r));
+    }
+    combineScalar(src1 + i, a, src2 + i, b, c, dst + i, len - i);
+}
+
+SIMD_TARGET_AVX2 void sqrAVX2(const float *src, float *dst, int len)
+{
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        __m256 s = _mm256_loadu_ps(src + i);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(s, s));
+    }
+    sqrScalar(src + i, dst + i, len - i);
+}
+
+SIMD_TARGET_AVX2 void sqrtAVX2(const float *src, float *dst, int len)
+{
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_sqrt_ps(_mm256_loadu_ps(src + i)));
+    }
+    sqrtScalar(src + i, dst + i, len - i);
+}
+
+SIMD_TARGET_AVX2 inline __m256 exp2AVX2(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP2_MIN)), _mm256_set1_ps(EXP2_MAX));
+    __m256i n = _mm256_cvtps_epi32(x);
+    __m256 f = _mm256_sub_ps(x, _mm256_cvtepi32_ps(n));
+    __m256 p = _mm256_set1_ps(EXP2_C6);
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP2_C5));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP2_C4));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP2_C3));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP2_C2));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP2_C1));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(EXP2_C0));
+    __m256i bits = _mm256_add_epi32(_mm256_castps_si256(p), _mm256_slli_epi32(n, 23));
+    return _mm256_castsi256_ps(bits);
+}
+
+SIMD_TARGET_AVX2 void pow10AVX2(const float *src, float *dst, float scale, float offset, int len)
+{
+    const __m256 a = _mm256_set1_ps(scale * LOG2_10), b = _mm256_set1_ps(offset * LOG2_10);
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        __m256 x = _mm256_fmadd_ps(_mm256_loadu_ps(src + i), a, b);
+        _mm256_storeu_ps(dst + i, exp2AVX2(x));
+    }
+    pow10Scalar(src + i, dst + i, scale, offset, len - i);
+}
+
+SIMD_TARGET_AVX2 void log10AVX2(const float *src, float *dst, float scale, float offset, int len)
+{
+    const __m256 a = _mm256_set1_ps(scale * LOG10_2), b = _mm256_set1_ps(offset);
+    const __m256 one = _mm256_set1_ps(1.0f), minNorm = _mm256_set1_ps(FLT_MIN);
+    const __m256i sqrtHalf = _mm256_set1_epi32(0x3f3504f3);
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        __m256i bits = _mm256_castps_si256(_mm256_max_ps(_mm256_loadu_ps(src + i), minNorm));
+        __m256i e = _mm256_srai_epi32(_mm256_sub_epi32(bits, sqrtHalf), 23);
+        __m256 m = _mm256_castsi256_ps(_mm256_sub_epi32(bits, _mm256_slli_epi32(e, 23)));
+        __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+        __m256 t2 = _mm256_mul_ps(t, t);
+        __m256 p = _mm256_set1_ps(LOG2_C7);
+        p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(LOG2_C5));
+        p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(LOG2_C3));
+        p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(LOG2_C1));
+        __m256 l = _mm256_fmadd_ps(p, t, _mm256_cvtepi32_ps(e));
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(l, a, b));
+    }
+    log10Scalar(src + i, dst + i, scale, offset, len - i);
+}
+
+SIMD_TARGET_AVX2 void countAboveAVX2(const float *src, float threshold, unsigned int *counts, int len)
+{
+    const __m256 t = _mm256_set1_ps(threshold);
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        __m256i above = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(src + i), t, _CMP_GT_OQ));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(counts + i));
+        _mm256_storeu_si256((__m256i*)(counts + i), _mm256_sub_epi32(c, above));
+    }
+    countAboveScalar(src + i, threshold, counts + i, len - i);
+}
+
+SIMD_TARGET_AVX2 void decayAddAVX2(float *value, int *stamp, int now, float log2Decay, float add, int len)
+{
+    const __m256i n = _mm256_set1_epi32(now);
+    const __m256 l = _mm256_set1_ps(log2Decay), a = _mm256_set1_ps(add);
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        __m256i age = _mm256_sub_epi32(n, _mm256_loadu_si256((const __m256i*)(stamp + i)));
+        __m256 f = exp2AVX2(_mm256_mul_ps(_mm256_cvtepi32_ps(age), l));
+        _mm256_storeu_ps(value + i, _mm256_fmadd_ps(_mm256_loadu_ps(value + i), f, a));
+        _mm256_storeu_si256((__m256i*)(stamp + i), n);
+    }
+    decayAddScalar(value + i, stamp + i, now, log2Decay, add, len - i);
+}
+
+SIMD_TARGET_AVX2 void welfordAVX2(const float *src, const float *count, double *mean,
+                                  double *m2, float *lo, float *hi, int len)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    int i = 0;
+    for(; i + 4 <= len; i += 4) {
+        __m256d x = _mm256_cvtps_pd(_mm_loadu_ps(src + i));
+        __m256d n = _mm256_add_pd(_mm256_cvtps_pd(_mm_loadu_ps(count + i)), one);
+        __m256d m = _mm256_loadu_pd(mean + i);
+        __m256d delta = _mm256_sub_pd(x, m);
+        m = _mm256_add_pd(m, _mm256_div_pd(delta, n));
+        __m256d s = _mm256_fmadd_pd(delta, _mm256_sub_pd(x, m), _mm256_loadu_pd(m2 + i));
+        _mm256_storeu_pd(mean + i, m);
+        _mm256_storeu_pd(m2 + i, s);
+        __m256d sd = _mm256_sqrt_pd(_mm256_div_pd(s, _mm256_max_pd(_mm256_sub_pd(n, one), one)));
+        _mm_storeu_ps(lo + i, _mm256_cvtpd_ps(_mm256_sub_pd(m, sd)));
+        _mm_storeu_ps(hi + i, _mm256_cvtpd_ps(_mm256_add_pd(m, sd)));
+    }
+    welfordScalar(src + i, count + i, mean + i, m2 + i, lo + i, hi + i, len - i);
+}
+
+SIMD_TARGET_AVX2 void p2QuantileAVX2(const float *src, const float *count, float p,
+                                     float *markers, int stride, float *dst, int len)
+{
+    const __m256 one = _mm256_set1_ps(1.0f), negOne = _mm256_set1_ps(-1.0f);
+    const __m256 five = _mm256_set1_ps(5.0f), minGap = _mm256_set1_ps(P2_MIN_GAP);
+    const __m256 f[5] = { _mm256_setzero_ps(), _mm256_set1_ps(p * 0.5f), _mm256_set1_ps(p),
+                          _mm256_set1_ps((1.0f + p) * 0.5f), one };
+    const __m256 lower = _mm256_set1_ps(p * 0.5f), upper = _mm256_set1_ps((1.0f - p) * 0.5f);
+    const __m256 df[4] = { lower, lower, upper, upper };
+    int i = 0;
+    for(; i + 8 <= len; i += 8) {
+        __m256 c = _mm256_loadu_ps(count + i);
+        if(_mm256_movemask_ps(_mm256_cmp_ps(c, five, _CMP_LT_OQ))) {
+            p2QuantileScalar(src + i, count + i, p, markers + i, stride, dst + i, 8);
+            continue;
+        }
+
+        float *m = markers + i;
+        __m256 x = _mm256_loadu_ps(src + i);
+        __m256 q[5], e[5];
+        for(int k = 0; k < 5; k++) q[k] = _mm256_loadu_ps(m + k * stride);
+        e[0] = e[4] = _mm256_setzero_ps();
+        for(int k = 1; k < 4; k++) {
+            __m256 below = _mm256_and_ps(_mm256_cmp_ps(x, q[k], _CMP_LT_OQ), one);
+            e[k] = _mm256_loadu_ps(m + (k + 4) * stride);
+            e[k] = _mm256_add_ps(e[k], _mm256_sub_ps(below, f[k]));
+        }
+        q[0] = _mm256_min_ps(q[0], x);
+        q[4] = _mm256_max_ps(q[4], x);
+
+        for(int k = 1; k < 4; k++) {
+            __m256 right = _mm256_add_ps(_mm256_mul_ps(c, df[k]), _mm256_sub_ps(e[k + 1], e[k]));
+            __m256 left = _mm256_add_ps(_mm256_mul_ps(c, df[k - 1]), _mm256_sub_ps(e[k], e[k - 1]));
+            __m256 up = _mm256_and_ps(_mm256_cmp_ps(e[k], negOne, _CMP_LE_OQ),
+                                      _mm256_cmp_ps(right, minGap, _CMP_GT_OQ));
+            __m256 down = _mm256_and_ps(_mm256_cmp_ps(e[k], one, _CMP_GE_OQ),
+                                        _mm256_cmp_ps(left, minGap, _CMP_GT_OQ));
+            __m256 adjust = _mm256_or_ps(up, down);
+            if(!_mm256_movemask_ps(adjust)) continue;
+
+            __m256 s = _mm256_blendv_ps(negOne, one, up);
+            __m256 dr = _mm256_div_ps(_mm256_sub_ps(q[k + 1], q[k]), right);
+            __m256 dl = _mm256_div_ps(_mm256_sub_ps(q[k], q[k - 1]), left);
+            __m256 qp = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(left, s), dr),
+                                      _mm256_mul_ps(_mm256_sub_ps(right, s), dl));
+            qp = _mm256_add_ps(q[k], _mm256_mul_ps(_mm256_div_ps(s, _mm256_add_ps(left, right)), qp));
+            __m256 inside = _mm256_and_ps(_mm256_cmp_ps(qp, q[k - 1], _CMP_GT_OQ),
+                                          _mm256_cmp_ps(qp, q[k + 1], _CMP_LT_OQ));
+            __m256 linear = _mm256_blendv_ps(_mm256_sub_ps(q[k], dl), _mm256_add_ps(q[k], dr), up);
+            qp = _mm256_blendv_ps(linear, qp, inside);
+            q[k] = _mm256_blendv_ps(q[k], qp, adjust);
+            e[k] = _mm256_add_ps(e[k], _mm256_and_ps(adjust, s));
+        }
+
+        for(int k = 0; k < 5; k++) _mm256_storeu_ps(m + k * stride, q[k]);
+        for(int k = 1; k < 4; k++) _mm256_storeu_ps(m + (k + 4) * stride, e[k]);
+        _mm256_storeu_ps(dst + i, q[2]);
+    }
+    p2QuantileScalar(src + i, count + i, p, markers + i, stride, dst + i, len - i);
+}
+
+SIMD_TARGET_AVX2 int localMaxAVX2(const float *src, int len, float threshold, int *indices)
+{
+    const __m256 t = _mm256_set1_ps(threshold);
+    int count = 0;
+    int i = 1;
+    for(; i + 8 < len; i += 8) {
+        __m256 c = _mm256_loadu_ps(src + i);
+        __m256 peak = _mm256_and_ps(_mm256_cmp_ps(c, t, _CMP_GT_OQ),
+                      _mm256_and_ps(_mm256_cmp_ps(c, _mm256_loadu_ps(src + i - 1), _CMP_GT_OQ),
+                                    _mm256_cmp_ps(c, _mm256_loadu_ps(src + i + 1), _CMP_GE_OQ)));
+        unsigned int mask = _mm256_movemask_ps(peak);
+        while(mask) {
+            indices[count++] = i + lowestBit(mask);
+            mask &= mask - 1;
+        }
+    }
+    return count + localMaxFrom(src, len, threshold, indices + count, i);
+}
+
+// Two accumulators each to hide the latency of min/max
+SIMD_TARGET_AVX2 void minMaxAVX2(const float *srcMin, const float *srcMax, int len,
+                                 float *mn, float *mx)
+{
+    __m256 lo0 = _mm256_set1_ps(*mn), lo1 = lo0;
+    __m256 hi0 = _mm256_set1_ps(*mx), hi1 = hi0;
+    int i = 0;
+    for(; i + 16 <= len; i += 16) {
+        lo0 = _mm256_min_ps(lo0, _mm256_loadu_ps(srcMin + i));
+        lo1 = _mm256_min_ps(lo1, _mm256_loadu_ps(srcMin + i + 8));
+        hi0 = _mm256_max_ps(hi0, _mm256_loadu_ps(srcMax + i));
+        hi1 = _mm256_max_ps(hi1, _mm256_loadu_ps(srcMax + i + 8));
+    }
+    for(; i + 8 <= len; i += 8) {
+        lo0 = _mm256_min_ps(lo0, _mm256_loadu_ps(srcMin + i));
+        hi0 = _mm256_max_ps(hi0, _mm256_loadu_ps(srcMax + i));
+    }
+    lo0 = _mm256_min_ps(lo0, lo1);
+    hi0 = _mm256_max_ps(hi0, hi1);
+    reduceMinMaxSSE2(_mm_min_ps(_mm256_castps256_ps128(lo0), _mm256_extractf128_ps(lo0, 1)),
+                     _mm_max_ps(_mm256_castps256_ps128(hi0), _mm256_extractf128_ps(hi0, 1)),
+                     mn, mx);
+    minMaxScalar(srcMin + i, srcMax + i, len - i, mn, mx);
+}
+
+#endif // SIMD_X86
+
+const KernelTable kernelTables[] = {
+    { maxScalar, minScalar, blendScalar, sqrScalar, sqrtScalar, localMaxScalar, pow10Scalar, log10Scalar,
+      welfordScalar, p2QuantileScalar, countAboveScalar, combineScalar,
+      decayAddScalar, minMaxScalar },
+#ifdef SIMD_X86
+    { maxSSE2, minSSE2, blendSSE2, sqrSSE2, sqrtSSE2, localMaxSSE2, pow10SSE2, log10SSE2,
+      welfordSSE2, p2QuantileSSE2, countAboveSSE2, combineSSE2,
+      decayAddSSE2, minMaxSSE2 },
+    { maxAVX2, minAVX2, blendAVX2, sqrAVX2, sqrtAVX2, localMaxAVX2, pow10AVX2, log10AVX2,
+      welfordAVX2, p2QuantileAVX2, countAboveAVX2, combineAVX2,
+      decayAddAVX2, minMaxAVX2 }
+#endif
+};
+
+SimdLevel detectLevel()
+{
+#if defined(SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if(maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    // The OS must save the upper halves of the ymm registers
+    bool osAVX = osxsave && ((_xgetbv(0) & 0x6) == 0x6);
+    if(avx && avx2 && fma && osAVX) return SimdAVX2;
+    if(sse2) return SimdSSE2;
+    return SimdScalar;
+#elif defined(SIMD_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdAVX2;
+    if(__builtin_cpu_supports("sse2")) return SimdSSE2;
+    return SimdScalar;
+#else
+    return SimdScalar;
+#endif
+}
+
+SimdLevel& currentLevel()
+{
+    static SimdLevel level = simdMaxLevel();
+    return level;
+}
+
+inline const KernelTable& table()
+{
+    return kernelTables[currentLevel()];
+}
+
+} // namespace
+
+SimdLevel simdMaxLevel()
+{
+    static const SimdLevel maxLevel = detectLevel();
+    return maxLevel;
+}
+
+SimdLevel simdLevel()
+{
+    return currentLevel();
+}
+
+SimdLevel simdSetLevel(SimdLevel level)
+{
+    if(level > simdMaxLevel()) {
+        level = simdMaxLevel();
+    }
+    currentLevel() = level;
+    return level;
+}
+
+const char* simdLevelString(SimdLevel level)
+{
+    switch(level) {
+    case SimdSSE2: return "SSE2";
+    case SimdAVX2: return "AVX2";
+    default: return "Scalar";
+    }
+}
+
+void simdMax_32f(const float *src1, const float *src2, float *dst, int len)
+{
+    table().max(src1, src2, dst, len);
+}
+
+void simdMin_32f(const float *src1, const float *src2, float *dst, int len)
+{
+    table().min(src1, src2, dst, len);
+}
+
+void simdBlend_32f(const float *src, float *srcDst, float weight, int len)
+{
+    table().blend(src, srcDst, weight, len);
+}
+
+void simdCombine_32f(const float *src1, float a, const float *src2, float b, float c,
+                     float *dst, int len)
+{
+    table().combine(src1, a, src2, b, c, dst, len);
+}
+
+void simdSqr_32f(const float *src, float *dst, int len)
+{
+    table().sqr(src, dst, len);
+}
+
+void simdSqrt_32f(const float *src, float *dst, int len)
+{
+    table().sqrt(src, dst, len);
+}
+
+int simdLocalMax_32f(const float *src, int len, float threshold, int *indices)
+{
+    return table().localMax(src, len, threshold, indices);
+}
+
+void simdPow10_32f(const float *src, float *dst, float scale, float offset, int len)
+{
+    table().pow10(src, dst, scale, offset, len);
+}
+
+void simdLog10_32f(const float *src, float *dst, float scale, float offset, int len)
+{
+    table().log10(src, dst, scale, offset, len);
+}
+
+void simdWelford_32f(const float *src, const float *count, double *mean, double *m2,
+                     float *lo, float *hi, int len)
+{
+    table().welford(src, count, mean, m2, lo, hi, len);
+}
+
+void simdP2Quantile_32f(const float *src, const float *count, float p, float *markers,
+                        int stride, float *dst, int len)
+{
+    table().p2Quantile(src, count, p, markers, stride, dst, len);
+}
+
+void simdCountAbove_32f(const float *src, float threshold, unsigned int *counts, int len)
+{
+    table().countAbove(src, threshold, counts, len);
+}
+
+void simdDecayAdd_32f(float *value, int *stamp, int now, float log2Decay, float add, int len)
+{
+    table().decayAdd(value, stamp, now, log2Decay, add, len);
+}
+
+void simdMinMax_32f(const float *srcMin, const float *srcMax, int len, float *mn, float *mx)
+{
+    table().minMax(srcMin, srcMax, len, mn, mx);
+}
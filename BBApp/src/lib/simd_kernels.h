@@ -0,0 +1,83 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+// Element-wise float kernels for the per-sweep trace processing
+// Each kernel has a scalar, SSE2 and AVX2 implementation, the widest
+//   one the processor and OS support is selected on first use
+// In-place is allowed, dst may equal either source
+
+enum SimdLevel {
+    SimdScalar = 0,
+    SimdSSE2 = 1,
+    SimdAVX2 = 2
+};
+
+// Level in use
+SimdLevel simdLevel();
+// Widest level this machine supports
+SimdLevel simdMaxLevel();
+// Force a level, clamped to simdMaxLevel(), returns the level set
+// Not thread safe, for benchmarks and comparisons only
+SimdLevel simdSetLevel(SimdLevel level);
+const char* simdLevelString(SimdLevel level);
+
+// dst[i] = max(src1[i], src2[i])
+void simdMax_32f(const float *src1, const float *src2, float *dst, int len);
+// dst[i] = min(src1[i], src2[i])
+void simdMin_32f(const float *src1, const float *src2, float *dst, int len);
+// srcDst[i] += (src[i] - srcDst[i]) * weight
+// Exponential average with weight = 1/N
+void simdBlend_32f(const float *src, float *srcDst, float weight, int len);
+// dst[i] = a * src1[i] + b * src2[i] + c
+void simdCombine_32f(const float *src1, float a, const float *src2, float b, float c,
+                     float *dst, int len);
+// dst[i] = src[i] * src[i]
+void simdSqr_32f(const float *src, float *dst, int len);
+// dst[i] = sqrt(src[i])
+void simdSqrt_32f(const float *src, float *dst, int len);
+// Fast dB <-> linear, polynomial exp2/log2 on the float exponent and
+//   mantissa, exact conversions are in amplitude.h
+// Polynomial error is ~1e-7, the float rounding of large exponents
+//   dominates away from 0 dB, measured against double over +/-300 dB:
+// dst[i] = 10^(src[i] * scale + offset)
+// Relative error 7e-8 within 1 dB of unity, 3e-6 (1.3e-5 dB) at worst,
+//   results past the normal float range clamp to it
+void simdPow10_32f(const float *src, float *dst, float scale, float offset, int len);
+// dst[i] = scale * log10(src[i]) + offset
+// For scale = 10, error 2.4e-7 dB within 1 dB of unity, 3.1e-5 dB at
+//   worst, zero, negative and denormal inputs read as FLT_MIN
+void simdLog10_32f(const float *src, float *dst, float scale, float offset, int len);
+// Per-bin statistics across sweeps, count[i] holds the number of
+//   samples before src[i] and is advanced by the caller
+// Callers keep integer counts and pass them converted to float a chunk
+//   at a time, see Trace::UpdateStatistics(), past 2^24 the converted
+//   count is rounded, which only nudges weights already near zero
+// Welford running mean and variance, mean and m2 in double so small
+//   updates are not lost to rounding after many sweeps
+// Writes mean -/+ one sample standard deviation to lo/hi
+void simdWelford_32f(const float *src, const float *count, double *mean, double *m2,
+                     float *lo, float *hi, int len);
+// P-square estimate of quantile p in (0,1) (Jain & Chlamtac), five
+//   markers per bin stored as 8 rows of stride floats, rows 0-4 the
+//   marker heights, rows 5-7 the offsets of the middle three markers
+//   from their desired positions, zeroed before the first sample
+// Writes the current estimate to dst
+void simdP2Quantile_32f(const float *src, const float *count, float p, float *markers,
+                        int stride, float *dst, int len);
+// counts[i] += 1 where src[i] > threshold
+void simdCountAbove_32f(const float *src, float threshold, unsigned int *counts, int len);
+// Lazy exponential decay, stamp[i] is the step value[i] was last
+//   brought up to date, value[i] is decayed by 2^log2Decay per step
+//   since then, add is added and the stamp set to now
+// now - stamp[i] must not overflow an int
+void simdDecayAdd_32f(float *value, int *stamp, int now, float log2Decay, float add, int len);
+// Reduce a span, *mn = min(*mn, srcMin[i]) and *mx = max(*mx, srcMax[i])
+//   over [0,len), the caller seeds *mn and *mx
+void simdMinMax_32f(const float *srcMin, const float *srcMax, int len, float *mn, float *mx);
+// Indices i in [1,len-1) where src[i] > threshold, src[i] > src[i-1]
+//   and src[i] >= src[i+1], a plateau reports its left edge
+// Written to indices in ascending order, indices holds len values
+// Returns the number of indices written
+int simdLocalMax_32f(const float *src, int len, float threshold, int *indices);
+
+#endif // SIMD_KERNELS_H
@@ -0,0 +1,198 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+
+#include <QtGlobal>
+
+#include "macros.h"
+
+// What the producer does when every slot is in use
+enum SPSCOverflow {
+    // The new item is not written, WriteSlot() returns nullptr
+    SPSCDropNewest = 0,
+    // The oldest item the consumer has not taken yet is discarded and
+    //   its slot written instead
+    SPSCDropOldest = 1,
+    // Wait for the consumer to return a slot, only for producers the
+    //   consumer never waits on
+    SPSCBlock = 2
+};
+
+// Lock-free queue of pre-allocated slots for exactly one producer
+//   thread and one consumer thread.
+// Slots are filled and drained in place, nothing is copied or
+//   allocated while running.
+// The queue passes slot indices, a ring of filled slots from the
+//   producer and a ring of returned slots from the consumer. There
+//   are Capacity() + 2 slots, one being written, one being read.
+// Each ring is published with a release store of its head, read with
+//   an acquire load, so slot contents are visible to the other side
+//   without a lock.
+// The consumer takes the filled slot at tail with a compare and swap,
+//   the same one the producer uses to discard the oldest item, so a
+//   filled slot goes to exactly one of them.
+// Every item written is counted as produced, every item read as
+//   consumed and every item lost to the overflow policy as dropped.
+
+template<class _Type>
+class SPSCRing {
+public:
+    SPSCRing(int capacity = 2) : policy(SPSCDropNewest) {
+        Resize(capacity);
+    }
+    ~SPSCRing() {}
+
+    // Items queued at most, the slots are allocated here
+    // Not thread safe, call only while neither side is running
+    void Resize(int capacity) {
+        capacity = (capacity < 1) ? 1 : capacity;
+        slots.resize(capacity + 2);
+        int n = 2;
+        while(n < (int)slots.size()) n <<= 1;
+        filled = std::vector<std::atomic<int>>(n);
+        returned = std::vector<std::atomic<int>>(n);
+        mask = n - 1;
+        Reset();
+    }
+
+    // Empties the queue, every slot is returned to the producer
+    // Not thread safe, call only while neither side is running
+    void Reset() {
+        head.store(0);
+        tail.store(0);
+        for(int i = 0; i < (int)slots.size(); i++) {
+            returned[i].store(i);
+        }
+        returnedHead.store(slots.size());
+        returnedTail.store(0);
+        writing = -1;
+        reading = -1;
+        produced.store(0);
+        consumed.store(0);
+        dropped.store(0);
+    }
+
+    // Not thread safe, call only while neither side is running
+    void SetOverflowPolicy(SPSCOverflow p) { policy = p; }
+    SPSCOverflow OverflowPolicy() const { return policy; }
+
+    int Capacity() const { return slots.size() - 2; }
+    // Direct slot access for setup, not thread safe
+    int SlotCount() const { return slots.size(); }
+    _Type& Slot(int i) { return slots[i]; }
+
+    // Producer, slot to fill, a full queue is handled by the policy
+    // Returns nullptr when the new item is dropped, the drop is counted
+    // The same slot is returned until CommitWrite()
+    _Type* WriteSlot() {
+        while(writing < 0) {
+            unsigned int rt = returnedTail.load(std::memory_order_relaxed);
+            if(rt != returnedHead.load(std::memory_order_acquire)) {
+                writing = returned[rt & mask].load(std::memory_order_relaxed);
+                returnedTail.store(rt + 1, std::memory_order_release);
+                break;
+            }
+
+            if(policy == SPSCDropNewest) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            if(policy == SPSCDropOldest) {
+                // Read the index before the swap, once tail moves past
+                //   it the entry can be reused
+                unsigned int t = tail.load();
+                if(t != head.load(std::memory_order_relaxed)) {
+                    int index = filled[t & mask].load(std::memory_order_relaxed);
+                    if(tail.compare_exchange_strong(t, t + 1)) {
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        writing = index;
+                        break;
+                    }
+                    // Lost to the consumer, which returns a slot soon
+                }
+            }
+            std::this_thread::yield();
+        }
+        return &slots[writing];
+    }
+    // Producer, queue the slot returned by WriteSlot()
+    void CommitWrite() {
+        if(writing < 0) return;
+        unsigned int h = head.load(std::memory_order_relaxed);
+        filled[h & mask].store(writing, std::memory_order_relaxed);
+        head.store(h + 1, std::memory_order_release);
+        writing = -1;
+        produced.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Producer, an item was discarded outside of WriteSlot()
+    void CountDropped() { dropped.fetch_add(1, std::memory_order_relaxed); }
+
+    // Consumer, oldest filled slot or nullptr if empty
+    // The same slot is returned until CommitRead()
+    _Type* ReadSlot() {
+        if(reading >= 0) {
+            return &slots[reading];
+        }
+        unsigned int t = tail.load();
+        while(t != head.load(std::memory_order_acquire)) {
+            // A stale t fails the swap, the value read is then unused
+            int index = filled[t & mask].load(std::memory_order_relaxed);
+            if(tail.compare_exchange_weak(t, t + 1)) {
+                reading = index;
+                return &slots[reading];
+            }
+        }
+        return nullptr;
+    }
+    // Consumer, return the slot returned by ReadSlot() to the producer
+    void CommitRead() {
+        if(reading < 0) return;
+        unsigned int rh = returnedHead.load(std::memory_order_relaxed);
+        returned[rh & mask].store(reading, std::memory_order_relaxed);
+        returnedHead.store(rh + 1, std::memory_order_release);
+        reading = -1;
+        consumed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Filled slots not yet taken, approximate while running
+    int Available() const {
+        return head.load(std::memory_order_acquire) -
+                tail.load(std::memory_order_acquire);
+    }
+
+    // Counters since Reset(), approximate while running
+    qint64 Produced() const { return produced.load(std::memory_order_relaxed); }
+    qint64 Consumed() const { return consumed.load(std::memory_order_relaxed); }
+    qint64 Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<_Type> slots;
+    // Slot indices, both rings hold every slot at most once
+    std::vector<std::atomic<int>> filled;
+    std::vector<std::atomic<int>> returned;
+    unsigned int mask;
+    SPSCOverflow policy;
+
+    // Keep each side on its own cache lines, tail is written by both
+    //   but only by the producer when every slot is in use
+    std::atomic<unsigned int> head;
+    std::atomic<unsigned int> returnedTail;
+    std::atomic<qint64> produced;
+    std::atomic<qint64> dropped;
+    int writing; // Producer only, slot being written or -1
+    char producerPad[64];
+    std::atomic<unsigned int> tail;
+    char tailPad[64];
+    std::atomic<unsigned int> returnedHead;
+    std::atomic<qint64> consumed;
+    int reading; // Consumer only, slot being read or -1
+    char consumerPad[64];
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SPSCRing)
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,81 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+#include <QtGlobal>
+
+#include "macros.h"
+
+// Latest-value handoff between one producer and one consumer
+// Three slots: the producer fills the back slot and swaps it with the
+//   middle slot, the consumer swaps its front slot with the middle
+//   slot when a newer one is there. Neither side ever waits, the
+//   producer simply overwrites a middle slot the consumer did not
+//   take, which the consumer counts as skipped.
+// Producer calls may come from several threads if the caller
+//   serializes them, same for the consumer.
+
+template<class _Type>
+class TripleBuffer {
+public:
+    TripleBuffer() : back(0), front(1), middle(2), published(0),
+        lastTaken(0), skipped(0)
+    {
+        for(int i = 0; i < 3; i++) {
+            sequence[i] = 0;
+        }
+    }
+    ~TripleBuffer() {}
+
+    // Producer, slot to fill, contents are from an older publish
+    _Type& Back() { return slots[back]; }
+    // Producer, hand the back slot to the consumer
+    void Publish() {
+        sequence[back] = ++published;
+        int old = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = old & INDEX_MASK;
+    }
+
+    // Consumer, take the newest published slot if there is one
+    // Returns true if Front() changed
+    bool Update() {
+        if(!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        int old = middle.exchange(front, std::memory_order_acq_rel);
+        front = old & INDEX_MASK;
+
+        qint64 seq = sequence[front];
+        if(lastTaken != 0 && seq > lastTaken + 1) {
+            skipped.fetch_add(seq - lastTaken - 1, std::memory_order_relaxed);
+        }
+        lastTaken = seq;
+        return true;
+    }
+    // Consumer, slot last taken by Update()
+    const _Type& Front() const { return slots[front]; }
+
+    // Total number of publishes
+    qint64 Published() const { return published; }
+    // Publishes the consumer never saw
+    qint64 Skipped() const { return skipped.load(std::memory_order_relaxed); }
+
+private:
+    static const int INDEX_MASK = 0x3;
+    static const int FRESH = 0x4;
+
+    _Type slots[3];
+    qint64 sequence[3]; // Publish number of each slot
+    int back; // Producer only
+    int front; // Consumer only
+    std::atomic<int> middle; // Index | FRESH
+    qint64 published; // Producer only
+    qint64 lastTaken; // Consumer only
+    std::atomic<qint64> skipped;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TripleBuffer)
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -511,8 +511,12 @@ void MainWindow::aboutToShowUtilitiesMenu()
 void MainWindow::OpenDevice(QMap<QString, QVariant> devInfoMap)
 {
     QString openLabel;
-    if(devInfoMap["Series"].toInt() == saSeries) {
+    if(devInfoMap.contains("Serials")) {
+        openLabel = "Connecting Devices";
+    } else if(devInfoMap["Series"].toInt() == saSeries) {
         openLabel = "Connecting Device\nEstimated 6 seconds\n";
+    } else if(devInfoMap["Series"].toInt() == simSeries) {
+        openLabel = "Connecting Simulated Device";
     } else {
         openLabel = "Connecting Device\nEstimated 3 seconds";
     }
@@ -521,8 +525,18 @@ void MainWindow::OpenDevice(QMap<QString, QVariant> devInfoMap)
     pd.show();
 
     Device *device;
-    if(devInfoMap["Series"].toInt() == saSeries) {
+    if(devInfoMap.contains("Serials")) {
+        QList<int> serials;
+        for(const QVariant &v : devInfoMap["Serials"].toList()) {
+            serials.push_back(v.toInt());
+        }
+        device = new DeviceGroup(&session->prefs,
+                                 (DeviceSeries)devInfoMap["Series"].toInt(),
+                                 serials);
+    } else if(devInfoMap["Series"].toInt() == saSeries) {
         device = new DeviceSA(&session->prefs);
+    } else if(devInfoMap["Series"].toInt() == simSeries) {
+        device = new DeviceSim(&session->prefs);
     } else {
         device = new DeviceBB60A(&session->prefs);
     }
@@ -571,7 +585,18 @@ void MainWindow::Preset()
 
     QMap<QString, QVariant> devInfoMap;
     DeviceType devType = session->device->GetDeviceType();
-    if(devType == DeviceTypeBB60A || devType == DeviceTypeBB60C) {
+    DeviceGroup *group = dynamic_cast<DeviceGroup*>(session->device);
+    if(group) {
+        QList<QVariant> serials;
+        for(int sn : group->MemberSerials()) {
+            serials.push_back(sn);
+        }
+        devInfoMap["Series"] = group->MemberSeries();
+        devInfoMap["Serials"] = serials;
+    } else if(session->device->IsSimulated()) {
+        devInfoMap["Series"] = simSeries;
+        devInfoMap["SerialNumber"] = 0;
+    } else if(devType == DeviceTypeBB60A || devType == DeviceTypeBB60C) {
         devInfoMap["Series"] = bbSeries;
         if(devType == DeviceTypeBB60A) {
             devInfoMap["SerialNumber"] = 0;
@@ -657,7 +682,6 @@ void MainWindow::populateConnectMenu()
     if(list.empty()) {
         QAction *a = connect_menu->addAction("No Devices Found");
         a->setEnabled(false);
-        return;
     }
 
     for(auto &item : list) {
@@ -683,6 +707,50 @@ void MainWindow::populateConnectMenu()
         QAction *a = connect_menu->addAction(label);
         a->setData(infoMap);
     }
+
+    // Several BB60C receivers can sweep as a wideband group
+    // SA44/124 are not offered, a mixed group would disagree on the
+    //   device limits
+    QList<QVariant> bbSerials;
+    for(auto &item : list) {
+        if(item.series == bbSeries && item.serialNumber != 0) {
+            bbSerials.push_back(item.serialNumber);
+        }
+    }
+
+    if(bbSerials.size() > 1) {
+        QMap<QString, QVariant> groupInfoMap;
+        groupInfoMap["Series"] = bbSeries;
+        groupInfoMap["Serials"] = bbSerials;
+        connect_menu->addSeparator();
+        QAction *a = connect_menu->addAction(
+                    QString("All BB60C (Wideband x%1)").arg(bbSerials.size()));
+        a->setData(groupInfoMap);
+    }
+
+    // The simulated device is always available
+    QMap<QString, QVariant> simInfoMap;
+    simInfoMap["Series"] = simSeries;
+    simInfoMap["SerialNumber"] = 0;
+
+    connect_menu->addSeparator();
+    QAction *a = connect_menu->addAction("Simulated Device");
+    a->setData(simInfoMap);
+
+    SimConfig simConfig;
+    simConfig.Load();
+    if(simConfig.groupSize > 1) {
+        QList<QVariant> simSerials;
+        for(int i = 1; i <= simConfig.groupSize; i++) {
+            simSerials.push_back(i);
+        }
+        QMap<QString, QVariant> simGroupInfoMap;
+        simGroupInfoMap["Series"] = simSeries;
+        simGroupInfoMap["Serials"] = simSerials;
+        a = connect_menu->addAction(
+                    QString("Simulated Wideband Group (x%1)").arg(simConfig.groupSize));
+        a->setData(simGroupInfoMap);
+    }
 }
 
 // File Menu Disconnect Device
@@ -715,6 +783,15 @@ void MainWindow::forceDisconnectDevice()
                          " device is connected before opening again via the File Menu");
 }
 
+void MainWindow::deviceConnectionRestored(qint64 outageMs)
+{
+    RecoveryStats stats = session->device->GetRecoveryStats();
+    QString msg;
+    msg.sprintf("Connection restored after %.1f s, %d outage(s) totaling %.1f s",
+                outageMs / 1000.0, stats.outages, stats.totalOutageMs / 1000.0);
+    status_bar->SetMessage(msg);
+}
+
 // Preset Button Disconnect Device
 void MainWindow::presetDevice()
 {
@@ -736,6 +813,13 @@ void MainWindow::deviceConnected(bool success)
         session->LoadDefaults();
         connect(session->device, SIGNAL(connectionIssues()),
                 this, SLOT(forceDisconnectDevice()));
+        connect(session->device, SIGNAL(connectionRestored(qint64)),
+                this, SLOT(deviceConnectionRestored(qint64)));
+
+        // Diagnostics published during open arrive before this connection
+        status_bar->SetDiagnostics(session->device->Telemetry()->DiagnosticsString());
+        connect(session->device->Telemetry(), SIGNAL(diagnosticsChanged(const QString&)),
+                status_bar, SLOT(SetDiagnostics(const QString&)));
 
         sweep_panel->DeviceConnected(session->device->GetDeviceType());
 
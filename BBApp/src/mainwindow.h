@@ -89,6 +89,8 @@ public slots:
     void disconnectDevice();
     // Call when device must be forced close
     void forceDisconnectDevice();
+    // Device recovered from a lost connection on its own
+    void deviceConnectionRestored(qint64 outageMs);
     void presetDevice();
 
 private slots:
@@ -0,0 +1,184 @@
+#include "channel_power.h"
+#include "trace.h"
+#include "lib/bb_lib.h"
+
+#include <algorithm>
+
+BandPower::BandPower() :
+    len(0),
+    start(0.0),
+    binSize(1.0),
+    windowBandwidth(1.0),
+    logScale(true)
+{
+    prefix.assign(1, 0.0);
+}
+
+// dBm -> mW or mV -> mV^2 once, then one running sum
+void BandPower::Build(const Trace *trace)
+{
+    len = trace->Length();
+    start = trace->StartFreq();
+    binSize = trace->BinSize();
+    windowBandwidth = trace->GetSettings()->GetWindowBandwidth();
+    logScale = trace->GetSettings()->RefLevel().IsLogScale();
+
+    linear.resize(len);
+    prefix.resize(len + 1);
+    if(len == 0) {
+        prefix[0] = 0.0;
+        return;
+    }
+
+    TraceToPower_32f(trace->Max(), &linear[0], len, logScale);
+
+    double sum = 0.0;
+    prefix[0] = 0.0;
+    for(int i = 0; i < len; i++) {
+        sum += linear[i];
+        prefix[i + 1] = sum;
+    }
+}
+
+double BandPower::ToTraceUnits(double sum) const
+{
+    sum /= windowBandwidth;
+    return logScale ? MWtoDBM(sum) : MV2toMV(sum);
+}
+
+bool BandPower::GetChannelPower(double ch_start, double ch_stop, double *power) const
+{
+    if(len == 0 || ch_start < start || ch_stop > start + binSize * len) {
+        *power = 0.0;
+        return false;
+    }
+
+    // First bin past ch_start through the last bin below ch_stop
+    int first = (int)((ch_start - start) / binSize) + 1;
+    int last = (int)ceil((ch_stop - start) / binSize);
+    bb_lib::clamp(first, 0, len);
+    bb_lib::clamp(last, first, len);
+
+    *power = ToTraceUnits(Sum(first, last));
+    return true;
+}
+
+// Trim half of the excluded power from each end, the edges are where
+//   the running sum crosses those amounts
+void BandPower::GetOccupiedBandwidth(const Trace *trace, OccupiedBandwidthInfo &info) const
+{
+    Q_ASSERT(info.percentPower >= MIN_OCBW_PERCENT_POWER &&
+             info.percentPower <= MAX_OCBW_PERCENT_POWER);
+
+    info.traceLen = len;
+    if(len == 0) return;
+
+    double total = Total();
+    double halfMissing = ((100.0 - info.percentPower) / 2.0) / 100.0 * total;
+
+    // Fewest bins from the left holding halfMissing
+    info.lix = std::lower_bound(prefix.begin(), prefix.end(), halfMissing) - prefix.begin();
+    // Fewest bins from the right holding halfMissing
+    int rightEdge = (std::upper_bound(prefix.begin(), prefix.end(), total - halfMissing)
+                     - prefix.begin()) - 1;
+    bb_lib::clamp(info.lix, 0, len - 1);
+    bb_lib::clamp(rightEdge, info.lix + 1, len);
+    info.rix = rightEdge - 1;
+
+    info.leftMarker.Place(start + binSize * info.lix);
+    info.leftMarker.UpdateMarker(trace, trace->GetSettings());
+
+    info.rightMarker.Place(start + binSize * info.rix);
+    info.rightMarker.UpdateMarker(trace, trace->GetSettings());
+
+    info.bandwidth = info.rightMarker.Freq() - info.leftMarker.Freq();
+    double power = ToTraceUnits(Sum(info.lix, rightEdge));
+    AmpUnits powerUnits = trace->GetSettings()->RefLevel().Units();
+    if(powerUnits == MV) {
+        info.totalPower = Amplitude(power, powerUnits);
+    } else {
+        info.totalPower = Amplitude(power).ConvertToUnits(powerUnits);
+    }
+}
+
+ChannelPower::ChannelPower() :
+    enabled(false),
+    reference(0)
+{
+
+}
+
+ChannelPower::~ChannelPower()
+{
+
+}
+
+void ChannelPower::Configure(bool ch_enable, double ch_width, double ch_spacing, int adjacent)
+{
+    bb_lib::clamp(adjacent, 0, MAX_ADJACENT);
+
+    std::vector<ChannelSpec> list;
+    for(int i = -adjacent; i <= adjacent; i++) {
+        list.push_back(ChannelSpec(i * ch_spacing, ch_width));
+    }
+
+    Configure(ch_enable, list, adjacent);
+}
+
+void ChannelPower::Configure(bool ch_enable, const std::vector<ChannelSpec> &list, int ref)
+{
+    enabled = ch_enable;
+    channels.assign(list.begin(), list.end());
+    reference = ref;
+    bb_lib::clamp(reference, 0, bb_lib::max2((int)channels.size() - 1, 0));
+}
+
+void ChannelPower::Update(const Trace *trace, const BandPower &power)
+{
+    if(!enabled) return;
+
+    double center = trace->GetSettings()->Center();
+
+    for(Channel &ch : channels) {
+        ch.start = center + ch.spec.offset - (ch.spec.width / 2.0);
+        ch.stop = ch.start + ch.spec.width;
+        ch.in_view = power.GetChannelPower(ch.start, ch.stop, &ch.power);
+    }
+}
+
+bool ChannelPower::IsChannelInView(int channel) const
+{
+    if(channel < 0 || channel >= ChannelCount())
+        return false;
+
+    return channels[channel].in_view;
+}
+
+double ChannelPower::GetChannelStart(int channel) const
+{
+    if(channel < 0 || channel >= ChannelCount())
+        return 0.0;
+
+    return channels[channel].start;
+}
+
+double ChannelPower::GetChannelStop(int channel) const
+{
+    if(channel < 0 || channel >= ChannelCount())
+        return 0.0;
+
+    return channels[channel].stop;
+}
+
+double ChannelPower::GetChannelPower(int channel) const
+{
+    if(channel < 0 || channel >= ChannelCount())
+        return 0.0;
+
+    return channels[channel].power;
+}
+
+double ChannelPower::GetRelativePower(int channel) const
+{
+    return GetChannelPower(channel) - GetChannelPower(reference);
+}
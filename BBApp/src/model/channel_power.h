@@ -0,0 +1,104 @@
+#ifndef CHANNEL_POWER_H
+#define CHANNEL_POWER_H
+
+#include <vector>
+
+#include "lib/macros.h"
+
+class Trace;
+struct OccupiedBandwidthInfo;
+
+/*
+ * Linear power of one sweep, as a running sum over the bins
+ * Build() converts the max buffer once, after that the power of any
+ *   band is the difference of two sums, O(1) no matter the span.
+ * Sums are held in double, bands more than ~150 dB below the total
+ *   power of the sweep lose precision to the subtraction.
+ */
+class BandPower {
+public:
+    BandPower();
+    ~BandPower() {}
+
+    void Build(const Trace *trace);
+    int Length() const { return len; }
+
+    // Sum of linear power over bins [start,stop)
+    double Sum(int start, int stop) const {
+        return prefix[stop] - prefix[start];
+    }
+    double Total() const { return prefix[len]; }
+
+    // Channel power of [ch_start,ch_stop] Hz in trace units
+    // Returns false if the channel is not entirely on the sweep
+    bool GetChannelPower(double ch_start, double ch_stop, double *power) const;
+    // Edges found by binary search on the running sum
+    void GetOccupiedBandwidth(const Trace *trace, OccupiedBandwidthInfo &info) const;
+
+private:
+    double ToTraceUnits(double sum) const;
+
+    int len;
+    double start;
+    double binSize;
+    double windowBandwidth;
+    bool logScale;
+    std::vector<float> linear;
+    std::vector<double> prefix; // prefix[i] = power of bins [0,i)
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(BandPower)
+};
+
+struct ChannelSpec {
+    ChannelSpec(double f, double w) : offset(f), width(w) {}
+
+    double offset; // Hz from the center frequency
+    double width; // Hz
+};
+
+/*
+ * Power in a list of channels around the center frequency
+ * One channel is the reference the others are reported against, for
+ *   ACPR the main channel with N adjacent channels on either side.
+ */
+class ChannelPower {
+public:
+    static const int MAX_ADJACENT = 10;
+
+    ChannelPower();
+    ~ChannelPower();
+
+    // Main channel plus adjacent channels each side, spaced apart
+    void Configure(bool ch_enable, double ch_width, double ch_spacing, int adjacent = 1);
+    void Configure(bool ch_enable, const std::vector<ChannelSpec> &list, int reference);
+    void Update(const Trace *trace, const BandPower &power);
+
+    bool IsEnabled() const { return enabled; }
+    int ChannelCount() const { return channels.size(); }
+    int ReferenceChannel() const { return reference; }
+
+    bool IsChannelInView(int channel) const;
+    double GetChannelStart(int channel) const;
+    double GetChannelStop(int channel) const;
+    double GetChannelPower(int channel) const;
+    // Power relative to the reference channel, dBc or mV
+    double GetRelativePower(int channel) const;
+
+private:
+    struct Channel {
+        Channel(const ChannelSpec &s) : spec(s), start(0.0), stop(0.0),
+            power(0.0), in_view(false) {}
+
+        ChannelSpec spec;
+        double start, stop;
+        double power;
+        bool in_view;
+    };
+
+    bool enabled;
+    int reference;
+    std::vector<Channel> channels;
+};
+
+#endif // CHANNEL_POWER_H
@@ -10,6 +10,7 @@ QList<DeviceConnectionInfo> Device::GetDeviceList() const
     QList<DeviceConnectionInfo> deviceList;
     DeviceConnectionInfo info;
 
+#ifndef NO_DEVICE_API
     int serialNumbers[8];
     int deviceCount;
 
@@ -26,8 +27,145 @@ QList<DeviceConnectionInfo> Device::GetDeviceList() const
         info.serialNumber = serialNumbers[i];
         deviceList.push_back(info);
     }
+#endif
 
     return deviceList;
 }
 
+bool Device::IsEnumerated(int serial) const
+{
+    for(const DeviceConnectionInfo &info : GetDeviceList()) {
+        if(info.serialNumber == serial) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Device::ConfigApplied(const SweepSettings *s)
+{
+    appliedSweep = *s;
+    appliedConfig = AppliedSweep;
+    connectionLost = false;
+}
+
+void Device::ConfigApplied(const DemodSettings *ds)
+{
+    appliedDemod = *ds;
+    appliedConfig = AppliedDemod;
+    connectionLost = false;
+}
+
+void Device::ConfigApplied(double center, MeasRcvrRange range, int atten, int gain)
+{
+    appliedTRFL.center = center;
+    appliedTRFL.range = range;
+    appliedTRFL.atten = atten;
+    appliedTRFL.gain = gain;
+    appliedConfig = AppliedTRFL;
+    connectionLost = false;
+}
+
+void Device::ConfigApplied(const AudioSettings &as)
+{
+    appliedAudio = as;
+    appliedConfig = AppliedAudio;
+    connectionLost = false;
+}
+
+// Same settings produce the same trace/stream layout, so buffers
+//   sized before the outage remain valid
+// Fails if nothing was applied, a reopened device would otherwise
+//   resume unconfigured
+bool Device::ReplayConfig()
+{
+    if(appliedConfig == AppliedSweep) {
+        Trace scratch;
+        SweepSettings s = appliedSweep;
+        return Reconfigure(&s, &scratch);
+    } else if(appliedConfig == AppliedDemod) {
+        IQDescriptor desc;
+        DemodSettings ds = appliedDemod;
+        return Reconfigure(&ds, &desc);
+    } else if(appliedConfig == AppliedTRFL) {
+        IQDescriptor desc;
+        return ConfigureForTRFL(appliedTRFL.center, appliedTRFL.range,
+                                appliedTRFL.atten, appliedTRFL.gain, desc);
+    } else if(appliedConfig == AppliedAudio) {
+        AudioSettings as = appliedAudio;
+        return ConfigureAudio(as);
+    }
+    return false;
+}
+
+/*
+ * Idle -> Reopening -> Replaying -> Idle
+ * Reopening waits for the serial number to enumerate again, backing
+ *   off between attempts, a failed replay closes the device and goes
+ *   back to waiting. Runs on the acquiring thread, which owns the
+ *   device for the duration.
+ */
+bool Device::Recover(const std::atomic<bool> &keepTrying)
+{
+    qint64 lostAt = bb_lib::get_ms_since_epoch();
+    int serial = serial_number;
+    // Nothing to replay, reopening would only hand back a device in
+    //   an unknown state
+    bool canReplay = (appliedConfig != AppliedNone);
+    recoveryState = RecoveryReopening;
+
+    // The old handle is unusable, closing also clears any cached
+    //   configuration so the replay is applied in full
+    if(open) {
+        CloseDevice();
+    }
+
+    int backoff = RECOVERY_MIN_BACKOFF_MS;
+    while(keepTrying && canReplay) {
+        if(IsEnumerated(serial) && OpenDeviceWithSerial(serial)) {
+            recoveryState = RecoveryReplaying;
+            if(ReplayConfig()) {
+                qint64 outage = bb_lib::get_ms_since_epoch() - lostAt;
+                {
+                    std::lock_guard<std::mutex> lg(recoveryLock);
+                    recoveryStats.outages++;
+                    recoveryStats.lastOutageMs = outage;
+                    recoveryStats.longestOutageMs =
+                            bb_lib::max2(recoveryStats.longestOutageMs, outage);
+                    recoveryStats.totalOutageMs += outage;
+                }
+                connectionLost = false;
+                recoveryState = RecoveryIdle;
+                emit connectionRestored(outage);
+                return true;
+            }
+            CloseDevice();
+            recoveryState = RecoveryReopening;
+        }
+
+        if(bb_lib::get_ms_since_epoch() - lostAt >= RECOVERY_TIMEOUT_MS) {
+            break;
+        }
+        // Short steps so a stop request is not held up by the back off
+        for(int waited = 0; waited < backoff && keepTrying; waited += 50) {
+            Sleep(50);
+        }
+        backoff = bb_lib::min2(backoff * 2, (int)RECOVERY_MAX_BACKOFF_MS);
+    }
+
+    // Stopped by the user, the device is simply left closed
+    if(canReplay && !keepTrying) {
+        recoveryState = RecoveryIdle;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(recoveryLock);
+        recoveryStats.failures++;
+    }
+    recoveryState = RecoveryFailed;
+    emit connectionIssues();
+    return false;
+}
+
 #endif // DEVICE_CPP
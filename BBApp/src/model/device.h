@@ -1,6 +1,9 @@
 #ifndef DEVICE_H
 #define DEVICE_H
 
+#include <atomic>
+#include <mutex>
+
 #include <QObject>
 #include <QSize>
 
@@ -13,6 +16,7 @@
 #include "demod_settings.h"
 #include "audio_settings.h"
 #include "trace.h"
+#include "device_telemetry.h"
 
 const int TIMEBASE_INTERNAL = 0;
 const int TIMEBASE_EXT_AC = 1;
@@ -22,7 +26,8 @@ class Preferences;
 
 enum DeviceSeries {
     saSeries,
-    bbSeries
+    bbSeries,
+    simSeries
 };
 
 // Calibration state regarding the initial store through
@@ -37,6 +42,24 @@ struct DeviceConnectionInfo {
     DeviceSeries series;
 };
 
+// Connection-loss recovery, see Device::Recover()
+enum RecoveryState {
+    RecoveryIdle,
+    RecoveryReopening, // Waiting for the device to enumerate and open
+    RecoveryReplaying, // Open, reapplying the last configuration
+    RecoveryFailed
+};
+
+// Outage metrics since the device object was created
+struct RecoveryStats {
+    RecoveryStats() : outages(0), failures(0),
+        lastOutageMs(0), longestOutageMs(0), totalOutageMs(0) {}
+
+    int outages; // Successful recoveries
+    int failures; // Gave up, device disconnected
+    qint64 lastOutageMs, longestOutageMs, totalOutageMs;
+};
+
 // Do not change these values
 // They act as indices in the measuring receiver dialog class
 enum MeasRcvrRange {
@@ -55,9 +78,14 @@ public:
     Device(const Preferences *preferences) :
         prefs(preferences)
     {
-        current_temp = 0.0;
-        voltage = 0.0;
-        current = 0.0;
+        last_temp = 0.0;
+        reconfigure_on_next = false;
+        fetched = false;
+        diagnosticsDue = false;
+        autoRecover = false;
+        connectionLost = false;
+        recoveryState = RecoveryIdle;
+        appliedConfig = AppliedNone;
         device_type = DeviceTypeBB60C;
         tgCalState = tgCalStateUncalibrated;
     }
@@ -89,6 +117,8 @@ public:
     virtual bool SetTg(Frequency freq, double amp) { return false; }
 
     virtual bool CanPerformSelfTest() const { return false; }
+    // True for devices which synthesize data without hardware
+    virtual bool IsSimulated() const { return false; }
 
     virtual void TgStoreThrough() {}
     virtual void TgStoreThroughPad() {}
@@ -106,6 +136,8 @@ public:
     int Handle() const { return id; }
 
     virtual QString GetDeviceString() const = 0;
+    // Sample the device diagnostics and publish them to the telemetry
+    // Called from the telemetry thread for devices which start it
     virtual void UpdateDiagnostics() = 0;
 
     virtual const char* GetLastStatusString() const = 0;
@@ -116,8 +148,9 @@ public:
     QString FirmwareString() const { return firmware_string; }
 
     float LastConfiguredTemp() const { return last_temp; }
-    float CurrentTemp() const { return current_temp; }
-    float Voltage() const { return voltage; }
+    float CurrentTemp() const { return telemetry.Snapshot().temperature; }
+    float Voltage() const { return telemetry.Snapshot().voltage; }
+    const DeviceTelemetry* Telemetry() const { return &telemetry; }
     virtual bool IsPowered() const = 0;
     bool ADCOverflow() const { return adc_overflow; }
 
@@ -126,16 +159,86 @@ public:
     TgCalState GetTgCalState() const { return tgCalState; }
     QSize RealTimeFrameSize() const { return rtFrameSize; }
 
+    // While enabled a lost connection is left to Recover() on the
+    //   acquiring thread, otherwise connectionIssues() is emitted
+    void SetAutoRecover(bool enable) { autoRecover = enable; }
+    // True from a lost connection until the next configuration
+    bool ConnectionLost() const { return connectionLost; }
+    // True if the device with this serial number can be opened
+    virtual bool IsEnumerated(int serial) const;
+    // Reopen by serial number and replay the last applied sweep or
+    //   stream configuration after a lost connection, retrying until
+    //   RECOVERY_TIMEOUT_MS has passed or keepTrying is cleared
+    // Emits connectionIssues() on failure, not when keepTrying is
+    //   cleared first
+    bool Recover(const std::atomic<bool> &keepTrying);
+    RecoveryState GetRecoveryState() const { return (RecoveryState)recoveryState.load(); }
+    RecoveryStats GetRecoveryStats() const {
+        std::lock_guard<std::mutex> lg(recoveryLock);
+        return recoveryStats;
+    }
+
+    static const int RECOVERY_TIMEOUT_MS = 60000;
+    static const int RECOVERY_MIN_BACKOFF_MS = 250;
+    static const int RECOVERY_MAX_BACKOFF_MS = 4000;
+
 protected:
+    // Call in place of emitting connectionIssues()
+    void LoseConnection() {
+        connectionLost = true;
+        if(!autoRecover) {
+            emit connectionIssues();
+        }
+    }
+    // Call at the end of every successful Reconfigure(), the
+    //   settings are replayed after a lost connection
+    void ConfigApplied(const SweepSettings *s);
+    void ConfigApplied(const DemodSettings *ds);
+    void ConfigApplied(double center, MeasRcvrRange range, int atten, int gain);
+    void ConfigApplied(const AudioSettings &as);
+
+    // Sample diagnostics in the background, flagging a reconfigure
+    //   when the temperature drifts from the last configuration
+    // While the device is fetching the timer only requests a sample,
+    //   the acquiring thread takes it between fetches, see
+    //   SampleIfDue(), so the API is never called from two threads
+    // The timer samples itself once nothing was fetched for a whole
+    //   interval
+    void StartTelemetry() {
+        fetched = false;
+        diagnosticsDue = false;
+        telemetry.Start([this]() {
+            if(fetched.exchange(false)) {
+                diagnosticsDue = true;
+            } else {
+                diagnosticsDue = false;
+                SampleDiagnostics();
+            }
+        });
+    }
+    void StopTelemetry() { telemetry.Stop(); }
+    // Acquiring thread, call after every fetch
+    // NoteFetch() for devices which cannot be queried while acquiring
+    void NoteFetch() { fetched = true; }
+    void SampleIfDue() {
+        fetched = true;
+        if(diagnosticsDue.exchange(false)) {
+            SampleDiagnostics();
+        }
+    }
+    void SampleDiagnostics() {
+        std::lock_guard<std::recursive_mutex> lg(apiLock);
+        UpdateDiagnostics();
+        if(NeedsTempCal()) {
+            reconfigure_on_next = true;
+        }
+    }
+
     bool open;
     int id;
 
-    float last_temp; // Temp of last configured state
-    float current_temp; // Last retrieved temp
-    float voltage;
-    float current;
-
-    bool update_diagnostics_string;
+    std::atomic<float> last_temp; // Temp of last configured state
+    DeviceTelemetry telemetry; // Last retrieved temp/voltage/current
 
     DeviceType device_type;
     int serial_number;
@@ -143,16 +246,50 @@ protected:
     QString firmware_string;
 
     int timebase_reference; // Internal/Ext(AC/DC)
-    bool reconfigure_on_next; // set true to reconfigure on next sweep
+    std::atomic<bool> reconfigure_on_next; // set true to reconfigure on next sweep
+
+    // Held for every API call, only contended when the telemetry timer
+    //   samples an idle device as a fetch starts
+    // Recursive, implementations reconfigure from within a fetch and
+    //   abort from within a reconfigure
+    mutable std::recursive_mutex apiLock;
 
     bool adc_overflow;
     TgCalState tgCalState;
     QSize rtFrameSize;
 
+private:
+    bool ReplayConfig();
+
+    enum AppliedConfig {
+        AppliedNone, AppliedSweep, AppliedDemod, AppliedTRFL, AppliedAudio
+    };
+    AppliedConfig appliedConfig;
+    SweepSettings appliedSweep;
+    DemodSettings appliedDemod;
+    struct {
+        double center;
+        MeasRcvrRange range;
+        int atten, gain;
+    } appliedTRFL;
+    AudioSettings appliedAudio;
+
+    // Telemetry handshake with the acquiring thread, see StartTelemetry()
+    std::atomic<bool> fetched;
+    std::atomic<bool> diagnosticsDue;
+
+    std::atomic<bool> autoRecover;
+    std::atomic<bool> connectionLost;
+    std::atomic<int> recoveryState;
+    mutable std::mutex recoveryLock;
+    RecoveryStats recoveryStats;
+
 public slots:
 
 signals:
     void connectionIssues();
+    // Recover() succeeded, outage in milliseconds
+    void connectionRestored(qint64 outageMs);
 
 private:
     DISALLOW_COPY_AND_ASSIGN(Device)
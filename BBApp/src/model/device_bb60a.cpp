@@ -51,6 +51,7 @@ bool DeviceBB60A::OpenDevice()
     }
 
     open = true;
+    StartTelemetry();
     return true;
 }
 
@@ -78,11 +79,13 @@ bool DeviceBB60A::OpenDeviceWithSerial(int serialToOpen)
     }
 
     open = true;
+    StartTelemetry();
     return true;
 }
 
 int DeviceBB60A::GetNativeDeviceType() const
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     if(!open) {
         return BB_DEVICE_BB60C;
     }
@@ -99,7 +102,13 @@ bool DeviceBB60A::CloseDevice()
         return false;
     }
 
+    // Telemetry thread must not query a closed handle
+    StopTelemetry();
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     bbCloseDevice(id);
+    configCache.Clear();
+    // A reopened device must initiate audio again
+    last_audio_freq = -1.0e6;
 
     id = -1;
     open = false;
@@ -111,11 +120,13 @@ bool DeviceBB60A::CloseDevice()
 
 bool DeviceBB60A::Abort()
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     if(!open) {
         lastStatus = bbDeviceNotOpenErr;
         return false;
     }
 
+    configCache.Aborted();
     STATUS_CHECK(bbAbort(id));
     return true;
 }
@@ -127,8 +138,14 @@ bool DeviceBB60A::Preset()
         return false;
     }
 
+    // Stopped before taking the lock, CloseDevice() waits on the
+    //   telemetry thread which may be waiting on the lock
+    StopTelemetry();
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+
     bbAbort(id);
     bbPreset(id);
+    configCache.Clear();
 
     // Need to call bbCloseDevice for BB60A/C
     CloseDevice();
@@ -141,107 +158,148 @@ bool DeviceBB60A::Preset()
 
 bool DeviceBB60A::Reconfigure(const SweepSettings *s, Trace *t)
 {
-    Abort();
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
 
-    int scale = s->RefLevel().IsLogScale() ?
+    SweepConfig c;
+    c.scale = s->RefLevel().IsLogScale() ?
                 BB_LOG_SCALE : BB_LIN_SCALE;
-    int detector = (s->Detector() == BB_AVERAGE) ?
+    c.detector = (s->Detector() == BB_AVERAGE) ?
                 BB_AVERAGE : BB_MIN_AND_MAX;
-    int rbw_type = (s->NativeRBW()) ?
+    c.rbwType = (s->NativeRBW()) ?
                 BB_NATIVE_RBW : BB_NON_NATIVE_RBW;
-    int rejection = (s->Rejection()) ?
+    c.rejection = (s->Rejection()) ?
                 BB_SPUR_REJECT : BB_NO_SPUR_REJECT;
-    double sweep_time = s->SweepTime().Val();
+    c.sweepTime = s->SweepTime().Val();
 
-    double reference = s->RefLevel().ConvertToUnits(AmpUnits::DBM);
+    c.refLevel = s->RefLevel().ConvertToUnits(AmpUnits::DBM);
+    c.atten = (s->Atten()-1) * 10;
+    c.gain = s->Gain() - 1;
+    c.center = s->Center();
+    c.span = s->Span();
+    c.rbw = s->RBW();
+    c.vbw = s->VBW();
+    c.procUnits = s->ProcessingUnits();
 
-    int port_one_mask;
     switch(timebase_reference) {
     case TIMEBASE_INTERNAL:
-        port_one_mask = 0x0;
+        c.portOne = 0x0;
         break;
     case TIMEBASE_EXT_AC:
-        port_one_mask = BB_PORT1_EXT_REF_IN | BB_PORT1_AC_COUPLED;
+        c.portOne = BB_PORT1_EXT_REF_IN | BB_PORT1_AC_COUPLED;
         break;
     case TIMEBASE_EXT_DC:
-        port_one_mask = BB_PORT1_EXT_REF_IN | BB_PORT1_DC_COUPLED;
+        c.portOne = BB_PORT1_EXT_REF_IN | BB_PORT1_DC_COUPLED;
         break;
     }
 
-    int mode;
     switch(s->Mode()) {
     case MODE_SWEEPING: case MODE_HARMONICS:
-        mode = BB_SWEEPING;
+        c.mode = BB_SWEEPING;
         break;
     case MODE_REAL_TIME:
-        bbConfigureRealTime(id, s->Div() * 10.0, prefs->realTimeFrameRate);
-        mode = BB_REAL_TIME;
+        c.rtRange = s->Div() * 10.0;
+        c.rtFrameRate = prefs->realTimeFrameRate;
+        c.mode = BB_REAL_TIME;
         break;
     default:
         Q_ASSERT(0);
         return false;
     }
 
-    STATUS_CHECK(bbConfigureIO(id, port_one_mask, 0x0));
+    // Already sweeping with these settings, the abort/initiate cycle
+    //   is the expensive part of reconfiguring
+    if(!configCache.IsActive(c)) {
+        // Only issue the calls whose parameters changed
+        bool all = (configCache.Applied() == nullptr);
+        SweepConfig p = all ? SweepConfig() : *configCache.Applied();
 
-    // Scale based on amp unit type
-    STATUS_CHECK(bbConfigureAcquisition(id, detector, scale));
-    STATUS_CHECK(bbConfigureCenterSpan(id, s->Center(), s->Span()));
-    STATUS_CHECK(bbConfigureLevel(id, reference, (s->Atten()-1) * 10));
-    STATUS_CHECK(bbConfigureSweepCoupling(id, s->RBW(), s->VBW(), sweep_time,
-                                          rbw_type, rejection));
-    STATUS_CHECK(bbConfigureWindow(id, BB_NUTALL));
-    STATUS_CHECK(bbConfigureProcUnits(id, s->ProcessingUnits()));
-    STATUS_CHECK(bbConfigureGain(id, s->Gain() - 1));
+        Abort();
+        // If any call below fails the device state is unknown
+        configCache.Invalidate();
 
-    STATUS_CHECK(bbInitiate(id, mode, 0));
+        if(c.mode == BB_REAL_TIME && (all || p.rtRange != c.rtRange
+                                      || p.rtFrameRate != c.rtFrameRate)) {
+            bbConfigureRealTime(id, c.rtRange, c.rtFrameRate);
+        }
+        if(all || p.portOne != c.portOne) {
+            STATUS_CHECK(bbConfigureIO(id, c.portOne, 0x0));
+        }
+        // Scale based on amp unit type
+        if(all || p.detector != c.detector || p.scale != c.scale) {
+            STATUS_CHECK(bbConfigureAcquisition(id, c.detector, c.scale));
+        }
+        if(all || p.center != c.center || p.span != c.span) {
+            STATUS_CHECK(bbConfigureCenterSpan(id, c.center, c.span));
+        }
+        if(all || p.refLevel != c.refLevel || p.atten != c.atten) {
+            STATUS_CHECK(bbConfigureLevel(id, c.refLevel, c.atten));
+        }
+        if(all || p.rbw != c.rbw || p.vbw != c.vbw || p.sweepTime != c.sweepTime
+                || p.rbwType != c.rbwType || p.rejection != c.rejection) {
+            STATUS_CHECK(bbConfigureSweepCoupling(id, c.rbw, c.vbw, c.sweepTime,
+                                                  c.rbwType, c.rejection));
+        }
+        if(all) {
+            STATUS_CHECK(bbConfigureWindow(id, BB_NUTALL));
+        }
+        if(all || p.procUnits != c.procUnits) {
+            STATUS_CHECK(bbConfigureProcUnits(id, c.procUnits));
+        }
+        if(all || p.gain != c.gain) {
+            STATUS_CHECK(bbConfigureGain(id, c.gain));
+        }
+
+        STATUS_CHECK(bbInitiate(id, c.mode, 0));
+        configCache.SetApplied(c);
+
+        // Initiate performs the temperature calibration
+        float temp, voltage, current;
+        bbGetDeviceDiagnostics(id, &temp, &voltage, &current);
+        last_temp = temp;
+        telemetry.Publish(temp, voltage, current);
+    }
 
-    unsigned int traceSize;
-    double binSize, startFreq;
-    STATUS_CHECK(bbQueryTraceInfo(id, &traceSize, &binSize, &startFreq));
+    SweepInfo info;
+    if(!configCache.LookupInfo(c, info)) {
+        unsigned int traceSize;
+        STATUS_CHECK(bbQueryTraceInfo(id, &traceSize, &info.binSize, &info.startFreq));
+        info.traceSize = traceSize;
+        if(c.mode == BB_REAL_TIME) {
+            bbQueryRealTimeInfo(id, &info.rtWidth, &info.rtHeight);
+        }
+        configCache.StoreInfo(c, info);
+    }
 
     t->SetSettings(*s);
-    t->SetSize(traceSize);
-    t->SetFreq(binSize, startFreq);
-    t->SetUpdateRange(0, traceSize);
+    t->SetSize(info.traceSize);
+    t->SetFreq(info.binSize, info.startFreq);
+    t->SetUpdateRange(0, info.traceSize);
 
     if(s->Mode() == MODE_REAL_TIME) {
-        int w = 0, h = 0;
-        bbQueryRealTimeInfo(id, &w, &h);
-        rtFrameSize.setWidth(w);
-        rtFrameSize.setHeight(h);
+        rtFrameSize.setWidth(info.rtWidth);
+        rtFrameSize.setHeight(info.rtHeight);
     }
 
-    bbGetDeviceDiagnostics(id, &last_temp, &voltage, &current);
-
+    ConfigApplied(s);
     return true;
 }
 
 bool DeviceBB60A::GetSweep(const SweepSettings *s, Trace *t)
 {
-    // Get new diagnostic info, determine whether to update the
-    //  diagnostic string
-    UpdateDiagnostics();
-
-    // Print new diagnostics only when a value changed
-    if(update_diagnostics_string) {
-        QString diagnostics;
-        diagnostics.sprintf("%.2f C  --  %.2f V", CurrentTemp(), Voltage());
-        MainWindow::GetStatusBar()->SetDiagnostics(diagnostics);
-        update_diagnostics_string = false;
-    }
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
 
-    if((fabs(current_temp - last_temp) > 2.0) || reconfigure_on_next) {
+    // Temperature drift is flagged by the telemetry thread
+    if(reconfigure_on_next.exchange(false)) {
+        // Force a new initiate even if no settings changed
+        configCache.Aborted();
         Reconfigure(s, t);
-        reconfigure_on_next = false;
     }
 
     // Manually handle some errors, and populate variables in the event of warnings
     lastStatus = bbFetchTrace_32f(id, t->Length(), t->Min(), t->Max());
     if(lastStatus == bbDeviceConnectionErr) {
-        // True connection issue, throw signal
-        // emit connectionIssue() throw warning
-        emit connectionIssues();
+        // True connection issue, recover or signal
+        LoseConnection();
         return false;
     } else if(lastStatus == bbUSBTimeoutErr) {
         // In the event of a timeout, and the device is in a sweep mode, try one more time
@@ -249,7 +307,7 @@ bool DeviceBB60A::GetSweep(const SweepSettings *s, Trace *t)
             lastStatus = bbFetchTrace_32f(id, t->Length(), t->Min(), t->Max());
             if(lastStatus < bbNoError) {
                 // Second error in a row, disconnect device with issues
-                emit connectionIssues();
+                LoseConnection();
                 return false;
             }
         }
@@ -262,6 +320,7 @@ bool DeviceBB60A::GetSweep(const SweepSettings *s, Trace *t)
         adc_overflow = false;
     }
 
+    SampleIfDue();
     return true;
 }
 
@@ -269,22 +328,11 @@ bool DeviceBB60A::GetRealTimeFrame(Trace &t, RealTimeFrame &frame)
 {
     Q_ASSERT(frame.alphaFrame.size() == rtFrameSize.width() * rtFrameSize.height());
     Q_ASSERT(frame.rgbFrame.size() == frame.alphaFrame.size() * 4);
-
-    // Get new diagnostic info, determine whether to update the
-    //  diagnostic string
-    UpdateDiagnostics();
-
-    // Print new diagnostics only when a value changed
-    if(update_diagnostics_string) {
-        QString diagnostics;
-        diagnostics.sprintf("%.2f C  --  %.2f V", CurrentTemp(), Voltage());
-        MainWindow::GetStatusBar()->SetDiagnostics(diagnostics);
-        update_diagnostics_string = false;
-    }
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
 
     lastStatus = bbFetchRealTimeFrame(id, t.Max(), &frame.alphaFrame[0]);
     if(lastStatus == bbDeviceConnectionErr || lastStatus == bbUSBTimeoutErr) {
-        emit connectionIssues();
+        LoseConnection();
         return false;
     }
 
@@ -292,29 +340,19 @@ bool DeviceBB60A::GetRealTimeFrame(Trace &t, RealTimeFrame &frame)
 
     // Real-time only returns a max or avg trace
     // Copy max into min for real-time
-    for(int i = 0; i < t.Length(); i++) {
-        t.Min()[i] = t.Max()[i];
-    }
-
-    // Convert the alpha/intensity frame to a 4 channel image
-    int totalPixels = frame.dim.height() * frame.dim.width();
-    for(int i = 0; i < totalPixels; i++) {
-        int toSet = frame.alphaFrame[i] * 255;
-        if(toSet > 255) toSet = 255;
-        frame.rgbFrame[i*4] = frame.rgbFrame[i*4+1] = frame.rgbFrame[i*4+2] = toSet;
-        if(frame.alphaFrame[i] > 0.0) {
-            frame.rgbFrame[i*4+3] = 255;
-        } else {
-            frame.rgbFrame[i*4+3] = 0;
-        }
-    }
+    simdCopy_32f(t.Max(), t.Min(), t.Length());
 
+    SampleIfDue();
     return true;
 }
 
 bool DeviceBB60A::Reconfigure(const DemodSettings *ds, IQDescriptor *desc)
-{   
+{
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+
     Abort();
+    // Streaming overwrites the sweep configuration
+    configCache.Invalidate();
 
     int gain = ds->Gain() - 1, atten = (ds->Atten() - 1) * 10.0;
     if(gain < 0) gain = BB_AUTO_GAIN;
@@ -361,19 +399,22 @@ bool DeviceBB60A::Reconfigure(const DemodSettings *ds, IQDescriptor *desc)
     desc->timeDelta = 1.0 / (double)desc->sampleRate;
     desc->decimation = decimation;
 
+    ConfigApplied(ds);
     return true;
 }
 
 bool DeviceBB60A::GetIQ(IQCapture *iqc)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     lastStatus = bbFetchRaw(id, (float*)(&iqc->capture[0]), iqc->triggers);
     // Handle connection issues
     if(lastStatus == bbDeviceConnectionErr || lastStatus == bbUSBTimeoutErr || lastStatus == bbPacketFramingErr) {
-        emit connectionIssues();
+        LoseConnection();
         return false;
     }
     adc_overflow = (lastStatus == bbADCOverflow);
 
+    SampleIfDue();
     return true;
 }
 
@@ -403,7 +444,11 @@ bool DeviceBB60A::ConfigureForTRFL(double center,
                                    int gain,
                                    IQDescriptor &desc)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+
     Abort();
+    // Streaming overwrites the sweep configuration
+    configCache.Invalidate();
 
     int port_one_mask;
     switch(timebase_reference) {
@@ -444,11 +489,16 @@ bool DeviceBB60A::ConfigureForTRFL(double center,
     desc.timeDelta = 1.0 / (double)desc.sampleRate;
     desc.decimation = 128;
 
+    ConfigApplied(center, range, atten, gain);
     return true;
 }
 
 bool DeviceBB60A::ConfigureAudio(const AudioSettings &as)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+
+    configCache.Invalidate();
+
     lastStatus = bbConfigureDemod(
                 id,
                 as.AudioMode(),
@@ -466,28 +516,26 @@ bool DeviceBB60A::ConfigureAudio(const AudioSettings &as)
         last_audio_freq = as.CenterFreq();
     }
 
+    ConfigApplied(as);
     return true;
 }
 
 bool DeviceBB60A::GetAudio(float *audio)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     lastStatus = bbFetchAudio(id, audio);
 
+    SampleIfDue();
     return true;
 }
 
+// Between fetches or on an idle device, see Device::StartTelemetry()
 void DeviceBB60A::UpdateDiagnostics()
 {
     float temp_now, voltage_now, current_now;
     bbGetDeviceDiagnostics(id, &temp_now, &voltage_now, &current_now);
 
-    if((temp_now != current_temp) || (voltage_now != voltage) || (current_now != current)) {
-        update_diagnostics_string = true;
-    }
-
-    current_temp = temp_now;
-    voltage = voltage_now;
-    current = current_now;
+    telemetry.Publish(temp_now, voltage_now, current_now);
 }
 
 const char* DeviceBB60A::GetLastStatusString() const
@@ -505,11 +553,11 @@ QString DeviceBB60A::GetDeviceString() const {
 bool DeviceBB60A::IsPowered() const
 {
     if(device_type == BB_DEVICE_BB60A) {
-        if(voltage < 4.4) {
+        if(Voltage() < 4.4) {
             return false;
         }
     } else if(device_type == BB_DEVICE_BB60C) {
-        if(voltage < 4.45) {
+        if(Voltage() < 4.45) {
             return false;
         }
     }
@@ -2,6 +2,7 @@
 #define DEVICE_BB60A_H
 
 #include "device.h"
+#include "device_config.h"
 
 class Preferences;
 
@@ -34,7 +35,7 @@ public:
     virtual QString GetDeviceString() const;
     virtual void UpdateDiagnostics();
     virtual bool IsPowered() const;
-    virtual bool NeedsTempCal() const { return fabs(last_temp - current_temp) > 2; }
+    virtual bool NeedsTempCal() const { return fabs(last_temp - CurrentTemp()) > 2; }
 
     virtual int MsPerIQCapture() const { return 26; }
 
@@ -45,6 +46,8 @@ public:
     }
 
 private:
+    DeviceConfigCache configCache;
+
     // Controls whether or not we need to reinitialize the device when
     //   setting a new audio configuration
     double last_audio_freq;
@@ -0,0 +1,133 @@
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include <map>
+#include <tuple>
+
+#include "lib/macros.h"
+
+// Sweep parameters exactly as handed to the device API
+// Fields a device does not use are left at zero
+struct SweepConfig {
+    SweepConfig() :
+        mode(0), portOne(0), portTwo(0),
+        detector(0), scale(0),
+        center(0.0), span(0.0),
+        refLevel(0.0), atten(0), gain(0), preamp(0),
+        rbw(0.0), vbw(0.0), sweepTime(0.0), rbwType(0), rejection(0),
+        procUnits(0),
+        rtRange(0.0), rtFrameRate(0),
+        tgSweepSize(0), tgHighRange(0), tgPassive(0) {}
+
+    int mode; // Initiate mode
+    int portOne, portTwo;
+    int detector, scale;
+    double center, span;
+    double refLevel;
+    int atten, gain, preamp;
+    double rbw, vbw, sweepTime;
+    int rbwType, rejection;
+    int procUnits;
+    double rtRange;
+    int rtFrameRate;
+    int tgSweepSize, tgHighRange, tgPassive;
+
+    bool operator==(const SweepConfig &other) const { return Tie() == other.Tie(); }
+    bool operator!=(const SweepConfig &other) const { return !(*this == other); }
+    bool operator<(const SweepConfig &other) const { return Tie() < other.Tie(); }
+
+private:
+#define SWEEP_CONFIG_FIELDS mode, portOne, portTwo, detector, scale, \
+    center, span, refLevel, atten, gain, preamp, \
+    rbw, vbw, sweepTime, rbwType, rejection, procUnits, \
+    rtRange, rtFrameRate, tgSweepSize, tgHighRange, tgPassive
+
+    auto Tie() const -> decltype(std::tie(SWEEP_CONFIG_FIELDS)) {
+        return std::tie(SWEEP_CONFIG_FIELDS);
+    }
+
+#undef SWEEP_CONFIG_FIELDS
+};
+
+// Sweep geometry queried from the device after initiating
+struct SweepInfo {
+    SweepInfo() :
+        traceSize(0), binSize(0.0), startFreq(0.0),
+        rtWidth(0), rtHeight(0) {}
+
+    int traceSize;
+    double binSize, startFreq;
+    int rtWidth, rtHeight; // Real-time frame size, 0 if not real-time
+};
+
+/*
+ * Tracks the sweep configuration last applied to a device so
+ *   Reconfigure() only issues the API calls for values which changed,
+ *   and skips the abort/initiate cycle entirely when nothing did.
+ * Also caches the sweep geometry per configuration, measurements such
+ *   as harmonics cycle through the same few configurations and would
+ *   otherwise query the device each time.
+ * Anything which configures the device outside of the sweep path
+ *   (streaming, audio, preset) must call Invalidate().
+ */
+class DeviceConfigCache {
+public:
+    DeviceConfigCache() : applied(false), initiated(false) {}
+    ~DeviceConfigCache() {}
+
+    // Last configuration applied, nullptr if the device state is unknown
+    const SweepConfig* Applied() const { return applied ? &last : nullptr; }
+    // True if the device is sweeping with exactly this configuration
+    bool IsActive(const SweepConfig &c) const { return initiated && applied && last == c; }
+
+    // Call after the configuration was applied and initiated
+    void SetApplied(const SweepConfig &c)
+    {
+        last = c;
+        applied = true;
+        initiated = true;
+    }
+
+    // Settings are retained by the device but it must be initiated again
+    void Aborted() { initiated = false; }
+    // Device settings unknown, issue every call on the next reconfigure
+    void Invalidate() { applied = initiated = false; }
+    // Device closed or preset, cached geometry no longer applies
+    void Clear()
+    {
+        Invalidate();
+        infoCache.clear();
+    }
+
+    bool LookupInfo(const SweepConfig &c, SweepInfo &info) const
+    {
+        auto it = infoCache.find(c);
+        if(it == infoCache.end()) {
+            return false;
+        }
+        info = it->second;
+        return true;
+    }
+
+    void StoreInfo(const SweepConfig &c, const SweepInfo &info)
+    {
+        // Stepping through spans can create an unbounded number of entries
+        if((int)infoCache.size() >= MAX_INFO_ENTRIES) {
+            infoCache.clear();
+        }
+        infoCache[c] = info;
+    }
+
+    static const int MAX_INFO_ENTRIES = 64;
+
+private:
+    SweepConfig last;
+    bool applied;
+    bool initiated;
+    std::map<SweepConfig, SweepInfo> infoCache;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(DeviceConfigCache)
+};
+
+#endif // DEVICE_CONFIG_H
@@ -0,0 +1,521 @@
+#include "device_group.h"
+#include "device_bb60a.h"
+#include "device_sa.h"
+#include "device_sim.h"
+
+const double DeviceGroup::MIN_SEGMENT_SPAN = 100.0e6;
+const double DeviceGroup::SEGMENT_OVERLAP = 0.02;
+
+DeviceGroup::DeviceGroup(const Preferences *preferences,
+                         DeviceSeries memberSeries,
+                         const QList<int> &memberSerials) :
+    Device(preferences),
+    series(memberSeries),
+    serials(memberSerials),
+    segmented(false),
+    stitchedLen(0),
+    jobRound(0),
+    jobsPending(0),
+    workersRunning(false)
+{
+    id = -1;
+    open = false;
+    serial_number = 0;
+    timebase_reference = TIMEBASE_INTERNAL;
+
+    Q_ASSERT(!serials.empty());
+
+    for(int i = 0; i < serials.size(); i++) {
+        Segment *seg = new Segment;
+        if(series == saSeries) {
+            seg->device = new DeviceSA(preferences);
+        } else if(series == simSeries) {
+            seg->device = new DeviceSim(preferences);
+        } else {
+            seg->device = new DeviceBB60A(preferences);
+        }
+        // Members never signal, a lost member is a lost group, see
+        //   MemberCheck()
+        seg->device->SetAutoRecover(true);
+        segments.push_back(seg);
+    }
+}
+
+DeviceGroup::~DeviceGroup()
+{
+    CloseDevice();
+
+    for(Segment *seg : segments) {
+        delete seg->device;
+        delete seg;
+    }
+}
+
+bool DeviceGroup::OpenDevice()
+{
+    return OpenDeviceWithSerial(0);
+}
+
+bool DeviceGroup::OpenDeviceWithSerial(int)
+{
+    if(open) {
+        return true;
+    }
+
+    for(int i = 0; i < (int)segments.size(); i++) {
+        Device *d = segments[i]->device;
+        if(!d->OpenDeviceWithSerial(serials[i])) {
+            lastStatus = d->GetLastStatusString();
+            for(int j = 0; j < i; j++) {
+                segments[j]->device->CloseDevice();
+            }
+            return false;
+        }
+    }
+
+    device_type = Primary()->GetDeviceType();
+    serial_number = Primary()->SerialNumber();
+    serial_string.clear();
+    for(Segment *seg : segments) {
+        if(!serial_string.isEmpty()) {
+            serial_string += ", ";
+        }
+        serial_string += seg->device->SerialString();
+    }
+    firmware_string = Primary()->FirmwareString();
+
+    StartWorkers();
+    StartTelemetry();
+
+    open = true;
+    return true;
+}
+
+int DeviceGroup::GetNativeDeviceType() const
+{
+    return Primary()->GetNativeDeviceType();
+}
+
+bool DeviceGroup::CloseDevice()
+{
+    if(!open) {
+        return false;
+    }
+
+    StopTelemetry();
+    StopWorkers();
+
+    for(Segment *seg : segments) {
+        seg->device->CloseDevice();
+    }
+
+    open = false;
+    segmented = false;
+    serial_number = 0;
+
+    return true;
+}
+
+bool DeviceGroup::Abort()
+{
+    bool ok = true;
+    for(Segment *seg : segments) {
+        ok &= seg->device->Abort();
+    }
+    return ok;
+}
+
+bool DeviceGroup::Preset()
+{
+    if(!open) {
+        return false;
+    }
+
+    StopTelemetry();
+    StopWorkers();
+
+    // Members which need it close themselves during preset
+    for(Segment *seg : segments) {
+        seg->device->Preset();
+    }
+    for(Segment *seg : segments) {
+        if(seg->device->IsOpen()) {
+            seg->device->CloseDevice();
+        }
+    }
+
+    open = false;
+    segmented = false;
+    return true;
+}
+
+bool DeviceGroup::Reconfigure(const SweepSettings *s, Trace *t)
+{
+    int n = segments.size();
+    double start = s->Start(), stop = s->Stop();
+    double width = (stop - start) / n;
+
+    segmented = (s->Mode() == MODE_SWEEPING) && (width >= MIN_SEGMENT_SPAN);
+    if(!segmented) {
+        AbortSecondaries();
+        if(!Primary()->Reconfigure(s, t)) {
+            return false;
+        }
+        ConfigApplied(s);
+        return true;
+    }
+
+    // Sweep each segment slightly wider than the part it contributes
+    double overlap = bb_lib::max2(width * SEGMENT_OVERLAP, 10.0 * s->RBW().Val());
+    for(int i = 0; i < n; i++) {
+        Segment *seg = segments[i];
+        double segStart = start + i * width - overlap;
+        double segStop = start + (i + 1) * width + overlap;
+        bb_lib::clamp(segStart, device_traits::min_frequency(), device_traits::max_frequency());
+        bb_lib::clamp(segStop, device_traits::min_frequency(), device_traits::max_frequency());
+
+        seg->settings = *s;
+        seg->settings.SetSegmentRange(segStart, segStop);
+    }
+
+    if(!RunOnAll([](Segment &seg) {
+                 return seg.device->Reconfigure(&seg.settings, &seg.trace); })) {
+        for(Segment *seg : segments) {
+            if(!seg->ok) {
+                lastStatus = seg->device->GetLastStatusString();
+                break;
+            }
+        }
+        segmented = false;
+        return false;
+    }
+
+    // Members configured identically except for frequency produce the
+    //   same bin size, the finest one is used in case they do not
+    double binSize = segments[0]->trace.BinSize();
+    for(Segment *seg : segments) {
+        binSize = bb_lib::min2(binSize, seg->trace.BinSize());
+    }
+    stitchedLen = (int)((stop - start) / binSize) + 1;
+
+    // Map every stitched bin to the nearest bin of the segment which
+    //   owns its frequency, members do not share a bin grid
+    for(int i = 0; i < n; i++) {
+        Segment *seg = segments[i];
+        double ownStart = start + i * width;
+        double ownStop = (i == n - 1) ? stop + binSize : ownStart + width;
+
+        seg->dstStart = (i == 0) ? 0 : segments[i-1]->dstStop;
+        seg->dstStop = bb_lib::min2((int)ceil((ownStop - start) / binSize), stitchedLen);
+        if(seg->dstStop < seg->dstStart) {
+            seg->dstStop = seg->dstStart;
+        }
+
+        const Trace &src = seg->trace;
+        seg->srcIndex.resize(seg->dstStop - seg->dstStart);
+        for(int k = seg->dstStart; k < seg->dstStop; k++) {
+            double f = start + k * binSize;
+            int j = (int)floor((f - src.StartFreq()) / src.BinSize() + 0.5);
+            bb_lib::clamp(j, 0, src.Length() - 1);
+            seg->srcIndex[k - seg->dstStart] = j;
+        }
+
+        // And every segment bin to the stitched bin it lands in, so no
+        //   bin is skipped when the grids differ
+        seg->srcStart = src.Length();
+        seg->dstIndex.clear();
+        for(int j = 0; j < src.Length(); j++) {
+            double f = src.StartFreq() + j * src.BinSize();
+            int k = (int)floor((f - start) / binSize + 0.5);
+            if(k < seg->dstStart || k >= seg->dstStop) {
+                if(!seg->dstIndex.empty()) break;
+                continue;
+            }
+            if(seg->dstIndex.empty()) seg->srcStart = j;
+            seg->dstIndex.push_back(k);
+        }
+    }
+
+    t->SetSettings(*s);
+    t->SetSize(stitchedLen);
+    t->SetFreq(binSize, start);
+    t->SetUpdateRange(0, stitchedLen);
+
+    ConfigApplied(s);
+    return true;
+}
+
+bool DeviceGroup::GetSweep(const SweepSettings *s, Trace *t)
+{
+    if(!segmented) {
+        return MemberCheck(Primary()->GetSweep(s, t));
+    }
+
+    if(!RunOnAll([](Segment &seg) {
+                 return seg.device->GetSweep(&seg.settings, &seg.trace); })) {
+        return MemberCheck(false);
+    }
+
+    Stitch(t);
+
+    adc_overflow = false;
+    for(Segment *seg : segments) {
+        adc_overflow |= seg->device->ADCOverflow();
+    }
+
+    t->SetUpdateRange(0, t->Length());
+    t->SetTime(bb_lib::get_ms_since_epoch());
+
+    return true;
+}
+
+// Segment traces persist between sweeps, so bins outside a partial
+//   (SA fast sweep) update still hold the previous sweep
+// Each stitched bin takes its nearest segment bin, then the max and
+//   min of every segment bin landing in it, so narrow peaks survive
+//   a coarser stitched grid
+void DeviceGroup::Stitch(Trace *t)
+{
+    Q_ASSERT(t->Length() == stitchedLen);
+
+    float *dstMin = t->Min(), *dstMax = t->Max();
+    for(Segment *seg : segments) {
+        const float *srcMin = seg->trace.Min(), *srcMax = seg->trace.Max();
+        const int *ix = &seg->srcIndex[0];
+        int count = seg->dstStop - seg->dstStart;
+        float *outMin = dstMin + seg->dstStart, *outMax = dstMax + seg->dstStart;
+
+        for(int k = 0; k < count; k++) {
+            outMin[k] = srcMin[ix[k]];
+            outMax[k] = srcMax[ix[k]];
+        }
+
+        const int *dst = seg->dstIndex.empty() ? nullptr : &seg->dstIndex[0];
+        int mapped = seg->dstIndex.size();
+        srcMin += seg->srcStart;
+        srcMax += seg->srcStart;
+        for(int j = 0; j < mapped; j++) {
+            dstMin[dst[j]] = bb_lib::min2(dstMin[dst[j]], srcMin[j]);
+            dstMax[dst[j]] = bb_lib::max2(dstMax[dst[j]], srcMax[j]);
+        }
+    }
+}
+
+bool DeviceGroup::GetRealTimeFrame(Trace &t, RealTimeFrame &frame)
+{
+    bool ok = Primary()->GetRealTimeFrame(t, frame);
+    adc_overflow = Primary()->ADCOverflow();
+    return MemberCheck(ok);
+}
+
+bool DeviceGroup::Reconfigure(const DemodSettings *s, IQDescriptor *iqc)
+{
+    segmented = false;
+    AbortSecondaries();
+    if(!Primary()->Reconfigure(s, iqc)) {
+        return false;
+    }
+    ConfigApplied(s);
+    return true;
+}
+
+bool DeviceGroup::GetIQ(IQCapture *iqc)
+{
+    bool ok = Primary()->GetIQ(iqc);
+    adc_overflow = Primary()->ADCOverflow();
+    return MemberCheck(ok);
+}
+
+bool DeviceGroup::GetIQFlush(IQCapture *iqc, bool sync)
+{
+    bool ok = Primary()->GetIQFlush(iqc, sync);
+    adc_overflow = Primary()->ADCOverflow();
+    return MemberCheck(ok);
+}
+
+bool DeviceGroup::ConfigureForTRFL(double center, MeasRcvrRange range,
+                                   int atten, int gain, IQDescriptor &desc)
+{
+    segmented = false;
+    AbortSecondaries();
+    if(!Primary()->ConfigureForTRFL(center, range, atten, gain, desc)) {
+        return false;
+    }
+    ConfigApplied(center, range, atten, gain);
+    return true;
+}
+
+bool DeviceGroup::ConfigureAudio(const AudioSettings &as)
+{
+    segmented = false;
+    AbortSecondaries();
+    if(!Primary()->ConfigureAudio(as)) {
+        return false;
+    }
+    ConfigApplied(as);
+    return true;
+}
+
+bool DeviceGroup::GetAudio(float *audio)
+{
+    return MemberCheck(Primary()->GetAudio(audio));
+}
+
+const char* DeviceGroup::GetLastStatusString() const
+{
+    if(!lastStatus.isEmpty()) {
+        return lastStatus.constData();
+    }
+    return Primary()->GetLastStatusString();
+}
+
+QString DeviceGroup::GetDeviceString() const
+{
+    QString str;
+    str.sprintf(" x%d", (int)segments.size());
+    return Primary()->GetDeviceString() + str;
+}
+
+// Report the hottest member and lowest supply
+void DeviceGroup::UpdateDiagnostics()
+{
+    float temp = Primary()->CurrentTemp();
+    float voltage = Primary()->Voltage();
+    for(Segment *seg : segments) {
+        temp = bb_lib::max2(temp, seg->device->CurrentTemp());
+        voltage = bb_lib::min2(voltage, seg->device->Voltage());
+    }
+
+    telemetry.Publish(temp, voltage);
+}
+
+// Every member must be present to reopen the group
+bool DeviceGroup::IsEnumerated(int) const
+{
+    for(int i = 0; i < (int)segments.size(); i++) {
+        if(!segments[i]->device->IsEnumerated(serials[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeviceGroup::IsPowered() const
+{
+    for(Segment *seg : segments) {
+        if(!seg->device->IsPowered()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int DeviceGroup::SetTimebase(int new_val)
+{
+    for(Segment *seg : segments) {
+        timebase_reference = seg->device->SetTimebase(new_val);
+    }
+    return timebase_reference;
+}
+
+bool DeviceGroup::MemberCheck(bool ok)
+{
+    if(!ok) {
+        for(Segment *seg : segments) {
+            if(seg->device->ConnectionLost()) {
+                LoseConnection();
+                break;
+            }
+        }
+    }
+    return ok;
+}
+
+void DeviceGroup::AbortSecondaries()
+{
+    for(int i = 1; i < (int)segments.size(); i++) {
+        segments[i]->device->Abort();
+    }
+}
+
+bool DeviceGroup::RunOnAll(std::function<bool(Segment&)> job)
+{
+    std::unique_lock<std::mutex> lg(jobLock);
+
+    // Closed or preset, nobody would pick the job up
+    if(!workersRunning) {
+        lg.unlock();
+        bool ok = true;
+        for(Segment *seg : segments) {
+            seg->ok = job(*seg);
+            ok &= seg->ok;
+        }
+        return ok;
+    }
+
+    currentJob = job;
+    jobsPending = segments.size();
+    jobRound++;
+    jobCond.notify_all();
+
+    doneCond.wait(lg, [this]{ return jobsPending == 0; });
+    currentJob = nullptr;
+
+    bool ok = true;
+    for(Segment *seg : segments) {
+        ok &= seg->ok;
+    }
+    return ok;
+}
+
+// One thread per member, so the device calls of all members
+//   block concurrently
+void DeviceGroup::WorkerThread(Segment *seg)
+{
+    int lastRound = 0;
+    std::unique_lock<std::mutex> lg(jobLock);
+
+    while(true) {
+        jobCond.wait(lg, [&]{ return !workersRunning || jobRound != lastRound; });
+        if(!workersRunning) {
+            return;
+        }
+        lastRound = jobRound;
+        std::function<bool(Segment&)> job = currentJob;
+
+        lg.unlock();
+        seg->ok = job(*seg);
+        lg.lock();
+
+        if(--jobsPending == 0) {
+            doneCond.notify_one();
+        }
+    }
+}
+
+void DeviceGroup::StartWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lg(jobLock);
+        workersRunning = true;
+        jobRound = 0;
+    }
+
+    for(Segment *seg : segments) {
+        workers.push_back(std::thread(&DeviceGroup::WorkerThread, this, seg));
+    }
+}
+
+void DeviceGroup::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lg(jobLock);
+        workersRunning = false;
+    }
+    jobCond.notify_all();
+
+    for(std::thread &w : workers) {
+        w.join();
+    }
+    workers.clear();
+}
@@ -0,0 +1,126 @@
+#ifndef DEVICE_GROUP_H
+#define DEVICE_GROUP_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include <QByteArray>
+
+#include "device.h"
+
+class Preferences;
+
+/*
+ * Several receivers of the same series presented as one device.
+ * Standard sweeps with a wide enough span are split into one
+ *   frequency segment per receiver, swept concurrently, and stitched
+ *   into a single trace on a common bin grid.
+ * Every other mode (real-time, I/Q, audio, harmonics) runs on the
+ *   first receiver only while the rest sit idle.
+ */
+class DeviceGroup : public Device {
+public:
+    DeviceGroup(const Preferences *preferences,
+                DeviceSeries memberSeries,
+                const QList<int> &memberSerials);
+    virtual ~DeviceGroup();
+
+    // Opens every member, serialToOpen is ignored
+    virtual bool OpenDevice();
+    virtual bool OpenDeviceWithSerial(int serialToOpen);
+    virtual int GetNativeDeviceType() const;
+    virtual bool CloseDevice();
+    virtual bool Abort();
+    virtual bool Preset();
+    // Sweep
+    virtual bool Reconfigure(const SweepSettings *s, Trace *t);
+    virtual bool GetSweep(const SweepSettings *s, Trace *t);
+    virtual bool GetRealTimeFrame(Trace &t, RealTimeFrame &frame);
+    // Stream
+    virtual bool Reconfigure(const DemodSettings *s, IQDescriptor *iqc);
+    virtual bool GetIQ(IQCapture *iqc);
+    virtual bool GetIQFlush(IQCapture *iqc, bool sync);
+    virtual bool ConfigureForTRFL(double center, MeasRcvrRange range,
+                                  int atten, int gain, IQDescriptor &desc);
+    virtual bool ConfigureAudio(const AudioSettings &as);
+    virtual bool GetAudio(float *audio);
+
+    virtual const char* GetLastStatusString() const;
+
+    virtual QString GetDeviceString() const;
+    virtual void UpdateDiagnostics();
+    virtual bool IsPowered() const;
+    virtual bool IsEnumerated(int serial) const;
+    virtual bool NeedsTempCal() const { return false; }
+    virtual bool IsSimulated() const { return Primary()->IsSimulated(); }
+
+    virtual int MsPerIQCapture() const { return Primary()->MsPerIQCapture(); }
+    virtual int SetTimebase(int new_val);
+
+    int MemberCount() const { return segments.size(); }
+    DeviceSeries MemberSeries() const { return series; }
+    const QList<int>& MemberSerials() const { return serials; }
+    // True when the last sweep configuration was split across members
+    bool IsSegmented() const { return segmented; }
+
+    // Spans narrower than this per member are swept by one device
+    static const double MIN_SEGMENT_SPAN;
+    // Each segment is swept this fraction wider on both sides and the
+    //   edges discarded, hiding the roll-off at the band edges
+    static const double SEGMENT_OVERLAP;
+
+private:
+    struct Segment {
+        Segment() : device(nullptr), trace(true),
+            dstStart(0), dstStop(0), srcStart(0), ok(false) {}
+
+        Device *device;
+        SweepSettings settings;
+        Trace trace;
+        // Stitched trace bins [dstStart,dstStop) come from this segment,
+        //   srcIndex holds the nearest segment bin of each
+        int dstStart, dstStop;
+        std::vector<int> srcIndex;
+        // Segment bins [srcStart, srcStart + dstIndex.size()) fall in
+        //   the stitched bins, dstIndex holds the stitched bin of each
+        int srcStart;
+        std::vector<int> dstIndex;
+        bool ok;
+    };
+
+    Device* Primary() const { return segments.front()->device; }
+    // Run job on every segment concurrently, returns when all finished
+    // Runs the jobs one after another while the workers are stopped
+    // Returns false if any job returned false
+    bool RunOnAll(std::function<bool(Segment&)> job);
+    void WorkerThread(Segment *seg);
+    void StartWorkers();
+    void StopWorkers();
+    void Stitch(Trace *t);
+    void AbortSecondaries();
+    // Pass through a member result, losing the group connection if
+    //   a member lost its connection
+    bool MemberCheck(bool ok);
+
+    DeviceSeries series;
+    QList<int> serials;
+    std::vector<Segment*> segments;
+    bool segmented;
+    int stitchedLen;
+    QByteArray lastStatus;
+
+    std::vector<std::thread> workers;
+    std::mutex jobLock;
+    std::condition_variable jobCond, doneCond;
+    std::function<bool(Segment&)> currentJob;
+    int jobRound;
+    int jobsPending;
+    bool workersRunning;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(DeviceGroup)
+};
+
+#endif // DEVICE_GROUP_H
@@ -55,12 +55,12 @@ bool DeviceSA::OpenDevice()
         device_type = DeviceTypeSA124;
     }
 
-    saQueryTemperature(id, &current_temp);
-    QString diagnostics;
-    diagnostics.sprintf("%.2f C", CurrentTemp());
-    MainWindow::GetStatusBar()->SetDiagnostics(diagnostics);
+    float temp;
+    saQueryTemperature(id, &temp);
+    telemetry.Publish(temp);
 
     open = true;
+    StartTelemetry();
     return true;
 }
 
@@ -93,17 +93,18 @@ bool DeviceSA::OpenDeviceWithSerial(int serialToOpen)
         device_type = DeviceTypeSA124;
     }
 
-    saQueryTemperature(id, &current_temp);
-    QString diagnostics;
-    diagnostics.sprintf("%.2f C", CurrentTemp());
-    MainWindow::GetStatusBar()->SetDiagnostics(diagnostics);
+    float temp;
+    saQueryTemperature(id, &temp);
+    telemetry.Publish(temp);
 
     open = true;
+    StartTelemetry();
     return true;
 }
 
 int DeviceSA::GetNativeDeviceType() const
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     if(!open) {
         return (int)saDeviceTypeSA44B;
     }
@@ -136,7 +137,11 @@ bool DeviceSA::IsTgAttached()
 
 bool DeviceSA::CloseDevice()
 {
+    // Telemetry thread must not query a closed handle
+    StopTelemetry();
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     saCloseDevice(id);
+    configCache.Clear();
 
     id = -1;
     open = false;
@@ -148,6 +153,8 @@ bool DeviceSA::CloseDevice()
 
 bool DeviceSA::Abort()
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+    configCache.Aborted();
     saAbort(id);
     return true;
 }
@@ -159,77 +166,137 @@ bool DeviceSA::Preset()
         return false;
     }
 
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     saAbort(id);
     saPreset(id);
+    configCache.Clear();
 
     return true;
 }
 
 bool DeviceSA::Reconfigure(const SweepSettings *s, Trace *t)
-{   
-    Abort();
-    tgCalState = tgCalStateUncalibrated;
-
-    // Update temperature between configurations
-    QString diagnostics;
-    if(deviceType != saDeviceTypeSA44) {
-        saQueryTemperature(id, &current_temp);
-        saQueryDiagnostics(id, &voltage);
-        diagnostics.sprintf("%.2f C  --  %.2f V", CurrentTemp(), Voltage());
-    }
-    MainWindow::GetStatusBar()->SetDiagnostics(diagnostics);
+{
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
 
+    SweepConfig c;
     int atten = (s->Atten() == 0) ? SA_AUTO_ATTEN : s->Atten() - 1;
     int gain = (s->Gain() == 0) ? SA_AUTO_GAIN : s->Gain() - 1;
     bool preamp = (s->Preamp() == 2);
-    int scale = (s->RefLevel().IsLogScale() ? SA_LOG_SCALE : SA_LIN_SCALE);
-
-    saConfigCenterSpan(id, s->Center(), s->Span());
-    saConfigAcquisition(id, s->Detector(), scale);
-
     if(atten == SA_AUTO_ATTEN || gain == SA_AUTO_GAIN) {
-        saConfigLevel(id, s->RefLevel().ConvertToUnits(AmpUnits::DBM));
-        saConfigGainAtten(id, SA_AUTO_ATTEN, SA_AUTO_GAIN, true);
+        c.refLevel = s->RefLevel().ConvertToUnits(AmpUnits::DBM);
+        c.atten = SA_AUTO_ATTEN;
+        c.gain = SA_AUTO_GAIN;
+        c.preamp = true;
     } else {
-        saConfigGainAtten(id, atten, gain, preamp);
+        c.atten = atten;
+        c.gain = gain;
+        c.preamp = preamp;
     }
-
-    saConfigSweepCoupling(id, s->RBW(), s->VBW(), s->Rejection());
-    saConfigProcUnits(id, s->ProcessingUnits());
-
-    int init_mode = SA_SWEEPING;
+    c.scale = (s->RefLevel().IsLogScale() ? SA_LOG_SCALE : SA_LIN_SCALE);
+    c.detector = s->Detector();
+    c.center = s->Center();
+    c.span = s->Span();
+    c.rbw = s->RBW();
+    c.vbw = s->VBW();
+    c.rejection = s->Rejection();
+    c.procUnits = s->ProcessingUnits();
+
+    c.mode = SA_SWEEPING;
     if(s->Mode() == BB_REAL_TIME) {
-        saConfigRealTime(id, s->Div() * 10.0, prefs->realTimeFrameRate);
-        init_mode = SA_REAL_TIME;
+        c.rtRange = s->Div() * 10.0;
+        c.rtFrameRate = prefs->realTimeFrameRate;
+        c.mode = SA_REAL_TIME;
     }
     if(s->Mode() == MODE_NETWORK_ANALYZER) {
-        saConfigTgSweep(id, s->tgSweepSize, s->tgHighRangeSweep, s->tgPassiveDevice);
-        init_mode = SA_TG_SWEEP;
+        c.tgSweepSize = s->tgSweepSize;
+        c.tgHighRange = s->tgHighRangeSweep;
+        c.tgPassive = s->tgPassiveDevice;
+        c.mode = SA_TG_SWEEP;
+        // Every reconfigure restarts the tracking generator calibration
+        configCache.Aborted();
     }
 
-    saStatus initStatus = saInitiate(id, init_mode, 0);
+    // Already sweeping with these settings, skip the abort/initiate
+    if(!configCache.IsActive(c)) {
+        // Only issue the calls whose parameters changed
+        bool all = (configCache.Applied() == nullptr);
+        SweepConfig p = all ? SweepConfig() : *configCache.Applied();
+
+        Abort();
+        configCache.Invalidate();
+        tgCalState = tgCalStateUncalibrated;
+
+        // Update temperature between configurations
+        UpdateDiagnostics();
+
+        if(all || p.center != c.center || p.span != c.span) {
+            saConfigCenterSpan(id, c.center, c.span);
+        }
+        if(all || p.detector != c.detector || p.scale != c.scale) {
+            saConfigAcquisition(id, c.detector, c.scale);
+        }
+
+        if(all || p.refLevel != c.refLevel || p.atten != c.atten
+                || p.gain != c.gain || p.preamp != c.preamp) {
+            if(c.atten == SA_AUTO_ATTEN) {
+                saConfigLevel(id, c.refLevel);
+                saConfigGainAtten(id, SA_AUTO_ATTEN, SA_AUTO_GAIN, true);
+            } else {
+                saConfigGainAtten(id, c.atten, c.gain, c.preamp);
+            }
+        }
+
+        if(all || p.rbw != c.rbw || p.vbw != c.vbw || p.rejection != c.rejection) {
+            saConfigSweepCoupling(id, c.rbw, c.vbw, c.rejection);
+        }
+        if(all || p.procUnits != c.procUnits) {
+            saConfigProcUnits(id, c.procUnits);
+        }
+
+        if(c.mode == SA_REAL_TIME && (all || p.rtRange != c.rtRange
+                                      || p.rtFrameRate != c.rtFrameRate)) {
+            saConfigRealTime(id, c.rtRange, c.rtFrameRate);
+        }
+        if(c.mode == SA_TG_SWEEP) {
+            saConfigTgSweep(id, c.tgSweepSize, c.tgHighRange, c.tgPassive);
+        }
 
-    int traceLength = 0;
-    double startFreq = 0.0, binSize = 0.0;
-    saQuerySweepInfo(id, &traceLength, &startFreq, &binSize);
+        // On failure leave the state unknown so the next reconfigure
+        //   issues every call again
+        saStatus initStatus = saInitiate(id, c.mode, 0);
+        if(initStatus >= saNoError) {
+            configCache.SetApplied(c);
+        }
+    }
+
+    SweepInfo info;
+    if(!configCache.LookupInfo(c, info)) {
+        saQuerySweepInfo(id, &info.traceSize, &info.startFreq, &info.binSize);
+        if(c.mode == SA_REAL_TIME) {
+            saQueryRealTimeFrameInfo(id, &info.rtWidth, &info.rtHeight);
+        }
+        if(configCache.IsActive(c)) {
+            configCache.StoreInfo(c, info);
+        }
+    }
 
     t->SetSettings(*s);
-    t->SetSize(traceLength);
-    t->SetFreq(binSize, startFreq);
-    t->SetUpdateRange(0, traceLength);
+    t->SetSize(info.traceSize);
+    t->SetFreq(info.binSize, info.startFreq);
+    t->SetUpdateRange(0, info.traceSize);
 
     if(s->Mode() == MODE_REAL_TIME) {
-        int w = 0, h = 0;
-        saQueryRealTimeFrameInfo(id, &w, &h);
-        rtFrameSize.setWidth(w);
-        rtFrameSize.setHeight(h);
+        rtFrameSize.setWidth(info.rtWidth);
+        rtFrameSize.setHeight(info.rtHeight);
     }
 
+    ConfigApplied(s);
     return true;
 }
 
 bool DeviceSA::GetSweep(const SweepSettings *s, Trace *t)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     saStatus status = saNoError;
 
     int startIx, stopIx;
@@ -242,7 +309,7 @@ bool DeviceSA::GetSweep(const SweepSettings *s, Trace *t)
     //stopIx = t->Length();
 
     if(status == saUSBCommErr) {
-        emit connectionIssues();
+        LoseConnection();
         return false;
     }
 
@@ -256,6 +323,7 @@ bool DeviceSA::GetSweep(const SweepSettings *s, Trace *t)
 
     adc_overflow = (status == saCompressionWarning);
 
+    NoteFetch();
     return true;
 }
 
@@ -263,43 +331,34 @@ bool DeviceSA::GetRealTimeFrame(Trace &t, RealTimeFrame &frame)
 {
     Q_ASSERT(frame.alphaFrame.size() == rtFrameSize.width() * rtFrameSize.height());
     Q_ASSERT(frame.rgbFrame.size() == frame.alphaFrame.size() * 4);
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
 
     // TODO check return value, emit error if not good
     saStatus status = saGetRealTimeFrame(id, t.Max(), &frame.alphaFrame[0]);
 
     if(status == saUSBCommErr) {
-        emit connectionIssues();
+        LoseConnection();
         return false;
     }
 
     // Real-time only returns a max or avg trace
     // Copy max into min for real-time
-    for(int i = 0; i < t.Length(); i++) {
-        t.Min()[i] = t.Max()[i];
-    }
-
-    // Convert the alpha/intensity frame to a 4 channel image
-    int totalPixels = frame.dim.height() * frame.dim.width();
-    for(int i = 0; i < totalPixels; i++) {
-        int toSet = frame.alphaFrame[i] * 255;
-        if(toSet > 255) toSet = 255;
-        frame.rgbFrame[i*4] = frame.rgbFrame[i*4+1] = frame.rgbFrame[i*4+2] = toSet;
-        if(frame.alphaFrame[i] > 0.0) {
-            frame.rgbFrame[i*4+3] = 255;
-        } else {
-            frame.rgbFrame[i*4+3] = 0;
-        }
-    }
+    simdCopy_32f(t.Max(), t.Min(), t.Length());
 
     adc_overflow = (status == saCompressionWarning);
 
+    NoteFetch();
     return true;
 }
 
 // I/Q streaming setup
 bool DeviceSA::Reconfigure(const DemodSettings *s, IQDescriptor *iqc)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+
     saAbort(id);
+    // Streaming overwrites the sweep configuration
+    configCache.Invalidate();
 
     int atten = (s->Atten() == 0) ? SA_AUTO_ATTEN : s->Atten() - 1;
     int gain = (s->Gain() == 0) ? SA_AUTO_GAIN : s->Gain() - 1;
@@ -318,20 +377,23 @@ bool DeviceSA::Reconfigure(const DemodSettings *s, IQDescriptor *iqc)
     iqc->timeDelta = 1.0 / iqc->sampleRate;
     iqc->decimation = 1;
 
+    ConfigApplied(s);
     return true;
 }
 
 bool DeviceSA::GetIQ(IQCapture *iqc)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     saStatus status = saGetIQ_32f(id, (float*)(&iqc->capture[0]));
 
     if(status == saUSBCommErr) {
-        emit connectionIssues();
+        LoseConnection();
         return false;
     }
 
     adc_overflow = (status == saCompressionWarning);
 
+    NoteFetch();
     return true;
 }
 
@@ -360,7 +422,10 @@ bool DeviceSA::ConfigureForTRFL(double center,
                                 int gain,
                                 IQDescriptor &desc)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+
     saAbort(id);
+    configCache.Invalidate();
 
     double refLevel;
     switch(range) {
@@ -384,11 +449,15 @@ bool DeviceSA::ConfigureForTRFL(double center,
     desc.timeDelta = 1.0 / desc.sampleRate;
     desc.decimation = 2;
 
+    ConfigApplied(center, range, atten, gain);
     return true;
 }
 
 bool DeviceSA::ConfigureAudio(const AudioSettings &as)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+    configCache.Invalidate();
+
     /*lastStatus = */saConfigAudio(
                 id,
                 as.AudioMode(),
@@ -400,20 +469,23 @@ bool DeviceSA::ConfigureAudio(const AudioSettings &as)
 
     /*lastStatus = */saInitiate(id, SA_AUDIO, 0);
 
+    ConfigApplied(as);
     return true;
 }
 
 bool DeviceSA::GetAudio(float *audio)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     saStatus status = saGetAudio(id, audio);
 
     if(status == saUSBCommErr) {
-        emit connectionIssues();
+        LoseConnection();
         return false;
     }
 
     adc_overflow = (status == saCompressionWarning);
 
+    NoteFetch();
     return true;
 }
 
@@ -432,9 +504,22 @@ QString DeviceSA::GetDeviceString() const
     return "No Device Open";
 }
 
+// The SA API cannot be queried while the device is active, fetches
+//   only note themselves, see Device::NoteFetch(), so the telemetry
+//   thread samples once the device goes idle, and every configuration
+//   samples after its abort
 void DeviceSA::UpdateDiagnostics()
 {
+    if(deviceType == saDeviceTypeSA44) {
+        return;
+    }
 
+    float temp, voltage;
+    if(saQueryTemperature(id, &temp) != saNoError) {
+        return;
+    }
+    saQueryDiagnostics(id, &voltage);
+    telemetry.Publish(temp, voltage);
 }
 
 bool DeviceSA::IsPowered() const
@@ -449,6 +534,7 @@ bool DeviceSA::NeedsTempCal() const
 
 bool DeviceSA::SetTg(Frequency freq, double amp)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     saStatus stat = saSetTg(id, freq, amp);
     if(stat != saNoError) {
         return false;
@@ -459,12 +545,14 @@ bool DeviceSA::SetTg(Frequency freq, double amp)
 
 void DeviceSA::TgStoreThrough()
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     saStoreTgThru(id, TG_THRU_0DB);
     tgCalState = tgCalStatePending;
 }
 
 void DeviceSA::TgStoreThroughPad()
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
     saStoreTgThru(id, TG_THRU_20DB);
 }
 
@@ -505,5 +593,7 @@ void DeviceSA::ConfigureIFOutput(double inputFreq,
                                  int inputAtten,
                                  int outputGain)
 {
+    std::lock_guard<std::recursive_mutex> lg(apiLock);
+    configCache.Invalidate();
     saConfigIFOutput(id, inputFreq, outputFreq, inputAtten, outputGain);
 }
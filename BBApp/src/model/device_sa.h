@@ -4,6 +4,7 @@
 #include <QEventLoop>
 
 #include "device.h"
+#include "device_config.h"
 #include "lib/sa_api.h"
 
 class Preferences;
@@ -75,6 +76,8 @@ private:
         el->exit();
     }
 
+    DeviceConfigCache configCache;
+
     saDeviceType deviceType;
     saStatus lastStatus;
     bool tgIsConnected;
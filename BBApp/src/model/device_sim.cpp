@@ -0,0 +1,666 @@
+#include "device_sim.h"
+#include "preferences.h"
+
+#include <QSettings>
+
+static const double SIM_BASE_SAMPLE_RATE = 40.0e6;
+static const double SIM_AUDIO_RATE = 32000.0;
+static const int SIM_MAX_TRACE_LEN = 16 * 1024 * 1024;
+
+void SimConfig::LoadDefaults()
+{
+    noiseFloor = -158.0;
+    sweepRate = 0.0;
+    scanRate = 0.0;
+    speedFactor = 1.0;
+    groupSize = 4;
+    disconnectInterval = 0.0;
+    disconnectDuration = 5.0;
+
+    signals.clear();
+    signals.push_back(SimSignal(SimSignalTone, 100.0e6, -20.0));
+    SimSignal am(SimSignalAM, 1.0e9, -40.0);
+    am.modRate = 1.0e3;
+    am.modDepth = 0.5;
+    signals.push_back(am);
+    SimSignal fm(SimSignalFM, 2.4e9, -50.0);
+    fm.modRate = 1.0e3;
+    fm.modDepth = 75.0e3;
+    signals.push_back(fm);
+    signals.push_back(SimSignal(SimSignalPulsed, 3.0e9, -30.0));
+}
+
+void SimConfig::Load()
+{
+    QSettings s(QSettings::IniFormat, QSettings::UserScope,
+                "SignalHound", "SimDevice");
+
+    LoadDefaults();
+
+    noiseFloor = s.value("NoiseFloor", noiseFloor).toDouble();
+    sweepRate = s.value("SweepRate", sweepRate).toDouble();
+    scanRate = s.value("ScanRate", scanRate).toDouble();
+    speedFactor = s.value("SpeedFactor", speedFactor).toDouble();
+    groupSize = s.value("GroupSize", groupSize).toInt();
+    disconnectInterval = s.value("DisconnectInterval", disconnectInterval).toDouble();
+    disconnectDuration = s.value("DisconnectDuration", disconnectDuration).toDouble();
+
+    int count = s.beginReadArray("Signals");
+    if(count > 0) {
+        signals.clear();
+        for(int i = 0; i < count; i++) {
+            s.setArrayIndex(i);
+            SimSignal sig;
+            sig.type = (SimSignalType)s.value("Type", sig.type).toInt();
+            sig.freq = s.value("Frequency", sig.freq).toDouble();
+            sig.amplitude = s.value("Amplitude", sig.amplitude).toDouble();
+            sig.modRate = s.value("ModRate", sig.modRate).toDouble();
+            sig.modDepth = s.value("ModDepth", sig.modDepth).toDouble();
+            sig.pulseWidth = s.value("PulseWidth", sig.pulseWidth).toDouble();
+            sig.pulsePeriod = s.value("PulsePeriod", sig.pulsePeriod).toDouble();
+            signals.push_back(sig);
+        }
+    }
+    s.endArray();
+}
+
+void SimConfig::Save() const
+{
+    QSettings s(QSettings::IniFormat, QSettings::UserScope,
+                "SignalHound", "SimDevice");
+
+    s.setValue("NoiseFloor", noiseFloor);
+    s.setValue("SweepRate", sweepRate);
+    s.setValue("ScanRate", scanRate);
+    s.setValue("SpeedFactor", speedFactor);
+    s.setValue("GroupSize", groupSize);
+    s.setValue("DisconnectInterval", disconnectInterval);
+    s.setValue("DisconnectDuration", disconnectDuration);
+
+    s.beginWriteArray("Signals", signals.size());
+    for(int i = 0; i < (int)signals.size(); i++) {
+        s.setArrayIndex(i);
+        s.setValue("Type", (int)signals[i].type);
+        s.setValue("Frequency", signals[i].freq);
+        s.setValue("Amplitude", signals[i].amplitude);
+        s.setValue("ModRate", signals[i].modRate);
+        s.setValue("ModDepth", signals[i].modDepth);
+        s.setValue("PulseWidth", signals[i].pulseWidth);
+        s.setValue("PulsePeriod", signals[i].pulsePeriod);
+    }
+    s.endArray();
+}
+
+DeviceSim::DeviceSim(const Preferences *preferences) :
+    Device(preferences)
+{
+    id = -1;
+    open = false;
+    serial_number = 0;
+    lastStatus = "No Error";
+    adc_overflow = false;
+
+    timebase_reference = TIMEBASE_INTERNAL;
+
+    simTime = 0.0;
+    pacedTime = 0.0;
+    rng = 0x12345678;
+    hasGaussSpare = false;
+    acquisitions = 0;
+    unpluggedUntil = 0;
+
+    detectorAverage = false;
+    linearScale = false;
+
+    iqCenter = 1.0e9;
+    iqSampleRate = SIM_BASE_SAMPLE_RATE;
+    iqReturnLen = IQ_RETURN_LEN;
+
+    audioCenter = 100.0e6;
+    audioBandwidth = 120.0e3;
+    audioPhase = 0.0;
+
+    // Table of 10*log10(exponential) deviates, the dB distribution
+    //   of noise power seen through a single resolution bandwidth
+    noiseTable.resize(NOISE_TABLE_LEN);
+    for(int i = 0; i < NOISE_TABLE_LEN; i++) {
+        double u = (i + 0.5) / NOISE_TABLE_LEN;
+        noiseTable[i] = 10.0 * log10(-log(u));
+    }
+}
+
+DeviceSim::~DeviceSim()
+{
+    CloseDevice();
+}
+
+bool DeviceSim::OpenDevice()
+{
+    return OpenDeviceWithSerial(0);
+}
+
+// Serial numbers only distinguish the members of a simulated group
+bool DeviceSim::OpenDeviceWithSerial(int serialToOpen)
+{
+    if(open) {
+        return true;
+    }
+
+    if(!IsEnumerated(serialToOpen)) {
+        lastStatus = "Device not found";
+        return false;
+    }
+
+    config.Load();
+
+    id = 0;
+    serial_number = serialToOpen;
+    if(serial_number == 0) {
+        serial_string = "Simulated";
+    } else {
+        serial_string.sprintf("Simulated %d", serial_number);
+    }
+    // Independent noise per group member
+    rng = 0x12345678 ^ (serial_number * 0x9E3779B9);
+    if(rng == 0) {
+        rng = 0x12345678;
+    }
+    firmware_string = "N/A  ";
+    device_type = DeviceTypeBB60C;
+
+    UpdateDiagnostics();
+    last_temp = CurrentTemp();
+
+    acquisitions = 0;
+    phase.assign(config.signals.size(), 0.0);
+    connectedTimer.start();
+
+    open = true;
+    return true;
+}
+
+int DeviceSim::GetNativeDeviceType() const
+{
+    return BB_DEVICE_BB60C;
+}
+
+bool DeviceSim::CloseDevice()
+{
+    if(!open) {
+        lastStatus = "Device not open";
+        return false;
+    }
+
+    id = -1;
+    open = false;
+    serial_number = 0;
+
+    return true;
+}
+
+bool DeviceSim::Abort()
+{
+    return open;
+}
+
+bool DeviceSim::Preset()
+{
+    if(!open) {
+        return false;
+    }
+
+    CloseDevice();
+    return true;
+}
+
+void DeviceSim::SetConfig(const SimConfig &newConfig)
+{
+    config = newConfig;
+    phase.assign(config.signals.size(), 0.0);
+}
+
+bool DeviceSim::Reconfigure(const SweepSettings *s, Trace *t)
+{
+    detectorAverage = (s->Detector() == BB_AVERAGE);
+    linearScale = !s->RefLevel().IsLogScale();
+
+    // Roughly the bin spacing of the BB60C non-native bandwidths
+    double binSize = s->RBW() / 3.2;
+    int traceSize = (int)(s->Span() / binSize) + 1;
+    bb_lib::clamp(traceSize, 1, SIM_MAX_TRACE_LEN);
+    binSize = s->Span() / traceSize;
+    double startFreq = s->Center() - s->Span() / 2.0;
+
+    t->SetSettings(*s);
+    t->SetSize(traceSize);
+    t->SetFreq(binSize, startFreq);
+    t->SetUpdateRange(0, traceSize);
+
+    if(s->Mode() == MODE_REAL_TIME) {
+        rtFrameSize.setWidth(traceSize);
+        rtFrameSize.setHeight(RT_FRAME_HEIGHT);
+        rtAccum.assign(traceSize * RT_FRAME_HEIGHT, 0.0);
+    }
+
+    simTime = 0.0;
+    pacedTime = 0.0;
+    paceTimer.start();
+    last_temp = CurrentTemp();
+
+    ConfigApplied(s);
+    return true;
+}
+
+bool DeviceSim::GetSweep(const SweepSettings *s, Trace *t)
+{
+    if(!open) {
+        lastStatus = "Device not open";
+        return false;
+    }
+    if(InjectDisconnect()) {
+        return false;
+    }
+
+    if(reconfigure_on_next.exchange(false)) {
+        Reconfigure(s, t);
+    }
+
+    SynthesizeSpectrum(t->Max(), t->Length(), t->StartFreq(),
+                       t->BinSize(), s->RBW());
+
+    // Min/max detector spreads the noise between the two buffers
+    float spread = detectorAverage ? 0.0 : 3.0;
+    for(int i = 0; i < t->Length(); i++) {
+        t->Min()[i] = t->Max()[i] - spread * Uniform();
+    }
+
+    if(linearScale) {
+        unit_convert_32f(t->Min(), t->Min(), t->Length(), DBM, MV);
+        unit_convert_32f(t->Max(), t->Max(), t->Length(), DBM, MV);
+    }
+
+    t->SetUpdateRange(0, t->Length());
+    t->SetTime(bb_lib::get_ms_since_epoch());
+
+    double sweepTime = bb_lib::max2(s->SweepTime().Val(), 0.001);
+    simTime += sweepTime;
+    double pace = 0.0;
+    if(config.sweepRate > 0.0) {
+        pace += 1.0 / config.sweepRate;
+    }
+    if(config.scanRate > 0.0) {
+        pace += s->Span() / config.scanRate;
+    }
+    if(pace > 0.0) {
+        Pace(pace, 1.0);
+    }
+
+    acquisitions++;
+    return true;
+}
+
+bool DeviceSim::GetRealTimeFrame(Trace &t, RealTimeFrame &frame)
+{
+    Q_ASSERT(frame.alphaFrame.size() == rtFrameSize.width() * rtFrameSize.height());
+    Q_ASSERT(frame.rgbFrame.size() == frame.alphaFrame.size() * 4);
+
+    if(!open) {
+        lastStatus = "Device not open";
+        return false;
+    }
+    if(InjectDisconnect()) {
+        return false;
+    }
+
+    const SweepSettings *s = t.GetSettings();
+    SynthesizeSpectrum(t.Max(), t.Length(), t.StartFreq(), t.BinSize(), s->RBW());
+    if(linearScale) {
+        unit_convert_32f(t.Max(), t.Max(), t.Length(), DBM, MV);
+    }
+
+    // Real-time only returns a max or avg trace
+    // Copy max into min for real-time
+    simdCopy_32f(t.Max(), t.Min(), t.Length());
+
+    // Decay the previous frame and deposit the new trace, row zero
+    //   is the bottom of the graticule
+    int w = frame.dim.width(), h = frame.dim.height();
+    if(rtAccum.size() != frame.alphaFrame.size()) {
+        rtAccum.assign(frame.alphaFrame.size(), 0.0);
+    }
+    for(int i = 0; i < w * h; i++) {
+        rtAccum[i] *= 0.9f;
+    }
+
+    double ref = s->RefLevel().ConvertToUnits(AmpUnits::DBM);
+    double bottom = ref - s->Div() * 10.0;
+    double rowsPerDB = h / (s->Div() * 10.0);
+    const float *src = t.Max();
+    std::vector<float> dbm;
+    if(linearScale) {
+        dbm.resize(t.Length());
+        unit_convert_32f(t.Max(), &dbm[0], t.Length(), MV, DBM);
+        src = &dbm[0];
+    }
+
+    for(int x = 0; x < w && x < t.Length(); x++) {
+        int row = (int)((src[x] - bottom) * rowsPerDB);
+        if(row < 0 || row >= h) continue;
+        float &cell = rtAccum[row * w + x];
+        cell = bb_lib::min2(cell + 0.25f, 1.0f);
+    }
+    simdCopy_32f(&rtAccum[0], &frame.alphaFrame[0], w * h);
+
+    double frameRate = bb_lib::max2(prefs->realTimeFrameRate, 1);
+    simTime += 1.0 / frameRate;
+    Pace(1.0 / frameRate, config.speedFactor);
+
+    acquisitions++;
+    return true;
+}
+
+bool DeviceSim::Reconfigure(const DemodSettings *ds, IQDescriptor *desc)
+{
+    int decimation = 0x1 << ds->DecimationFactor();
+
+    iqCenter = ds->CenterFreq();
+    iqSampleRate = SIM_BASE_SAMPLE_RATE / decimation;
+    iqReturnLen = IQ_RETURN_LEN;
+
+    desc->returnLen = iqReturnLen;
+    desc->bandwidth = ds->Bandwidth();
+    desc->sampleRate = iqSampleRate;
+    desc->timeDelta = 1.0 / iqSampleRate;
+    desc->decimation = decimation;
+
+    phase.assign(config.signals.size(), 0.0);
+    simTime = 0.0;
+    pacedTime = 0.0;
+    paceTimer.start();
+
+    ConfigApplied(ds);
+    return true;
+}
+
+bool DeviceSim::GetIQ(IQCapture *iqc)
+{
+    if(!open) {
+        lastStatus = "Device not open";
+        return false;
+    }
+    if(InjectDisconnect()) {
+        return false;
+    }
+
+    if(iqc->capture.size() < (size_t)iqReturnLen) {
+        iqc->capture.resize(iqReturnLen);
+    }
+    complex_f *dst = &iqc->capture[0];
+    simdZero_32s(iqc->triggers, 70);
+
+    // Complex white noise over the full sample rate
+    double noiseMW = DBMtoMW(config.noiseFloor + 10.0 * log10(iqSampleRate));
+    double sigma = sqrt(noiseMW / 2.0);
+    for(int i = 0; i < iqReturnLen; i++) {
+        dst[i].re = sigma * Gaussian();
+        dst[i].im = sigma * Gaussian();
+    }
+
+    double dt = 1.0 / iqSampleRate;
+    for(size_t s = 0; s < config.signals.size(); s++) {
+        const SimSignal &sig = config.signals[s];
+        double offset = sig.freq - iqCenter;
+        if(fabs(offset) >= iqSampleRate / 2.0) {
+            continue;
+        }
+
+        double amp = sqrt(DBMtoMW(sig.amplitude));
+        double ph = phase[s];
+        for(int i = 0; i < iqReturnLen; i++) {
+            double t = simTime + i * dt;
+            double env = amp, freq = offset;
+            switch(sig.type) {
+            case SimSignalAM:
+                env *= 1.0 + sig.modDepth * cos(BB_TWO_PI * sig.modRate * t);
+                break;
+            case SimSignalFM:
+                freq += sig.modDepth * cos(BB_TWO_PI * sig.modRate * t);
+                break;
+            case SimSignalPulsed:
+                if(fmod(t, sig.pulsePeriod) >= sig.pulseWidth) env = 0.0;
+                break;
+            default:
+                break;
+            }
+            dst[i].re += env * cos(ph);
+            dst[i].im += env * sin(ph);
+            ph += BB_TWO_PI * freq * dt;
+        }
+        phase[s] = fmod(ph, BB_TWO_PI);
+    }
+
+    double captureTime = iqReturnLen * dt;
+    simTime += captureTime;
+    Pace(captureTime, config.speedFactor);
+
+    acquisitions++;
+    return true;
+}
+
+bool DeviceSim::GetIQFlush(IQCapture *iqc, bool flush)
+{
+    // Nothing is ever queued, the next capture is always fresh
+    return GetIQ(iqc);
+}
+
+bool DeviceSim::ConfigureForTRFL(double center,
+                                 MeasRcvrRange range,
+                                 int atten,
+                                 int gain,
+                                 IQDescriptor &desc)
+{
+    iqCenter = center;
+    iqSampleRate = SIM_BASE_SAMPLE_RATE / 128;
+    iqReturnLen = IQ_RETURN_LEN;
+
+    desc.returnLen = iqReturnLen;
+    desc.bandwidth = 100.0e3;
+    desc.sampleRate = iqSampleRate;
+    desc.timeDelta = 1.0 / iqSampleRate;
+    desc.decimation = 128;
+
+    phase.assign(config.signals.size(), 0.0);
+    simTime = 0.0;
+    pacedTime = 0.0;
+    paceTimer.start();
+
+    ConfigApplied(center, range, atten, gain);
+    return true;
+}
+
+bool DeviceSim::ConfigureAudio(const AudioSettings &as)
+{
+    audioCenter = as.CenterFreq();
+    audioBandwidth = as.IFBandwidth();
+    audioPhase = 0.0;
+
+    ConfigApplied(as);
+    return true;
+}
+
+// Produce the demodulated modulation tone of the first AM/FM signal
+//   inside the IF bandwidth, otherwise low level noise
+bool DeviceSim::GetAudio(float *audio)
+{
+    if(!open) {
+        lastStatus = "Device not open";
+        return false;
+    }
+    if(InjectDisconnect()) {
+        return false;
+    }
+
+    const SimSignal *tuned = nullptr;
+    for(const SimSignal &sig : config.signals) {
+        if(fabs(sig.freq - audioCenter) < audioBandwidth / 2.0 &&
+                (sig.type == SimSignalAM || sig.type == SimSignalFM)) {
+            tuned = &sig;
+            break;
+        }
+    }
+
+    for(int i = 0; i < AUDIO_RETURN_LEN; i++) {
+        float sample = 0.001f * (Uniform() - 0.5f);
+        if(tuned) {
+            sample += 0.5f * sin(audioPhase);
+            audioPhase += BB_TWO_PI * tuned->modRate / SIM_AUDIO_RATE;
+        }
+        audio[i] = sample;
+    }
+    audioPhase = fmod(audioPhase, BB_TWO_PI);
+
+    double blockTime = AUDIO_RETURN_LEN / SIM_AUDIO_RATE;
+    simTime += blockTime;
+    Pace(blockTime, config.speedFactor);
+
+    return true;
+}
+
+const char* DeviceSim::GetLastStatusString() const
+{
+    return lastStatus;
+}
+
+QString DeviceSim::GetDeviceString() const
+{
+    return open ? "Simulated" : "No Device Open";
+}
+
+void DeviceSim::UpdateDiagnostics()
+{
+    // Fixed diagnostics, never triggers a temperature recalibration
+    telemetry.Publish(35.0, 5.0, 0.9);
+}
+
+int DeviceSim::MsPerIQCapture() const
+{
+    return bb_lib::max2(1, (int)(1000.0 * iqReturnLen / iqSampleRate));
+}
+
+// Tones are shaped by a Gaussian RBW filter and combined with the
+//   noise floor by taking the larger of the two in dB
+void DeviceSim::SynthesizeSpectrum(float *dst, int len, double start,
+                                   double bin, double rbw)
+{
+    float floor = config.noiseFloor + 10.0 * log10(rbw);
+    for(int i = 0; i < len; i++) {
+        dst[i] = floor + noiseTable[(int)(Uniform() * NOISE_TABLE_LEN)];
+    }
+
+    // A Gaussian RBW filter is 3.01 dB down at rbw/2
+    double halfRbw = rbw / 2.0;
+    int reach = (int)(4.0 * rbw / bin) + 1;
+
+    auto deposit = [&](double freq, double amp) {
+        int center = (int)((freq - start) / bin + 0.5);
+        int lo = bb_lib::max2(center - reach, 0);
+        int hi = bb_lib::min2(center + reach, len - 1);
+        for(int i = lo; i <= hi; i++) {
+            double df = (start + i * bin - freq) / halfRbw;
+            float level = amp - 3.0103 * df * df;
+            if(level > dst[i]) dst[i] = level;
+        }
+    };
+
+    for(const SimSignal &sig : config.signals) {
+        if(sig.freq < start - 4.0 * rbw ||
+                sig.freq > start + bin * len + 4.0 * rbw) {
+            continue;
+        }
+
+        switch(sig.type) {
+        case SimSignalTone:
+            deposit(sig.freq, sig.amplitude);
+            break;
+        case SimSignalAM:
+        {
+            deposit(sig.freq, sig.amplitude);
+            double sideband = sig.amplitude + 20.0 * log10(sig.modDepth / 2.0);
+            deposit(sig.freq - sig.modRate, sideband);
+            deposit(sig.freq + sig.modRate, sideband);
+            break;
+        }
+        case SimSignalFM:
+        {
+            // Power spread flat over Carson's bandwidth
+            double bw = 2.0 * (sig.modDepth + sig.modRate);
+            int steps = bb_lib::max2(1, (int)(bw / bb_lib::max2(bin, 1.0)));
+            double level = sig.amplitude - 10.0 * log10(bb_lib::max2(bw / rbw, 1.0));
+            for(int k = 0; k <= steps; k++) {
+                deposit(sig.freq - bw / 2.0 + bw * k / steps, level);
+            }
+            break;
+        }
+        case SimSignalPulsed:
+            // Only visible when the sweep lands inside the pulse
+            if(fmod(simTime, sig.pulsePeriod) < sig.pulseWidth) {
+                deposit(sig.freq, sig.amplitude);
+            }
+            break;
+        }
+    }
+}
+
+// Keep the wall clock within reach of the simulated acquisition time
+// If the host falls behind, resync instead of bursting to catch up
+void DeviceSim::Pace(double simSeconds, double speed)
+{
+    if(speed <= 0.0) {
+        return;
+    }
+
+    pacedTime += simSeconds / speed;
+    double elapsed = paceTimer.elapsed() / 1000.0;
+
+    if(elapsed > pacedTime + 0.1) {
+        pacedTime = elapsed;
+    } else if(elapsed < pacedTime) {
+        Sleep((ulong)((pacedTime - elapsed) * 1000.0));
+    }
+}
+
+bool DeviceSim::IsEnumerated(int) const
+{
+    return bb_lib::get_ms_since_epoch() >= unpluggedUntil;
+}
+
+// The device drops off the bus for disconnectDuration, exercising
+//   connection-loss recovery without touching hardware
+bool DeviceSim::InjectDisconnect()
+{
+    if(config.disconnectInterval <= 0.0 ||
+            connectedTimer.elapsed() < config.disconnectInterval * 1000.0) {
+        return false;
+    }
+
+    unpluggedUntil = bb_lib::get_ms_since_epoch() +
+            (qint64)(config.disconnectDuration * 1000.0);
+    lastStatus = "Device connection lost";
+    LoseConnection();
+    return true;
+}
+
+double DeviceSim::Gaussian()
+{
+    if(hasGaussSpare) {
+        hasGaussSpare = false;
+        return gaussSpare;
+    }
+
+    double u1 = bb_lib::max2((double)Uniform(), 1.0e-12);
+    double u2 = Uniform();
+    double mag = sqrt(-2.0 * log(u1));
+    gaussSpare = mag * sin(BB_TWO_PI * u2);
+    hasGaussSpare = true;
+    return mag * cos(BB_TWO_PI * u2);
+}
@@ -0,0 +1,178 @@
+#ifndef DEVICE_SIM_H
+#define DEVICE_SIM_H
+
+#include <QElapsedTimer>
+
+#include "device.h"
+
+class Preferences;
+
+enum SimSignalType {
+    SimSignalTone = 0,
+    SimSignalAM = 1,
+    SimSignalFM = 2,
+    SimSignalPulsed = 3
+};
+
+// One synthetic emitter seen by the simulated receiver
+struct SimSignal {
+    SimSignal(SimSignalType t = SimSignalTone,
+              double f = 1.0e9,
+              double a = -30.0) :
+        type(t), freq(f), amplitude(a),
+        modRate(1.0e3), modDepth(0.5),
+        pulseWidth(1.0e-3), pulsePeriod(10.0e-3) {}
+
+    SimSignalType type;
+    double freq; // Hz
+    double amplitude; // dBm, carrier or pulse-on power
+    double modRate; // Hz, AM/FM modulation tone
+    double modDepth; // AM depth [0,1] or FM peak deviation in Hz
+    double pulseWidth; // seconds
+    double pulsePeriod; // seconds
+};
+
+// Simulated device configuration
+// Stored in its own .ini file so headless boxes can be set up
+//   without the preferences dialog
+class SimConfig {
+public:
+    SimConfig() { LoadDefaults(); }
+    ~SimConfig() {}
+
+    void LoadDefaults();
+    void Load();
+    void Save() const;
+
+    double noiseFloor; // dBm/Hz
+    // Full sweeps per second, 0 = as fast as the host allows
+    double sweepRate;
+    // Hz swept per second, added to the sweep time, 0 = unlimited
+    // Lets narrower spans sweep faster, as on the hardware
+    double scanRate;
+    // Wall clock multiplier for I/Q and audio pacing
+    // 1.0 = real time, 0 = as fast as the host allows
+    double speedFactor;
+    std::vector<SimSignal> signals;
+    // Number of simulated devices offered as a wideband group
+    int groupSize;
+    // Seconds of operation before an injected disconnect, 0 = never
+    double disconnectInterval;
+    // Seconds the device stays unplugged after a disconnect
+    double disconnectDuration;
+};
+
+/*
+ * Device which generates synthetic sweeps, real-time frames,
+ *   I/Q and audio without any hardware present. Behaves as a BB60C
+ *   from the point of view of device_traits so every mode can run
+ *   against it. Used for measuring pipeline throughput.
+ */
+class DeviceSim : public Device {
+public:
+    DeviceSim(const Preferences *preferences);
+    virtual ~DeviceSim();
+
+    virtual bool OpenDevice();
+    virtual bool OpenDeviceWithSerial(int serialToOpen);
+    virtual int GetNativeDeviceType() const;
+    virtual bool CloseDevice();
+    virtual bool Abort();
+    virtual bool Preset();
+    // Sweep
+    virtual bool Reconfigure(const SweepSettings *s, Trace *t);
+    virtual bool GetSweep(const SweepSettings *s, Trace *t);
+    virtual bool GetRealTimeFrame(Trace &t, RealTimeFrame &frame);
+    // Stream
+    virtual bool Reconfigure(const DemodSettings *s, IQDescriptor *iqc);
+    virtual bool GetIQ(IQCapture *iqc);
+    virtual bool GetIQFlush(IQCapture *iqc, bool sync);
+    virtual bool ConfigureForTRFL(double center, MeasRcvrRange range,
+                                  int atten, int gain, IQDescriptor &desc);
+    virtual bool ConfigureAudio(const AudioSettings &as);
+    virtual bool GetAudio(float *audio);
+
+    virtual const char* GetLastStatusString() const;
+
+    virtual QString GetDeviceString() const;
+    virtual void UpdateDiagnostics();
+    virtual bool IsPowered() const { return true; }
+    virtual bool NeedsTempCal() const { return false; }
+    virtual bool IsSimulated() const { return true; }
+    // False while an injected disconnect lasts
+    virtual bool IsEnumerated(int serial) const;
+
+    virtual int MsPerIQCapture() const;
+
+    virtual int SetTimebase(int new_val) {
+        timebase_reference = new_val;
+        return timebase_reference;
+    }
+
+    const SimConfig& Config() const { return config; }
+    void SetConfig(const SimConfig &newConfig);
+
+    // Number of sweeps/frames/captures generated since open
+    qint64 AcquisitionCount() const { return acquisitions; }
+
+private:
+    // Build the dBm spectrum of the configured signals into dst
+    void SynthesizeSpectrum(float *dst, int len, double start,
+                            double bin, double rbw);
+    // Block until the wall clock catches up with the simulated clock
+    void Pace(double simSeconds, double speed);
+    // Uniform [0,1)
+    float Uniform() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return (rng >> 8) * (1.0f / 16777216.0f);
+    }
+    double Gaussian();
+    // Simulates a cable pull once disconnectInterval has passed
+    bool InjectDisconnect();
+    double gaussSpare;
+    bool hasGaussSpare;
+
+    SimConfig config;
+    const char *lastStatus;
+
+    // Simulated clock, seconds since the last configuration
+    double simTime;
+    double pacedTime;
+    QElapsedTimer paceTimer;
+    unsigned int rng;
+    qint64 acquisitions;
+    QElapsedTimer connectedTimer;
+    qint64 unpluggedUntil; // ms since epoch
+
+    // Sweep state
+    bool detectorAverage;
+    bool linearScale;
+    std::vector<float> noiseTable; // Log-Rayleigh deviates in dB
+    // Persistence accumulated across real-time frames, the frame
+    //   buffers passed in are not guaranteed to be the same each call
+    std::vector<float> rtAccum;
+
+    // Stream state
+    double iqCenter;
+    double iqSampleRate;
+    int iqReturnLen;
+    std::vector<double> phase; // One accumulator per signal
+
+    // Audio state
+    double audioCenter;
+    double audioBandwidth;
+    double audioPhase;
+
+    // Packet sizes match the BB60C API
+    static const int IQ_RETURN_LEN = 16384;
+    static const int AUDIO_RETURN_LEN = 4096;
+    static const int NOISE_TABLE_LEN = 4096;
+    static const int RT_FRAME_HEIGHT = 256;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(DeviceSim)
+};
+
+#endif // DEVICE_SIM_H
@@ -0,0 +1,117 @@
+#include "device_telemetry.h"
+
+#include <QDateTime>
+
+DeviceTelemetry::DeviceTelemetry() :
+    interval(DEFAULT_INTERVAL_MS),
+    running(false)
+{
+    seq = 0;
+    temperature = 0.0;
+    voltage = 0.0;
+    current = 0.0;
+    timestamp = 0;
+}
+
+DeviceTelemetry::~DeviceTelemetry()
+{
+    Stop();
+}
+
+void DeviceTelemetry::Start(std::function<void()> sample, int intervalMs)
+{
+    Stop();
+
+    sampleFunc = sample;
+    interval = intervalMs;
+    running = true;
+    thread_handle = std::thread(&DeviceTelemetry::SampleThread, this);
+}
+
+void DeviceTelemetry::Stop()
+{
+    if(!thread_handle.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(waitLock);
+        running = false;
+    }
+    waitCond.notify_all();
+    thread_handle.join();
+}
+
+void DeviceTelemetry::Publish(float newTemp, float newVoltage, float newCurrent)
+{
+    std::unique_lock<std::mutex> lg(publishLock);
+
+    bool changed = (newTemp != temperature) ||
+            (newVoltage != voltage) ||
+            (newCurrent != current);
+
+    seq++;
+    temperature = newTemp;
+    voltage = newVoltage;
+    current = newCurrent;
+    timestamp = QDateTime::currentMSecsSinceEpoch();
+    seq++;
+
+    lg.unlock();
+
+    if(changed) {
+        emit diagnosticsChanged(FormatDiagnostics(newTemp, newVoltage));
+    }
+}
+
+TelemetrySnapshot DeviceTelemetry::Snapshot() const
+{
+    TelemetrySnapshot snap;
+    unsigned int before, after;
+
+    do {
+        before = seq;
+        snap.temperature = temperature;
+        snap.voltage = voltage;
+        snap.current = current;
+        snap.timestamp = timestamp;
+        after = seq;
+    } while((before & 0x1) || (before != after));
+
+    snap.sequence = before >> 1;
+    return snap;
+}
+
+QString DeviceTelemetry::DiagnosticsString() const
+{
+    TelemetrySnapshot snap = Snapshot();
+    if(snap.sequence == 0) {
+        return QString();
+    }
+    return FormatDiagnostics(snap.temperature, snap.voltage);
+}
+
+QString DeviceTelemetry::FormatDiagnostics(float temperature, float voltage)
+{
+    QString text;
+    if(voltage > 0.0) {
+        text.sprintf("%.2f C  --  %.2f V", temperature, voltage);
+    } else {
+        text.sprintf("%.2f C", temperature);
+    }
+    return text;
+}
+
+void DeviceTelemetry::SampleThread()
+{
+    std::unique_lock<std::mutex> lg(waitLock);
+
+    while(running) {
+        lg.unlock();
+        sampleFunc();
+        lg.lock();
+
+        waitCond.wait_for(lg, std::chrono::milliseconds(interval),
+                          [this]{ return !running; });
+    }
+}
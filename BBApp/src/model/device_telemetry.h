@@ -0,0 +1,83 @@
+#ifndef DEVICE_TELEMETRY_H
+#define DEVICE_TELEMETRY_H
+
+#include <QObject>
+#include <QString>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+#include "lib/macros.h"
+
+// Copy of the most recent device diagnostics
+struct TelemetrySnapshot {
+    TelemetrySnapshot() :
+        temperature(0.0), voltage(0.0), current(0.0),
+        timestamp(0), sequence(0) {}
+
+    float temperature; // C
+    float voltage; // V, 0.0 if the device does not report it
+    float current; // mA, 0.0 if the device does not report it
+    qint64 timestamp; // ms since epoch
+    unsigned int sequence; // Incremented on every publish
+};
+
+/*
+ * Samples device diagnostics on a background timer, off the
+ *   acquisition path, and publishes them as a snapshot which any
+ *   thread can read without locking.
+ * The status bar text is delivered through diagnosticsChanged(),
+ *   which Qt queues onto the GUI thread.
+ */
+class DeviceTelemetry : public QObject {
+    Q_OBJECT
+
+public:
+    DeviceTelemetry();
+    ~DeviceTelemetry();
+
+    // Call sample() every intervalMs on the telemetry thread until Stop()
+    // sample() is expected to call Publish()
+    void Start(std::function<void()> sample, int intervalMs = DEFAULT_INTERVAL_MS);
+    void Stop();
+    bool IsRunning() const { return thread_handle.joinable(); }
+
+    // May be called from any thread, emits diagnosticsChanged() only
+    //   when a value changed
+    void Publish(float temperature, float voltage = 0.0, float current = 0.0);
+    // Never blocks, retries if it races a publish
+    TelemetrySnapshot Snapshot() const;
+    // Status bar text for the latest snapshot
+    QString DiagnosticsString() const;
+
+    static const int DEFAULT_INTERVAL_MS = 500;
+
+private:
+    void SampleThread();
+    static QString FormatDiagnostics(float temperature, float voltage);
+
+    std::function<void()> sampleFunc;
+    int interval;
+    std::thread thread_handle;
+    std::mutex waitLock;
+    std::condition_variable waitCond;
+    bool running;
+
+    // Sequence lock, odd while a publish is in progress
+    // Writers are serialized by publishLock, readers never lock
+    std::mutex publishLock;
+    std::atomic<unsigned int> seq;
+    std::atomic<float> temperature, voltage, current;
+    std::atomic<qint64> timestamp;
+
+signals:
+    void diagnosticsChanged(const QString &text);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(DeviceTelemetry)
+};
+
+#endif // DEVICE_TELEMETRY_H
@@ -161,7 +161,8 @@ void PathLossTable::Apply(Trace *in)
     if(!stored || (in->Length() != store.Length())) {
         BuildStore(in);
         if(!in->GetSettings()->RefLevel().IsLogScale()) {
-            bb_lib::db_to_lin(store.Max(), store.Length());
+            // dB to linear voltage correction
+            DBtoLinear_32f(store.Max(), store.Max(), store.Length(), 0.05f);
         }
     }
 
@@ -170,13 +171,14 @@ void PathLossTable::Apply(Trace *in)
         return;
     }
 
+    // Only the update range is new, see SweepCentral::MergePartialSweep()
     if(in->GetSettings()->RefLevel().IsLogScale()) {
-        for(int i = 0; i < in->Length(); i++) {
+        for(int i = in->UpdateStart(); i < in->UpdateStop(); i++) {
             in->Max()[i] += store.Max()[i];
             in->Min()[i] += store.Max()[i];
         }
     } else {
-        for(int i = 0; i < in->Length(); i++) {
+        for(int i = in->UpdateStart(); i < in->UpdateStop(); i++) {
             in->Max()[i] *= store.Max()[i];
             in->Min()[i] *= store.Max()[i];
         }
@@ -189,7 +191,7 @@ void LimitLineTable::Apply(Trace *in)
     if(!stored || (in->Length() != store.Length())) {
         BuildStore(in);
         if(!in->GetSettings()->RefLevel().IsLogScale()) {
-            bb_lib::dbm_to_mv(store.Max(), store.Length());
+            unit_convert_32f(store.Max(), store.Max(), store.Length(), DBM, MV);
         }
     }
 
@@ -68,7 +68,7 @@ public:
     PathLossTable() {}
     ~PathLossTable() {}
 
-    // Add/Multiply the path loss trace to
+    // Add/Multiply the path loss trace to the update range of in
     void Apply(Trace *in);
 
 private:
@@ -0,0 +1,162 @@
+#include "occupancy.h"
+#include "trace.h"
+#include "lib/bb_lib.h"
+#include "lib/simd_kernels.h"
+
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+
+const int NOISE_FLOOR_SAMPLES = 4096;
+
+} // namespace
+
+Occupancy::Occupancy()
+{
+    enabled = false;
+    mode = OccupancyAbsolute;
+    threshold = -80.0;
+    margin = 10.0;
+
+    len = 0;
+    startFreq = 0.0;
+    binSize = 0.0;
+
+    Reset();
+}
+
+void Occupancy::Configure(bool enable, OccupancyThreshold thresholdMode,
+                          double thresholdDBM, double marginDB)
+{
+    enabled = enable;
+    mode = thresholdMode;
+    threshold = thresholdDBM;
+    margin = bb_lib::max2(marginDB, 0.0);
+
+    Reset();
+    if(!enabled) {
+        // Give the memory back
+        std::vector<unsigned int>().swap(hits);
+        len = 0;
+    }
+}
+
+void Occupancy::Reset()
+{
+    hits.assign(len, 0);
+    sweeps = 0;
+    progress = 0;
+    noiseFloorValid = false;
+}
+
+void Occupancy::Update(const Trace *sweep)
+{
+    if(!enabled) return;
+
+    if(sweep->Length() != len || sweep->StartFreq() != startFreq ||
+            sweep->BinSize() != binSize) {
+        len = sweep->Length();
+        startFreq = sweep->StartFreq();
+        binSize = sweep->BinSize();
+        Reset();
+    }
+
+    int start = sweep->UpdateStart();
+    int stop = bb_lib::min2(sweep->UpdateStop(), len);
+    if(start >= stop) return;
+
+    // A range before the end of the last one is a new sweep
+    if(start < progress) {
+        sweeps++;
+        progress = 0;
+    }
+
+    bool logScale = sweep->GetSettings()->RefLevel().IsLogScale();
+    float level;
+    if(mode == OccupancyAbsolute) {
+        level = logScale ? threshold : unit_convert(threshold, DBM, MV);
+    } else {
+        if(!noiseFloorValid) {
+            EstimateNoiseFloor(sweep->Max(), start, stop);
+        }
+        level = logScale ? noiseFloor + margin : noiseFloor * pow(10.0, margin / 20.0);
+    }
+
+    simdCountAbove_32f(sweep->Max() + start, level, &hits[start], stop - start);
+    progress = stop;
+
+    if(sweep->IsFullSweep()) {
+        sweeps++;
+        progress = 0;
+        if(mode == OccupancyAboveNoise) {
+            EstimateNoiseFloor(sweep->Max(), 0, len);
+        }
+    }
+}
+
+// Median of an evenly strided subset of [start,stop)
+void Occupancy::EstimateNoiseFloor(const float *buf, int start, int stop)
+{
+    int n = stop - start;
+    int step = bb_lib::max2(n / NOISE_FLOOR_SAMPLES, 1);
+
+    samples.clear();
+    for(int i = start; i < stop; i += step) {
+        samples.push_back(buf[i]);
+    }
+
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    noiseFloor = samples[samples.size() / 2];
+    noiseFloorValid = true;
+}
+
+double Occupancy::Percent(int bin) const
+{
+    if(bin < 0 || bin >= len) return 0.0;
+
+    unsigned int total = sweeps + ((bin < progress) ? 1 : 0);
+    return (total == 0) ? 0.0 : 100.0 * hits[bin] / total;
+}
+
+void Occupancy::GetTrace(Trace *dst) const
+{
+    dst->SetSize(len);
+    dst->SetFreq(binSize, startFreq);
+    dst->SetUpdateRange(0, len);
+
+    // Bins before progress have one more sweep counted
+    float *max = dst->Max();
+    float scale = (sweeps == 0) ? 0.0f : 100.0f / sweeps;
+    float scaleCurrent = 100.0f / (sweeps + 1);
+    for(int i = 0; i < progress; i++) {
+        max[i] = hits[i] * scaleCurrent;
+    }
+    for(int i = progress; i < len; i++) {
+        max[i] = hits[i] * scale;
+    }
+    simdCopy_32f(max, dst->Min(), len);
+}
+
+bool Occupancy::Export(const QString &path) const
+{
+    QFile file(path);
+
+    if(!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QTextStream out(&file);
+
+    out << "Sweeps, " << sweeps << "\n";
+    double freq = startFreq;
+    for(int i = 0; i < len; i++, freq += binSize) {
+        out << freq / 1.0e6 << ", " << Percent(i) << "\n";
+    }
+
+    file.close();
+
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <vector>
+
+#include <QString>
+
+#include "lib/macros.h"
+
+class Trace;
+
+// Must match the combo-box indices
+enum OccupancyThreshold {
+    OccupancyAbsolute   = 0, // Fixed level in dBm
+    OccupancyAboveNoise = 1  // Margin above the noise floor estimate
+};
+
+/*
+ * Spectrum occupancy, the percent of sweeps each bin was above a
+ *   threshold over a run of any length
+ * One 32-bit count per bin, fixed memory no matter how long the run,
+ *   counted over each update range as the sweep arrives.
+ * The noise floor is the median of the last full sweep, sampled down
+ *   to at most 4096 bins, which holds while under half of the span is
+ *   occupied.
+ */
+class Occupancy {
+public:
+    Occupancy();
+    ~Occupancy() {}
+
+    // Changing any setting starts a new run
+    void Configure(bool enable, OccupancyThreshold mode, double thresholdDBM, double marginDB);
+    bool IsEnabled() const { return enabled; }
+    // Start a new run, same settings
+    void Reset();
+
+    // Count the update range of sweep, a change of the sweep layout
+    //   starts a new run
+    void Update(const Trace *sweep);
+
+    // Completed sweeps in this run
+    unsigned int Sweeps() const { return sweeps; }
+    // Percent of sweeps bin was above the threshold
+    double Percent(int bin) const;
+    // Min and max of dst set to the percent of every bin
+    void GetTrace(Trace *dst) const;
+    // CSV, frequency in MHz and percent
+    bool Export(const QString &path) const;
+
+private:
+    void EstimateNoiseFloor(const float *buf, int start, int stop);
+
+    bool enabled;
+    OccupancyThreshold mode;
+    double threshold; // dBm
+    double margin; // dB
+
+    int len;
+    double startFreq;
+    double binSize;
+    std::vector<unsigned int> hits;
+    unsigned int sweeps;
+    int progress; // Bins [0,progress) of the current sweep are counted
+
+    float noiseFloor; // Trace units
+    bool noiseFloorValid;
+    std::vector<float> samples;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Occupancy)
+};
+
+#endif // OCCUPANCY_H
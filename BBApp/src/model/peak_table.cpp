@@ -0,0 +1,96 @@
+#include "peak_table.h"
+#include "trace.h"
+#include "lib/bb_lib.h"
+#include "lib/simd_kernels.h"
+
+#include <algorithm>
+
+PeakTable::PeakTable()
+{
+    enabled = false;
+    maxPeaks = 10;
+    excursion = 6.0;
+    threshold = -100.0;
+}
+
+void PeakTable::Configure(bool enable, int peaks, double excursionDB, double thresholdDBM)
+{
+    enabled = enable;
+    maxPeaks = peaks;
+    bb_lib::clamp(maxPeaks, 1, MAX_PEAKS);
+    excursion = bb_lib::max2(excursionDB, 0.0);
+    threshold = thresholdDBM;
+
+    if(!enabled) {
+        this->peaks.clear();
+    }
+}
+
+// Walking out from ix, the trace must drop to amp - drop before it
+//   climbs above amp, or reaches the edge
+bool PeakTable::PassesExcursion(const Trace *trace, const PeakIndex &index,
+                                int ix, float drop) const
+{
+    const float *buf = trace->Max();
+    float amp = buf[ix];
+    float level = amp - drop;
+
+    int left = index.LastAbove(buf, 0, ix, amp);
+    if(index.LastAtOrBelow(buf, left + 1, ix, level) < 0) {
+        return false;
+    }
+
+    int right = index.FirstAbove(buf, ix + 1, trace->Length(), amp);
+    if(right < 0) right = trace->Length();
+    return index.FirstAtOrBelow(buf, ix + 1, right, level) >= 0;
+}
+
+void PeakTable::Update(const Trace *trace)
+{
+    peaks.clear();
+    int len = trace->Length();
+    if(!enabled || len < 3) {
+        return;
+    }
+
+    // Threshold and excursion in the units of the trace
+    // Linear traces compare in mV, a drop of N dB is a ratio
+    bool logScale = trace->GetSettings()->RefLevel().IsLogScale();
+    float thresh = logScale ? threshold : unit_convert(threshold, DBM, MV);
+    float ratio = pow(10.0, -excursion / 20.0);
+
+    candidates.resize(len);
+    int count = simdLocalMax_32f(trace->Max(), len, thresh, &candidates[0]);
+    if(count == 0) {
+        return;
+    }
+
+    const PeakIndex &index = trace->GetPeakSearchIndex(scratch);
+    const float *buf = trace->Max();
+    auto larger = [buf](int a, int b) {
+        return (buf[a] > buf[b]) || (buf[a] == buf[b] && a < b);
+    };
+
+    // Most large candidates pass, sort a few more than needed and
+    //   widen the sorted range only if too many were rejected
+    int sorted = 0;
+    int want = bb_lib::min2(count, maxPeaks * 4);
+    while((int)peaks.size() < maxPeaks && sorted < count) {
+        std::partial_sort(candidates.begin() + sorted, candidates.begin() + want,
+                          candidates.begin() + count, larger);
+
+        for(; sorted < want && (int)peaks.size() < maxPeaks; sorted++) {
+            int ix = candidates[sorted];
+            float drop = logScale ? excursion : buf[ix] * (1.0f - ratio);
+            if(PassesExcursion(trace, index, ix, drop)) {
+                PeakTableEntry entry;
+                entry.index = ix;
+                entry.freq = trace->StartFreq() + ix * trace->BinSize();
+                entry.amp = buf[ix];
+                peaks.push_back(entry);
+            }
+        }
+
+        want = bb_lib::min2(count, want * 4);
+    }
+}
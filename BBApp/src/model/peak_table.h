@@ -0,0 +1,60 @@
+#ifndef PEAK_TABLE_H
+#define PEAK_TABLE_H
+
+#include <vector>
+
+#include "lib/macros.h"
+#include "lib/peak_index.h"
+
+class Trace;
+
+struct PeakTableEntry {
+    int index;
+    double freq; // Hz
+    float amp; // Trace units
+};
+
+/*
+ * Peak table, the largest peaks of a trace
+ * A peak is a local maximum above the threshold which both rises and
+ *   falls by at least the excursion, measured down to the lowest point
+ *   between it and the nearest higher bin on either side.
+ * Candidates come from a SIMD local maxima pass, a partial sort hands
+ *   them out largest first until maxPeaks pass the excursion test.
+ */
+class PeakTable {
+public:
+    static const int MAX_PEAKS = 100;
+
+    PeakTable();
+    ~PeakTable() {}
+
+    void Configure(bool enable, int peaks, double excursionDB, double thresholdDBM);
+    bool IsEnabled() const { return enabled; }
+    int MaxPeaks() const { return maxPeaks; }
+    double Excursion() const { return excursion; }
+    double Threshold() const { return threshold; }
+
+    // Search the max buffer of trace
+    void Update(const Trace *trace);
+    // Sorted by amplitude, largest first
+    const std::vector<PeakTableEntry>& Peaks() const { return peaks; }
+
+private:
+    bool PassesExcursion(const Trace *trace, const PeakIndex &index,
+                         int ix, float drop) const;
+
+    bool enabled;
+    int maxPeaks;
+    double excursion; // dB
+    double threshold; // dBm
+
+    std::vector<int> candidates;
+    std::vector<PeakTableEntry> peaks;
+    PeakIndex scratch;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(PeakTable)
+};
+
+#endif // PEAK_TABLE_H
@@ -1,89 +1,135 @@
 #include "persistence.h"
 #include "trace.h"
-
-#include <QPoint>
-
-const int MAX_PERSIST_W = 512;
-const int PERSIST_H = 512;
-
-Persistence::Persistence()
+#include "lib/bb_lib.h"
+#include "lib/simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Added to a cell for each sweep drawn through it
+const float PERSIST_TRACE_HIT = 0.04f;
+// Added to the cells joining neighboring columns
+const float PERSIST_LINE_HIT = 0.01f;
+// Per sweep decay
+const double PERSIST_DECAY = 0.975;
+// Cells below this are transparent in the image
+const float PERSIST_VISIBLE = 0.01f;
+
+Persistence::Persistence() :
+    max_width(PERSIST_DEFAULT_W),
+    img_width(0),
+    height(PERSIST_DEFAULT_H),
+    now(0),
+    image_now(0)
 {
-    map = nullptr;
-    image = nullptr;
-    img_width = 0;
+
 }
 
 Persistence::~Persistence()
 {
-    if(map) {
-        delete [] map;
-        map = nullptr;
-    }
-    if(image) {
-        delete [] image;
-        image = nullptr;
-    }
+
 }
 
-float* Persistence::GetImage()
+// A column hit every sweep settles at TRACE_HIT / (1 - DECAY), it is
+//   invisible this many sweeps after its last hit
+int Persistence::DeadAge() const
 {
-    float *trans = new float[img_width * PERSIST_H];
+    static const int age = (int)ceil(
+                log(PERSIST_VISIBLE * (1.0 - PERSIST_DECAY) / PERSIST_TRACE_HIT)
+                / log(PERSIST_DECAY));
+    return age;
+}
 
+// The image is cached, a read with no sweep since the last one costs
+//   nothing. Columns drawn since the last read are decayed to the
+//   current sweep and copied in, live columns not drawn since only
+//   fade by the sweeps in between and are scaled in place, a column
+//   dead since it was last blanked costs nothing
+const float* Persistence::GetImage()
+{
     map_mutex.lock();
 
-    for(int i = 0; i < img_width; i++) {
-        for(int j = 0; j < PERSIST_H; j++) {
-                trans[j*PERSIST_H + i] = map[i*PERSIST_H + j];
-        }
+    if(now == image_now) {
+        map_mutex.unlock();
+        return image.empty() ? nullptr : &image[0];
     }
 
-    map_mutex.unlock();
-
-    for(int i = 0; i < img_width * PERSIST_H; i++) {
-//        image[i*4] = 1.0; //trans[i];
-//        image[i*4+1] = 0.0; //trans[i];
-//        if(i & 1) image[i*4+1] = 1.0;
-//        image[i*4+2] = 0.0; //trans[i];
+    const int deadAge = DeadAge();
+    const float fade = (float)pow(PERSIST_DECAY, now - image_now);
 
-        float t = trans[i];
-
-        image[i*4] = trans[i];
-        image[i*4+1] = trans[i];
-        image[i*4+2] = trans[i];
+    for(int i = 0; i < img_width; i++) {
+        if(now - col_stamps[i] > deadAge) {
+            if(col_blank[i]) continue;
+            for(int j = 0; j < height; j++) {
+                float *px = &image[(j * img_width + i) * 4];
+                px[0] = px[1] = px[2] = px[3] = 0.0f;
+            }
+            col_blank[i] = 1;
+            continue;
+        }
 
-        if(trans[i] > 0.01) {
-            image[i*4+3] = 1.0;
+        if(col_stamps[i] > image_now) {
+            Touch(i, 0, height - 1, 0.0f);
+            const float *col = &map[i * height];
+            for(int j = 0; j < height; j++) {
+                float *px = &image[(j * img_width + i) * 4];
+                px[0] = px[1] = px[2] = col[j];
+                px[3] = (col[j] > PERSIST_VISIBLE) ? 1.0f : 0.0f;
+            }
         } else {
-            image[i*4+3] = 0.0;
+            for(int j = 0; j < height; j++) {
+                float *px = &image[(j * img_width + i) * 4];
+                px[0] = px[1] = px[2] = px[0] * fade;
+                px[3] = (px[0] > PERSIST_VISIBLE) ? 1.0f : 0.0f;
+            }
         }
+        col_blank[i] = 0;
     }
+    image_now = now;
+
+    map_mutex.unlock();
 
+    return image.empty() ? nullptr : &image[0];
+}
 
-    delete [] trans;
+void Persistence::SetResolution(int maxWidth, int mapHeight)
+{
+    bb_lib::clamp(maxWidth, PERSIST_MIN_DIM, PERSIST_MAX_DIM);
+    bb_lib::clamp(mapHeight, PERSIST_MIN_DIM, PERSIST_MAX_DIM);
 
-    return image;
+    map_mutex.lock();
+    if(maxWidth != max_width || mapHeight != height) {
+        max_width = maxWidth;
+        height = mapHeight;
+        // Reconfigured on the next trace
+        img_width = 0;
+    }
+    map_mutex.unlock();
 }
 
 void Persistence::Reconfigure(const Trace *trace)
 {
-    int new_len = bb_lib::min2(trace->Length(), MAX_PERSIST_W);
+    Resize(trace->Length());
+}
+
+void Persistence::Resize(int len)
+{
+    int new_len = bb_lib::min2(len, max_width);
 
     map_mutex.lock();
 
     if(img_width != new_len) {
-        img_width =  new_len;
-
-        if(map) {
-            delete [] map;
-            map = nullptr;
-        }
-        map = new float[img_width * PERSIST_H];
-
-        if(image) {
-            delete [] image;
-            image = nullptr;
-        }
-        image = new float[img_width * PERSIST_H * 4];
+        img_width = new_len;
+
+        min_ix.resize(img_width);
+        max_ix.resize(img_width);
+        col_max.resize(img_width);
+        col_min.resize(img_width);
+        map.resize(img_width * height);
+        stamps.resize(img_width * height);
+        col_stamps.resize(img_width);
+        col_blank.resize(img_width);
+        image.resize(img_width * height * 4);
     }
 
     map_mutex.unlock();
@@ -93,67 +139,131 @@ void Persistence::Reconfigure(const Trace *trace)
 
 void Persistence::Clear()
 {
-    for(int i = 0; i < img_width * 512; i++) {
-        map[i] = 0.0;
+    map_mutex.lock();
+
+    now = 0;
+    image_now = 0;
+    std::fill(map.begin(), map.end(), 0.0f);
+    std::fill(stamps.begin(), stamps.end(), 0);
+    std::fill(col_stamps.begin(), col_stamps.end(), -DeadAge() - 1);
+    std::fill(col_blank.begin(), col_blank.end(), 1);
+    std::fill(image.begin(), image.end(), 0.0f);
+
+    map_mutex.unlock();
+}
+
+// Each column is the max/min of its share of the bins, scaled to
+//   cells with the reference level and division of the trace
+void Persistence::Rasterize(const Trace *trace)
+{
+    const int len = trace->Length();
+    const float *max = trace->Max();
+    const float *min = trace->Min();
+
+    for(int i = 0; i < img_width; i++) {
+        int first = (int)((qint64)i * len / img_width);
+        int last = (int)((qint64)(i + 1) * len / img_width);
+        col_max[i] = *std::max_element(max + first, max + last);
+        col_min[i] = *std::min_element(min + first, min + last);
     }
+
+    const SweepSettings *s = trace->GetSettings();
+    double ref, botRef;
+    if(s->RefLevel().IsLogScale()) {
+        ref = s->RefLevel().ConvertToUnits(AmpUnits::DBM);
+        botRef = ref - 10.0 * s->Div();
+    } else {
+        ref = s->RefLevel().Val();
+        botRef = 0.0;
+    }
+    float scale = (float)(height / (ref - botRef));
+    float offset = (float)(-botRef * height / (ref - botRef));
+    simdCombine_32f(&col_max[0], scale, &col_max[0], 0.0f, offset, &col_max[0], img_width);
+    simdCombine_32f(&col_min[0], scale, &col_min[0], 0.0f, offset, &col_min[0], img_width);
+}
+
+// Points are pairs (x, y1, x, y2), y in [0,1] at the graticule edges,
+//   max first when there are fewer samples than pixels, min first
+//   otherwise
+void Persistence::Rasterize(const GLVector &v)
+{
+    const int len = (int)v.size() / 4;
+
+    for(int i = 0; i < img_width; i++) {
+        int first = (int)((qint64)i * len / img_width);
+        int last = (int)((qint64)(i + 1) * len / img_width);
+        float hi = bb_lib::max2(v[first*4 + 1], v[first*4 + 3]);
+        float lo = bb_lib::min2(v[first*4 + 1], v[first*4 + 3]);
+        for(int j = first + 1; j < last; j++) {
+            hi = bb_lib::max3(hi, v[j*4 + 1], v[j*4 + 3]);
+            lo = bb_lib::min3(lo, v[j*4 + 1], v[j*4 + 3]);
+        }
+        col_max[i] = hi * height;
+        col_min[i] = lo * height;
+    }
+}
+
+// Only call with the map locked
+void Persistence::Touch(int column, int first, int last, float add)
+{
+    if(last < first) return;
+    int offset = column * height + first;
+    simdDecayAdd_32f(&map[offset], &stamps[offset], now, (float)log2(PERSIST_DECAY),
+                     add, last - first + 1);
 }
 
 /*
- * Turn trace into 512 by 512 min/max list
- *  either by interpolation or bin combination
- * Decay model ->
+ * Draw each column's min->max span, plus the cells joining it to the
+ *   next column's span
+ * Only the drawn cells are decayed, the rest catch up when read
  */
 void Persistence::Accumulate(const Trace *trace)
-{    
-    if(bb_lib::min2(trace->Length(), MAX_PERSIST_W) != img_width) {
+{
+    if(bb_lib::min2(trace->Length(), max_width) != img_width) {
         Reconfigure(trace);
     }
+    if(img_width <= 0) return;
 
-    GLVector trace_vector;
-    normalize_trace(trace, trace_vector, QPoint(img_width, 0));
-
-    //for(int i = 0; i < trace->Length(); i++) {
-    for(int i = 0; i < img_width; i++) {
-        max_ix[i] = trace_vector[i*4+1] * 512;
-        min_ix[i] = trace_vector[i*4+3] * 512;
-        //min_ix[i] = (short)((trace->Min()[i] + 130.0) * 5.12);
-        //max_ix[i] = (short)((trace->Max()[i] + 130.0) * 5.12);
+    Rasterize(trace);
+    AddColumns();
+}
 
-        min_ix[i] = bb_lib::max2(min_ix[i], (short)0);
-        min_ix[i] = bb_lib::min2(min_ix[i], (short)511);
+void Persistence::Accumulate(const GLVector &v)
+{
+    int len = (int)v.size() / 4;
+    if(bb_lib::min2(len, max_width) != img_width) {
+        Resize(len);
+    }
+    if(img_width <= 0) return;
 
-        max_ix[i] = bb_lib::max2(max_ix[i], (short)0);
-        max_ix[i] = bb_lib::min2(max_ix[i], (short)511);
+    Rasterize(v);
+    AddColumns();
+}
 
+void Persistence::AddColumns()
+{
+    for(int i = 0; i < img_width; i++) {
+        float hi = bb_lib::max2(bb_lib::min2(col_max[i], (float)(height - 1)), 0.0f);
+        float lo = bb_lib::max2(bb_lib::min2(col_min[i], hi), 0.0f);
+        max_ix[i] = (int)hi;
+        min_ix[i] = (int)lo;
     }
 
     // Modify the persistence map
     map_mutex.lock();
 
-    for(int i = 0; i < img_width - 1; i++) {
-        float *map_ptr = map + (i * 512);
-        // Main min->max line
-        for(int j = min_ix[i]; j <= max_ix[i]; j++) {
-            map_ptr[j] += 0.04;
-        }
-        // Draw lines between
-        for(int j = max_ix[i]; j < min_ix[i+1]; j++) {
-            map_ptr[j] += 0.01;
-        }
-        for(int j = max_ix[i]; j > max_ix[i+1]; j--) {
-            map_ptr[j] += 0.01;
+    now++;
+    for(int i = 0; i < img_width; i++) {
+        Touch(i, min_ix[i], max_ix[i], PERSIST_TRACE_HIT);
+        if(i + 1 < img_width) {
+            if(min_ix[i+1] > max_ix[i]) {
+                Touch(i, max_ix[i] + 1, min_ix[i+1] - 1, PERSIST_LINE_HIT);
+            } else if(max_ix[i+1] < min_ix[i]) {
+                Touch(i, max_ix[i+1] + 1, min_ix[i] - 1, PERSIST_LINE_HIT);
+            }
         }
+        col_stamps[i] = now;
     }
 
-    Decay();
-
     map_mutex.unlock();
 }
-
-// Only call from Accumulate, do not lock
-void Persistence::Decay()
-{
-    for(int i = 0; i < img_width * 512; i++) {
-        map[i] *= 0.975;
-    }
-}
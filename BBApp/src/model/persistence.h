@@ -2,23 +2,44 @@
 #define PERSISTENCE_H
 
 #include "../lib/macros.h"
+#include "../lib/bb_lib.h"
 
 #include <vector>
-#include <array>
 #include <mutex>
 
 class Trace;
 
+// Map size limits, see SetResolution()
+const int PERSIST_DEFAULT_W = 512;
+const int PERSIST_DEFAULT_H = 512;
+const int PERSIST_MIN_DIM = 16;
+// The image alone is 16 bytes a cell, 64MB at the largest
+const int PERSIST_MAX_DIM = 2048;
+
+/*
+ * Line persistence drawn on the CPU
+ * The map is img_width columns of Height() cells, a column is
+ *   contiguous so a trace span is one run of cells
+ * Decay is lazy, each cell remembers the sweep it was last brought up
+ *   to date and is decayed for the sweeps since when it is next touched
+ *   or read, a sweep costs the cells it draws
+ */
 class Persistence {
 public:
     Persistence();
     ~Persistence();
 
-    float* GetMap() const { return map; }
-    float* GetImage();
+    // RGBA float image of Height() rows by Width() columns, bottom row
+    //   first, only brought up to date for the sweeps since the last call
+    // Valid until the next call, owned by this class
+    const float* GetImage();
 
     int Width() const { return img_width; }
-    int Height() const { return 512; }
+    int Height() const { return height; }
+
+    // Largest width and the height of the map, clamped to
+    //   [PERSIST_MIN_DIM, PERSIST_MAX_DIM], clears the map on change
+    void SetResolution(int maxWidth, int mapHeight);
 
     // Reconfigure the persistence class to prepare
     //  for a new trace size/settings
@@ -29,21 +50,48 @@ public:
 
     // Contribute one trace to the map
     void Accumulate(const Trace *trace);
+    // Contribute one trace already normalized to the graticule, see
+    //   normalize_trace(), the width is the number of points
+    void Accumulate(const GLVector &v);
 
 protected:
 
 private:
-    void Decay();
+    // Match the map to a trace of len points
+    void Resize(int len);
+    // Trace min/max to cells per column, col_max/col_min
+    void Rasterize(const Trace *trace);
+    void Rasterize(const GLVector &v);
+    // Draw col_max/col_min as one sweep
+    void AddColumns();
+    // Decay cells [first, last] of a column and add to them
+    void Touch(int column, int first, int last, float add);
+    // Sweeps after which a column holds nothing visible
+    int DeadAge() const;
 
+    int max_width;
     int img_width;
-    // Temporarily stores traces converted to indices
-    //std::vector<short> min_ix, max_ix;
-    std::array<short, 512> min_ix, max_ix;
-    // Single channel persistence map, layout out horozontally
-    float *map;
-    // Transposed image color map, only populated when requested to
-    //   be drawn
-    float *image;
+    int height;
+    // Sweeps accumulated since the last clear
+    int now;
+
+    // Trace span per column, in cells
+    std::vector<int> min_ix, max_ix;
+    // Column max/min of the trace for the current sweep
+    std::vector<float> col_max, col_min;
+    // Single channel persistence map, column major
+    std::vector<float> map;
+    // Sweep each cell was last decayed to
+    std::vector<int> stamps;
+    // Sweep each column was last drawn on, and whether its image
+    //   column is already blank
+    std::vector<int> col_stamps;
+    std::vector<char> col_blank;
+    // Image color map, row major, only brought up to date when
+    //   requested to be drawn
+    std::vector<float> image;
+    // Sweep the image was last brought up to date to
+    int image_now;
 
     // Lock out when modifying the map
     std::mutex map_mutex;
@@ -0,0 +1,158 @@
+#include "playback_reader.h"
+#include "trace.h"
+
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Default mapping, within the address space of a 32 bit build
+#ifdef _WIN64
+const qint64 PLAYBACK_WINDOW_BYTES = qint64(256) << 20;
+#else
+const qint64 PLAYBACK_WINDOW_BYTES = qint64(64) << 20;
+#endif
+// Hinted ahead of the current sweep
+const qint64 PLAYBACK_READ_AHEAD_BYTES = qint64(8) << 20;
+// Part of a new window placed before the sweep asked for, room to
+//   step back without remapping
+const int PLAYBACK_WINDOW_BEHIND = 4; // 1/4 of the window
+
+// First byte of sweep data
+const qint64 PLAYBACK_DATA_START = sizeof(playback_header);
+
+PlaybackReader::PlaybackReader() :
+    stepSize(0),
+    windowBytes(PLAYBACK_WINDOW_BYTES),
+    window(nullptr),
+    windowFirst(0),
+    windowLast(0),
+    readAheadTo(0)
+{
+    memset(&header, 0, sizeof(header));
+}
+
+PlaybackReader::~PlaybackReader()
+{
+    Close();
+}
+
+bool PlaybackReader::Open(const QString &path)
+{
+    Close();
+
+    file.setFileName(path);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    if(file.read((char*)&header, sizeof(playback_header)) != sizeof(playback_header) ||
+            header.signature != playback_signature ||
+            header.version != playback_version ||
+            header.trace_len <= 0) {
+        Close();
+        return false;
+    }
+
+    stepSize = sizeof(qint64) + 2 * sizeof(float) * (qint64)header.trace_len;
+    qint64 inFile = (file.size() - PLAYBACK_DATA_START) / stepSize;
+    if(header.sweep_count < 0 || header.sweep_count > inFile) {
+        header.sweep_count = (int)inFile;
+    }
+
+    return true;
+}
+
+void PlaybackReader::Close()
+{
+    if(window) {
+        file.unmap(window);
+        window = nullptr;
+    }
+    windowFirst = windowLast = readAheadTo = 0;
+    if(file.isOpen()) {
+        file.close();
+    }
+}
+
+bool PlaybackReader::MapWindow(int index)
+{
+    if(window) {
+        file.unmap(window);
+        window = nullptr;
+    }
+
+    int sweeps = (int)qBound(qint64(1), windowBytes / stepSize, qint64(header.sweep_count));
+    int first = index - sweeps / PLAYBACK_WINDOW_BEHIND;
+    first = qBound(0, first, header.sweep_count - sweeps);
+
+    window = file.map(PLAYBACK_DATA_START + first * stepSize, sweeps * stepSize);
+    if(!window) {
+        windowFirst = windowLast = 0;
+        return false;
+    }
+
+    windowFirst = first;
+    windowLast = first + sweeps;
+    readAheadTo = index;
+    return true;
+}
+
+// Linux and OS X page in on the hint, the Windows cache manager reads
+//   ahead of sequential faults in a mapping without one
+void PlaybackReader::ReadAhead(int index)
+{
+    if(index < readAheadTo) return;
+
+    int last = qMin(windowLast, index + 1 +
+                    (int)qMax(qint64(1), PLAYBACK_READ_AHEAD_BYTES / stepSize));
+#ifdef Q_OS_UNIX
+    // The hint must start on a page boundary
+    const qint64 page = sysconf(_SC_PAGESIZE);
+    uchar *begin = window + (index - windowFirst) * stepSize;
+    uchar *end = window + (last - windowFirst) * stepSize;
+    uchar *aligned = (uchar*)((quintptr)begin & ~(quintptr)(page - 1));
+    posix_madvise(aligned, end - aligned, POSIX_MADV_WILLNEED);
+#endif
+    // Hint again halfway through, so the hinted range stays ahead
+    readAheadTo = index + (last - index) / 2 + 1;
+}
+
+bool PlaybackReader::View(int index, PlaybackSweep &sweep)
+{
+    if(!file.isOpen() || index < 0 || index >= header.sweep_count) {
+        return false;
+    }
+
+    if(!window || index < windowFirst || index >= windowLast) {
+        if(!MapWindow(index)) return false;
+    }
+    ReadAhead(index);
+
+    const uchar *src = window + (index - windowFirst) * stepSize;
+    memcpy(&sweep.time, src, sizeof(qint64));
+    sweep.min = (const float*)(src + sizeof(qint64));
+    sweep.max = sweep.min + header.trace_len;
+    sweep.length = header.trace_len;
+
+    return true;
+}
+
+bool PlaybackReader::Read(int index, Trace *trace)
+{
+    PlaybackSweep sweep;
+    if(!View(index, sweep)) {
+        return false;
+    }
+
+    trace->SetSize(sweep.length);
+    trace->SetUpdateRange(0, sweep.length);
+    trace->SetFreq(header.bin_size, header.trace_start_freq);
+    trace->SetTime(sweep.time);
+    memcpy(trace->Min(), sweep.min, sweep.length * sizeof(float));
+    memcpy(trace->Max(), sweep.max, sweep.length * sizeof(float));
+
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef PLAYBACK_READER_H
+#define PLAYBACK_READER_H
+
+#include <QFile>
+#include <QString>
+
+#include "lib/macros.h"
+
+class Trace;
+
+const unsigned short playback_signature = 0xBB60;
+const unsigned short playback_version = 0x1;
+
+// Version 1 header
+// Followed by sweep_count sweeps of trace_len bins, each the time in
+//   ms since epoch (qint64), the min array then the max array (float)
+struct playback_header {
+    unsigned short signature;
+    unsigned short version;
+
+    int sweep_count;
+
+    ushort title[MAX_TITLE_LEN + 1];
+    double center_freq; // Sweep settings
+    double span;
+    double rbw;
+    double vbw;
+    double ref_level;
+    double div;
+    int atten;
+    int gain;
+    int detector;
+
+    int trace_len;
+    double trace_start_freq;
+    double bin_size;
+};
+
+// One sweep of a playback file, points into the file mapping
+struct PlaybackSweep {
+    qint64 time; // ms since epoch
+    const float *min;
+    const float *max;
+    int length;
+};
+
+/*
+ * Random access reader for .bbr playback files
+ * The file is mapped a window at a time, a window holds whole sweeps
+ *   and is placed with most of it ahead of the sweep asked for, so
+ *   playing forward, stepping back and scrubbing nearby sweeps cost
+ *   no system calls, a new window is mapped only when a sweep falls
+ *   outside the current one
+ * The pages ahead of each sweep handed out are hinted to the OS so
+ *   they are read before they are needed
+ * Not thread safe, one thread reads at a time
+ */
+class PlaybackReader {
+public:
+    PlaybackReader();
+    ~PlaybackReader();
+
+    // Checks the signature and version, the sweep count is limited to
+    //   the sweeps in the file in case the recording was cut short
+    bool Open(const QString &path);
+    void Close();
+    bool IsOpen() const { return file.isOpen(); }
+    QString FileName() const { return file.fileName(); }
+
+    const playback_header& Header() const { return header; }
+    int SweepCount() const { return header.sweep_count; }
+    int TraceLength() const { return header.trace_len; }
+
+    // Mapping size, rounded to whole sweeps, at least one sweep
+    // Takes effect when the next window is mapped
+    void SetWindowSize(qint64 bytes) { windowBytes = bytes; }
+
+    // View of sweep index, valid until a sweep outside the current
+    //   window is asked for or the file is closed
+    // Returns false if index is not in the file
+    bool View(int index, PlaybackSweep &sweep);
+    // Copy sweep index into trace with the frequencies of the file
+    bool Read(int index, Trace *trace);
+
+private:
+    // Map the window around index
+    bool MapWindow(int index);
+    // Ask the OS to read the sweeps following index
+    void ReadAhead(int index);
+
+    QFile file;
+    playback_header header;
+    qint64 stepSize; // Bytes per sweep
+    qint64 windowBytes;
+
+    uchar *window;
+    int windowFirst; // Sweeps [windowFirst, windowLast) are mapped
+    int windowLast;
+    int readAheadTo; // Sweeps before this have been hinted
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(PlaybackReader)
+};
+
+#endif // PLAYBACK_READER_H
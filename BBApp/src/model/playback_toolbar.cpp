@@ -45,8 +45,9 @@ void PlaybackFile::GetSweepConfig(SweepSettings *ss, QString &title)
 
 bool PlaybackFile::GetSweep(Trace *trace)
 {
-    qint64 time;
-    if(!is_playing || !file_handle.isOpen()) {
+    std::lock_guard<std::mutex> lg(reader_mutex);
+
+    if(!is_playing || !reader.IsOpen()) {
         return false;
     }
 
@@ -54,18 +55,9 @@ bool PlaybackFile::GetSweep(Trace *trace)
         return true;
     }
 
-    //std::lock_guard<std::mutex> lg(buffer_mutex);
-
-    trace->SetSize(header.trace_len);
-    trace->SetUpdateRange(0, trace->Length());
-    trace->SetFreq(header.bin_size, header.trace_start_freq);
-
-    file_handle.seek(data_start + step_size * trace_pos);
-
-    file_handle.read((char*)&time, sizeof(qint64));
-    trace->SetTime(time);
-    file_handle.read((char*)trace->Min(), sizeof(float) * header.trace_len);
-    file_handle.read((char*)trace->Max(), sizeof(float) * header.trace_len);
+    if(!reader.Read(trace_pos, trace)) {
+        return false;
+    }
 
     trace_pos++;
 
@@ -137,7 +129,8 @@ void PlaybackFile::CloseFile()
     is_playing = false;
     trace_pos = 0;
 
-    file_handle.close();
+    std::lock_guard<std::mutex> lg(reader_mutex);
+    reader.Close();
 }
 
 void PlaybackFile::CloseRecording()
@@ -188,29 +181,19 @@ bool PlaybackFile::play()
                                                      tr("Sweep Files (*.bbr)"));
     if(file_name.isNull()) return false;
 
-    file_handle.setFileName(file_name);
-    file_handle.open(QIODevice::ReadOnly);
-    if(!file_handle.isOpen()) {
-        return false;
-    } else {
-        trace_pos = 0;
-        is_playing = true;
-    }
-
-    // Get header, check signature and version
-    file_handle.read((char*)&header, sizeof(playback_header));
+    // Checks signature and version
+    reader_mutex.lock();
+    bool opened = reader.Open(file_name);
+    if(opened) header = reader.Header();
+    reader_mutex.unlock();
 
-    if(header.signature != playback_signature) {
+    if(!opened) {
         QMessageBox::warning(0, tr("Invalid File"), tr("Unable to recognize playback file"));
         return false;
     }
 
-    if(header.version != playback_version) {
-        QMessageBox::warning(0, tr("Unknown file version"), tr("Unrecognized file version"));
-        return false;
-    }
-
-    step_size = 2.0 * sizeof(float) * header.trace_len + sizeof(qint64);
+    trace_pos = 0;
+    is_playing = true;
 
     return true;
 }
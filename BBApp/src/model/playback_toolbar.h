@@ -6,38 +6,13 @@
 #include "session.h"
 #include "sweep_settings.h"
 #include "trace.h"
+#include "playback_reader.h"
 
 #include <QToolBar>
 #include <QPushButton>
 #include <QFile>
 #include <QBuffer>
 
-const unsigned short playback_signature = 0xBB60;
-const unsigned short playback_version = 0x1;
-
-// Version 1 header
-struct playback_header {
-    unsigned short signature;
-    unsigned short version;
-
-    int sweep_count;
-
-    ushort title[MAX_TITLE_LEN + 1];
-    double center_freq; // Sweep settings
-    double span;
-    double rbw;
-    double vbw;
-    double ref_level;
-    double div;
-    int atten;
-    int gain;
-    int detector;
-
-    int trace_len;
-    double trace_start_freq;
-    double bin_size;
-};
-
 class PlaybackFile : public QObject {
     Q_OBJECT
 
@@ -77,7 +52,11 @@ private:
 
     ulong timeout;
 
-    QFile file_handle;
+    QFile file_handle; // Recording
+    PlaybackReader reader; // Playback
+    // Held while reading from the reader mapping, the GUI thread
+    //   closes the reader while the playback thread reads it
+    std::mutex reader_mutex;
     std::mutex buffer_mutex;
     std::atomic<bool> is_recording;
     std::atomic<bool> is_playing;
@@ -6,6 +6,8 @@
 #include <QFile>
 
 #include "lib/bb_lib.h"
+#include "views/waterfall_ring.h"
+#include "model/persistence.h"
 
 #if _WIN64
 static const int platformMaxFileSize = 4;
@@ -31,6 +33,10 @@ public:
 
         sweepDelay = 0;
         realTimeFrameRate = 30;
+        waterfallDepth = WATERFALL_DEFAULT_DEPTH;
+        persistResolution = PERSIST_DEFAULT_W;
+        fastAmplitudeConversion = true;
+        SetAmpConvertMode(AmpConvertFast);
     }
 
     void Load() {
@@ -46,9 +52,15 @@ public:
         trace_width = s.value("ViewPrefs/TraceWidth", 1.0).toFloat();
         graticule_width = s.value("ViewPrefs/GraticuleWidth", 1.0).toFloat();
         graticule_stipple = s.value("ViewPrefs/GraticuleStipple", true).toBool();
+        waterfallDepth = s.value("ViewPrefs/WaterfallDepth", WATERFALL_DEFAULT_DEPTH).toInt();
+        bb_lib::clamp(waterfallDepth, WATERFALL_MIN_DEPTH, WATERFALL_MAX_DEPTH);
+        persistResolution = s.value("ViewPrefs/PersistenceResolution", PERSIST_DEFAULT_W).toInt();
+        bb_lib::clamp(persistResolution, PERSIST_MIN_DIM, PERSIST_MAX_DIM);
 
         sweepDelay = s.value("SweepPrefs/Delay", 0).toInt();
         realTimeFrameRate = s.value("SweepPrefs/RealTimeFrameRate", 30).toInt();
+        fastAmplitudeConversion = s.value("SweepPrefs/FastAmplitudeConversion", true).toBool();
+        SetAmpConvertMode(fastAmplitudeConversion ? AmpConvertFast : AmpConvertExact);
     }
 
     void Save() const {
@@ -63,9 +75,12 @@ public:
         s.setValue("ViewPrefs/TraceWidth", trace_width);
         s.setValue("ViewPrefs/GraticuleWidth", graticule_width);
         s.setValue("ViewPrefs/GraticuleStipple", graticule_stipple);
+        s.setValue("ViewPrefs/WaterfallDepth", waterfallDepth);
+        s.setValue("ViewPrefs/PersistenceResolution", persistResolution);
 
         s.setValue("SweepPrefs/Delay", sweepDelay);
         s.setValue("SweepPrefs/RealTimeFrameRate", realTimeFrameRate);
+        s.setValue("SweepPrefs/FastAmplitudeConversion", fastAmplitudeConversion);
     }
 
     QString GetDefaultSaveDirectory() const;
@@ -111,10 +126,18 @@ public:
     float trace_width;
     float graticule_width;
     bool graticule_stipple;
+    // Lines of waterfall history [16, 4096], about 24 bytes per
+    //   point per line plus 16 for texture coordinates
+    int waterfallDepth;
+    // Width and height of the software persistence map, a power of two
+    //   in [16, 4096], only used without framebuffer objects
+    int persistResolution;
 
     // Arbitrary sweep delay
     int sweepDelay; // In ms [0, 2048]
     int realTimeFrameRate; // In fps [30 - 250]
+    // Approximate dB <-> linear trace conversions, see amplitude.h
+    bool fastAmplitudeConversion;
 };
 
 #endif // PREFERENCES_H
@@ -0,0 +1,120 @@
+#include "realtime_colorizer.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define RT_COLORIZE_SSE2
+#include <emmintrin.h>
+#endif
+
+static inline float clamp01(float f)
+{
+    return (f < 0.0f) ? 0.0f : ((f > 1.0f) ? 1.0f : f);
+}
+
+// Pack to RGBA byte order in memory
+static inline unsigned int packRGBA(float r, float g, float b, int a)
+{
+    unsigned char bytes[4] = {
+        (unsigned char)(clamp01(r) * 255.0f + 0.5f),
+        (unsigned char)(clamp01(g) * 255.0f + 0.5f),
+        (unsigned char)(clamp01(b) * 255.0f + 0.5f),
+        (unsigned char)a
+    };
+    unsigned int packed;
+    memcpy(&packed, bytes, 4);
+    return packed;
+}
+
+RealTimeColorizer::RealTimeColorizer()
+{
+    colormap = RealTimeColormapSpectrum;
+    intensity = 25;
+    BuildLUT(RealTimeColormapSpectrum, 25);
+}
+
+void RealTimeColorizer::BuildLUT(RealTimeColormap map, int newIntensity)
+{
+    bb_lib::clamp(newIntensity, 1, 99);
+    float scale = 100.0f / (100 - newIntensity);
+
+    lut[0] = packRGBA(0.0f, 0.0f, 0.0f, 0);
+
+    for(int i = 1; i < LUT_SIZE; i++) {
+        float L = clamp01(i / 255.0f * scale);
+        float r, g, b;
+
+        switch(map) {
+        case RealTimeColormapGray:
+            r = g = b = L;
+            break;
+        case RealTimeColormapHot:
+            r = 3.0f * L;
+            g = 3.0f * L - 1.0f;
+            b = 3.0f * L - 2.0f;
+            break;
+        case RealTimeColormapSpectrum:
+        default:
+            // Blue -> green -> red, as the spectrogram
+            r = (L - 0.5f) * 4.0f;
+            g = clamp01(4.0f * L) - clamp01(4.0f * L - 3.0f);
+            b = (0.5f - L) * 4.0f;
+            break;
+        }
+
+        lut[i] = packRGBA(r, g, b, 255);
+    }
+
+    lutColormap = map;
+    lutIntensity = newIntensity;
+}
+
+void RealTimeColorizer::Colorize(RealTimeFrame &frame)
+{
+    RealTimeColormap map = (RealTimeColormap)colormap.load();
+    int newIntensity = intensity;
+    if(map != lutColormap || newIntensity != lutIntensity) {
+        BuildLUT(map, newIntensity);
+    }
+
+    int len = frame.dim.width() * frame.dim.height();
+    Q_ASSERT((int)frame.alphaFrame.size() >= len);
+    Q_ASSERT((int)frame.rgbFrame.size() >= len * 4);
+    if(len <= 0) return;
+
+    const float *src = &frame.alphaFrame[0];
+    unsigned int *dst = reinterpret_cast<unsigned int*>(&frame.rgbFrame[0]);
+    int i = 0;
+
+    // Any alpha > 0 maps to at least entry 1 so faint pixels stay opaque
+#ifdef RT_COLORIZE_SSE2
+    const __m128 vScale = _mm_set1_ps(255.0f);
+    const __m128 vZero = _mm_setzero_ps();
+    const __m128i vOne = _mm_set1_epi32(1);
+    const __m128i vZeroI = _mm_setzero_si128();
+    int ix[4];
+
+    for(; i + 4 <= len; i += 4) {
+        __m128 a = _mm_loadu_ps(src + i);
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(a, vScale), vZero), vScale);
+        __m128i level = _mm_cvttps_epi32(v);
+        __m128i bump = _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(a, vZero)),
+                                     _mm_cmpeq_epi32(level, vZeroI));
+        level = _mm_add_epi32(level, _mm_and_si128(bump, vOne));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ix), level);
+
+        dst[i] = lut[ix[0]];
+        dst[i+1] = lut[ix[1]];
+        dst[i+2] = lut[ix[2]];
+        dst[i+3] = lut[ix[3]];
+    }
+#endif
+
+    for(; i < len; i++) {
+        float a = src[i];
+        int level = 0;
+        if(a > 0.0f) {
+            level = (int)(bb_lib::min2(a * 255.0f, 255.0f));
+            if(level == 0) level = 1;
+        }
+        dst[i] = lut[level];
+    }
+}
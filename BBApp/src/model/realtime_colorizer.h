@@ -0,0 +1,52 @@
+#ifndef REALTIME_COLORIZER_H
+#define REALTIME_COLORIZER_H
+
+#include <atomic>
+
+#include "trace.h"
+#include "lib/macros.h"
+
+// Must correspond to combo-box indices
+enum RealTimeColormap {
+    RealTimeColormapSpectrum = 0,
+    RealTimeColormapGray = 1,
+    RealTimeColormapHot = 2
+};
+
+/*
+ * Converts the persistence (alpha) frame returned by the device into
+ *   the RGBA image drawn by the trace view.
+ * Each alpha value is quantized to one of 256 levels and looked up in
+ *   a table which already includes the colormap and intensity, so the
+ *   per-pixel work is a scale, a convert and a table lookup.
+ * Settings may be changed from any thread, the table is rebuilt by
+ *   the converting thread on the next frame.
+ */
+class RealTimeColorizer {
+public:
+    RealTimeColorizer();
+    ~RealTimeColorizer() {}
+
+    void SetColormap(RealTimeColormap map) { colormap = map; }
+    // Intensity in [1,99], as on the toolbar slider
+    // Scales the alpha values by 100 / (100 - intensity)
+    void SetIntensity(int newIntensity) { intensity = newIntensity; }
+
+    // Fill frame.rgbFrame from frame.alphaFrame
+    void Colorize(RealTimeFrame &frame);
+
+    static const int LUT_SIZE = 256;
+
+private:
+    void BuildLUT(RealTimeColormap map, int newIntensity);
+
+    std::atomic<int> colormap, intensity;
+    int lutColormap, lutIntensity; // Values the table was built with
+    // RGBA bytes in memory order, entry 0 is fully transparent
+    unsigned int lut[LUT_SIZE];
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(RealTimeColorizer)
+};
+
+#endif // REALTIME_COLORIZER_H
@@ -3,6 +3,8 @@
 
 #include "device_bb60a.h"
 #include "device_sa.h"
+#include "device_sim.h"
+#include "device_group.h"
 
 #include "sweep_settings.h"
 #include "demod_settings.h"
@@ -11,8 +13,6 @@
 #include "color_prefs.h"
 #include "preferences.h"
 
-const int MAX_TITLE_LEN = 127;
-
 class Session : public QObject {
     Q_OBJECT
 
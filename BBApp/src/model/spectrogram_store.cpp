@@ -0,0 +1,460 @@
+#include "spectrogram_store.h"
+#include "trace.h"
+#include "lib/bb_lib.h"
+#include "lib/simd_kernels.h"
+#include "views/software_renderer.h"
+
+#include <cstring>
+
+#include <QTextStream>
+
+namespace {
+
+const char SPEC_MAGIC[8] = { 'S', 'H', 'S', 'P', 'E', 'C', '0', '1' };
+const int TILE_CELLS = SPEC_TILE * SPEC_TILE;
+
+qint64 alignUp(qint64 bytes, qint64 align)
+{
+    return ((bytes + align - 1) / align) * align;
+}
+
+// Ceiling of n / 2^shift
+qint64 ceilShift(qint64 n, int shift)
+{
+    return (n + (1LL << shift) - 1) >> shift;
+}
+
+} // namespace
+
+SpectrogramStore::SpectrogramStore() :
+    maxBytes(0),
+    open(false),
+    full(false),
+    generation(0),
+    map(nullptr),
+    div(10.0),
+    times(nullptr)
+{
+    memset(&header, 0, sizeof(header));
+}
+
+SpectrogramStore::~SpectrogramStore()
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    Release();
+}
+
+// Mapping the whole budget once up front catches a full disk or too
+//   little address space while the user can still be told
+bool SpectrogramStore::Open(const QString &filePath, qint64 bytes)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+
+    Release();
+    path = filePath;
+    maxBytes = bytes;
+    full = false;
+    error.clear();
+
+    file.setFileName(path);
+    if(!file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        error = file.errorString();
+        return false;
+    }
+    uchar *trial = nullptr;
+    if(!file.resize(maxBytes) || (trial = file.map(0, maxBytes)) == nullptr) {
+        error = file.errorString();
+        file.close();
+        file.remove();
+        return false;
+    }
+    file.unmap(trial);
+
+    open = true;
+    return true;
+}
+
+QString SpectrogramStore::ErrorString() const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return error;
+}
+
+void SpectrogramStore::Close()
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    open = false;
+}
+
+void SpectrogramStore::Release()
+{
+    if(map) {
+        file.unmap(map);
+        map = nullptr;
+        times = nullptr;
+    }
+    if(file.isOpen()) {
+        file.close();
+    }
+    memset(&header, 0, sizeof(header));
+    levels.clear();
+    open = false;
+    generation++;
+}
+
+qint64 SpectrogramStore::Rows() const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return header.rows;
+}
+
+int SpectrogramStore::Bins() const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return header.bins;
+}
+
+qint64 SpectrogramStore::RowTime(qint64 row) const
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if(!times || row < 0 || row >= header.rows) return 0;
+    return times[row];
+}
+
+/*
+ * Rows are sized from the budget, then shrunk until the tile padding
+ *   fits as well
+ * Layout: header, one timestamp per row, then every level (t, f) in
+ *   order, each a grid of tiles, rows of tiles left to right
+ */
+bool SpectrogramStore::Create(const Trace *sweep)
+{
+    const int bins = sweep->Length();
+    if(bins <= 0) return false;
+
+    std::vector<int> cols(1, bins);
+    while(ceilShift(bins, (int)cols.size()) >= SPEC_MIN_LEVEL_BINS) {
+        cols.push_back((int)ceilShift(bins, (int)cols.size()));
+    }
+    const int freqLevels = (int)cols.size();
+
+    double cellsPerRow = 0.0;
+    for(int c : cols) cellsPerRow += c;
+    cellsPerRow *= 2.0; // Time levels, 1 + 1/2 + 1/4 ...
+    qint64 maxRows = (qint64)((maxBytes - SPEC_HEADER_BYTES) / (cellsPerRow * sizeof(float) + 8));
+    maxRows = (maxRows / SPEC_TILE) * SPEC_TILE;
+
+    qint64 total = 0;
+    int timeLevels = 0;
+    while(maxRows >= SPEC_TILE) {
+        levels.clear();
+        total = alignUp(SPEC_HEADER_BYTES + maxRows * 8, TILE_CELLS * sizeof(float));
+        timeLevels = 0;
+        while(timeLevels < SPEC_MAX_TIME_LEVELS && (maxRows >> timeLevels) > 0) {
+            for(int f = 0; f < freqLevels; f++) {
+                Level l;
+                l.offset = total;
+                l.rows = maxRows >> timeLevels;
+                l.cols = cols[f];
+                l.tilesAcross = (int)ceilShift(l.cols, 6);
+                levels.push_back(l);
+                total += (qint64)l.tilesAcross * ceilShift(l.rows, 6) * TILE_CELLS * sizeof(float);
+            }
+            timeLevels++;
+        }
+        if(total <= maxBytes) break;
+        maxRows -= bb_lib::max2((qint64)SPEC_TILE, ((maxRows / 16) / SPEC_TILE) * SPEC_TILE);
+    }
+    if(maxRows < SPEC_TILE) {
+        error = QString("A sweep of %1 points does not fit %2 times in the size limit")
+                .arg(bins).arg(SPEC_TILE);
+        return false;
+    }
+
+    // Opened by Open()
+    if(!file.resize(total) || (map = file.map(0, total)) == nullptr) {
+        error = file.errorString();
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SPEC_MAGIC, sizeof(header.magic));
+    header.bins = bins;
+    header.logScale = sweep->GetSettings()->RefLevel().IsLogScale() ? 1 : 0;
+    header.startFreq = sweep->StartFreq();
+    header.binSize = sweep->BinSize();
+    header.maxRows = maxRows;
+    header.rows = 0;
+    header.timeLevels = timeLevels;
+    header.freqLevels = freqLevels;
+    memcpy(map, &header, sizeof(header));
+
+    refLevel = sweep->GetSettings()->RefLevel();
+    div = sweep->GetSettings()->Div();
+
+    times = (qint64*)(map + SPEC_HEADER_BYTES);
+    rowBufs.resize(freqLevels);
+    for(int f = 0; f < freqLevels; f++) {
+        rowBufs[f].resize(cols[f]);
+    }
+    pairA.resize(bins);
+    pairB.resize(bins);
+
+    return true;
+}
+
+void SpectrogramStore::WriteRow(const Level &l, qint64 row, const float *src)
+{
+    float *base = (float*)(map + l.offset)
+            + ((row / SPEC_TILE) * l.tilesAcross * TILE_CELLS)
+            + (row % SPEC_TILE) * SPEC_TILE;
+
+    for(int tc = 0; tc < l.tilesAcross; tc++) {
+        int c = tc * SPEC_TILE;
+        int n = bb_lib::min2(SPEC_TILE, l.cols - c);
+        memcpy(base + tc * TILE_CELLS, src + c, n * sizeof(float));
+    }
+}
+
+void SpectrogramStore::ReadRow(const Level &l, qint64 row, int c0, int c1, float *dst) const
+{
+    const float *base = (const float*)(map + l.offset)
+            + ((row / SPEC_TILE) * l.tilesAcross * TILE_CELLS)
+            + (row % SPEC_TILE) * SPEC_TILE;
+
+    while(c0 < c1) {
+        int tc = c0 / SPEC_TILE;
+        int inTile = c0 % SPEC_TILE;
+        int n = bb_lib::min2(SPEC_TILE - inTile, c1 - c0);
+        memcpy(dst, base + tc * TILE_CELLS + inTile, n * sizeof(float));
+        dst += n;
+        c0 += n;
+    }
+}
+
+// Max of the sweep, with the frequency levels decimated from it, then
+//   any time level whose 2^t sweeps are now complete
+bool SpectrogramStore::Append(const Trace *sweep)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+
+    if(!open || full) return false;
+    if(!map && !Create(sweep)) {
+        open = false;
+        return false;
+    }
+    if(sweep->Length() != header.bins ||
+            sweep->StartFreq() != header.startFreq ||
+            sweep->BinSize() != header.binSize ||
+            header.rows >= header.maxRows) {
+        full = true;
+        return false;
+    }
+
+    const qint64 row = header.rows;
+
+    memcpy(&rowBufs[0][0], sweep->Max(), header.bins * sizeof(float));
+    WriteRow(GetLevel(0, 0), row, &rowBufs[0][0]);
+    for(int f = 1; f < header.freqLevels; f++) {
+        const std::vector<float> &prev = rowBufs[f - 1];
+        std::vector<float> &cur = rowBufs[f];
+        const int last = (int)prev.size() - 1;
+        for(int c = 0; c < (int)cur.size(); c++) {
+            cur[c] = bb_lib::max2(prev[2*c], prev[bb_lib::min2(2*c + 1, last)]);
+        }
+        WriteRow(GetLevel(0, f), row, &cur[0]);
+    }
+
+    for(int t = 1; t < header.timeLevels && ((row + 1) & ((1LL << t) - 1)) == 0; t++) {
+        qint64 k = row >> t;
+        for(int f = 0; f < header.freqLevels; f++) {
+            const Level &src = GetLevel(t - 1, f);
+            ReadRow(src, 2*k, 0, src.cols, &pairA[0]);
+            ReadRow(src, 2*k + 1, 0, src.cols, &pairB[0]);
+            simdMax_32f(&pairA[0], &pairB[0], &pairA[0], src.cols);
+            WriteRow(GetLevel(t, f), k, &pairA[0]);
+        }
+    }
+
+    times[row] = sweep->Time();
+    header.rows = row + 1;
+    memcpy(map, &header, sizeof(header));
+
+    return true;
+}
+
+bool SpectrogramStore::Resolve(SpectrogramRegion &region) const
+{
+    if(region.lastRow <= region.firstRow) {
+        region.firstRow = 0;
+        region.lastRow = header.rows;
+    }
+    if(region.lastBin <= region.firstBin) {
+        region.firstBin = 0;
+        region.lastBin = header.bins;
+    }
+    bb_lib::clamp(region.firstRow, (qint64)0, header.rows);
+    bb_lib::clamp(region.lastRow, region.firstRow, header.rows);
+    bb_lib::clamp(region.firstBin, 0, header.bins);
+    bb_lib::clamp(region.lastBin, region.firstBin, header.bins);
+
+    return region.lastRow > region.firstRow && region.lastBin > region.firstBin;
+}
+
+/*
+ * The coarsest level with at least rows x cols cells over the region,
+ *   so each output value is the max of at most about 2 x 2 cells
+ * A time level only holds completed groups of sweeps, it is only used
+ *   while one covers the region
+ */
+bool SpectrogramStore::Read(SpectrogramRegion region, int rows, int cols, float *dst)
+{
+    std::unique_lock<std::mutex> lock(storeMutex);
+
+    if(!map || rows <= 0 || cols <= 0 || !Resolve(region)) return false;
+
+    const qint64 spanRows = region.lastRow - region.firstRow;
+    const int spanBins = region.lastBin - region.firstBin;
+
+    int t = 0;
+    while(t + 1 < header.timeLevels && (spanRows >> (t + 1)) >= rows) t++;
+    while(t > 0 && (region.lastRow >> t) <= (region.firstRow >> t)) t--;
+    int f = 0;
+    while(f + 1 < header.freqLevels && (spanBins >> (f + 1)) >= cols) f++;
+
+    // Rows already written never change, only a Release() between
+    //   chunks invalidates them
+    const Level l = GetLevel(t, f);
+    const int readGeneration = generation;
+    const qint64 r0 = region.firstRow >> t;
+    const qint64 r1 = bb_lib::min2(ceilShift(region.lastRow, t), header.rows >> t);
+    const int c0 = region.firstBin >> f;
+    const int c1 = bb_lib::min2((int)ceilShift(region.lastBin, f), l.cols);
+    const qint64 srcRows = r1 - r0;
+    const int srcCols = c1 - c0;
+
+    // Append() uses pairA/pairB
+    std::vector<float> rowMax(srcCols), rowNext(srcCols);
+
+    for(int y = 0; y < rows; y++) {
+        if(y % READ_CHUNK_ROWS == 0 && y > 0) {
+            lock.unlock();
+            lock.lock();
+            if(generation != readGeneration) return false;
+        }
+
+        qint64 a = r0 + y * srcRows / rows;
+        qint64 b = bb_lib::max2(r0 + (y + 1) * srcRows / rows, a + 1);
+        ReadRow(l, a, c0, c1, &rowMax[0]);
+        for(qint64 r = a + 1; r < b; r++) {
+            ReadRow(l, r, c0, c1, &rowNext[0]);
+            simdMax_32f(&rowMax[0], &rowNext[0], &rowMax[0], srcCols);
+        }
+
+        float *out = dst + (qint64)y * cols;
+        for(int x = 0; x < cols; x++) {
+            int s = (int)((qint64)x * srcCols / cols);
+            int e = bb_lib::max2((int)((qint64)(x + 1) * srcCols / cols), s + 1);
+            float m = rowMax[s];
+            for(int i = s + 1; i < e; i++) {
+                m = bb_lib::max2(m, rowMax[i]);
+            }
+            out[x] = m;
+        }
+    }
+
+    return true;
+}
+
+bool SpectrogramStore::ExportImage(const QString &imagePath, SpectrogramRegion region,
+                                   QSize size)
+{
+    const int w = size.width(), h = size.height();
+    if(w <= 0 || h <= 0) return false;
+
+    std::vector<float> values((qint64)w * h);
+    if(!Read(region, h, w, &values[0])) return false;
+
+    // Same vertical scale as normalize_trace()
+    double ref, botRef;
+    if(header.logScale) {
+        ref = refLevel.ConvertToUnits(AmpUnits::DBM);
+        botRef = ref - 10.0 * div;
+    } else {
+        ref = refLevel.Val();
+        botRef = 0.0;
+    }
+    float scale = (float)(1.0 / (ref - botRef));
+    float offset = (float)(-botRef / (ref - botRef));
+
+    // Newest row first
+    std::vector<float> intensity(values.size());
+    for(int y = 0; y < h; y++) {
+        simdCombine_32f(&values[(qint64)(h - 1 - y) * w], scale,
+                        &values[(qint64)(h - 1 - y) * w], 0.0f, offset,
+                        &intensity[(qint64)y * w], w);
+    }
+
+    QImage image(size, QImage::Format_RGBA8888);
+    SoftwareRenderer renderer;
+    renderer.RenderIntensity(&intensity[0], w, h, image);
+
+    return image.save(imagePath);
+}
+
+bool SpectrogramStore::ExportCSV(const QString &csvPath, SpectrogramRegion region,
+                                 int maxRows, int maxCols)
+{
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if(!map || !Resolve(region)) return false;
+    }
+
+    const qint64 spanRows = region.lastRow - region.firstRow;
+    const int spanBins = region.lastBin - region.firstBin;
+    const int rows = (int)bb_lib::min2(spanRows, (qint64)bb_lib::max2(maxRows, 1));
+    const int cols = bb_lib::min2(spanBins, bb_lib::max2(maxCols, 1));
+
+    QFile csv(csvPath);
+    if(!csv.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QTextStream out(&csv);
+
+    out << "Units, " << (header.logScale ? "dBm" : "mV") << "\n";
+    out << "Time (ms)";
+    for(int x = 0; x < cols; x++) {
+        int bin = region.firstBin + (int)((qint64)x * spanBins / cols);
+        out << ", " << (header.startFreq + bin * header.binSize) / 1.0e6;
+    }
+    out << "\n";
+
+    // A block of output rows at a time, each block is the sub-region
+    //   its rows cover
+    const int blockRows = bb_lib::min2(rows, CSV_BLOCK_ROWS);
+    std::vector<float> values((qint64)blockRows * cols);
+    for(int y0 = 0; y0 < rows; y0 += blockRows) {
+        int y1 = bb_lib::min2(y0 + blockRows, rows);
+        SpectrogramRegion block(region.firstRow + y0 * spanRows / rows,
+                                region.firstRow + y1 * spanRows / rows,
+                                region.firstBin, region.lastBin);
+        if(!Read(block, y1 - y0, cols, &values[0])) {
+            csv.close();
+            return false;
+        }
+
+        for(int y = y0; y < y1; y++) {
+            out << RowTime(region.firstRow + y * spanRows / rows);
+            const float *v = &values[(qint64)(y - y0) * cols];
+            for(int x = 0; x < cols; x++) {
+                out << ", " << v[x];
+            }
+            out << "\n";
+        }
+    }
+
+    csv.close();
+
+    return true;
+}
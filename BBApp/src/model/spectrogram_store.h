@@ -0,0 +1,159 @@
+#ifndef SPECTROGRAM_STORE_H
+#define SPECTROGRAM_STORE_H
+
+#include <mutex>
+#include <vector>
+
+#include <QFile>
+#include <QSize>
+#include <QString>
+
+#include "lib/macros.h"
+#include "lib/amplitude.h"
+
+class Trace;
+
+// Tile edge in cells, a tile is 64 x 64 floats
+const int SPEC_TILE = 64;
+// Pyramid depth, time levels halve the rows, frequency levels halve
+//   the bins down to no fewer than SPEC_MIN_LEVEL_BINS
+const int SPEC_MAX_TIME_LEVELS = 16;
+const int SPEC_MIN_LEVEL_BINS = 64;
+// Space before the timestamps, see SpectrogramFileHeader
+const qint64 SPEC_HEADER_BYTES = 4096;
+
+// At the start of the file, rows is updated with every sweep
+struct SpectrogramFileHeader {
+    char magic[8]; // "SHSPEC01"
+    qint32 bins;
+    qint32 logScale; // dBm if non-zero, mV otherwise
+    double startFreq; // Hz
+    double binSize; // Hz
+    qint64 maxRows;
+    qint64 rows;
+    qint32 timeLevels;
+    qint32 freqLevels;
+};
+
+// Rows [firstRow, lastRow) by bins [firstBin, lastBin), an empty
+//   range selects everything recorded
+struct SpectrogramRegion {
+    SpectrogramRegion() : firstRow(0), lastRow(0), firstBin(0), lastBin(0) {}
+    SpectrogramRegion(qint64 r0, qint64 r1, int b0, int b1)
+        : firstRow(r0), lastRow(r1), firstBin(b0), lastBin(b1) {}
+
+    qint64 firstRow, lastRow;
+    int firstBin, lastBin;
+};
+
+/*
+ * Spectrogram of every full sweep, recorded to a memory mapped file
+ *   so a recording can run for hours
+ * The file holds a pyramid of levels, level (t, f) is the max of 2^t
+ *   sweeps by 2^f bins, level (0, 0) is the sweep at full resolution
+ * Each level is stored in SPEC_TILE square tiles, a region of any
+ *   level is a handful of pages
+ * A coarser time level is written when its 2^t sweeps are complete,
+ *   so each sweep costs about four times its bins across all levels
+ * Read() picks the level nearest the output size, any view costs
+ *   about its own pixel count whatever the region
+ */
+class SpectrogramStore {
+public:
+    SpectrogramStore();
+    ~SpectrogramStore();
+
+    // Record to path, the file is laid out on the first sweep to hold
+    //   as many sweeps as fit in maxBytes
+    // Releases any previous recording
+    // Returns false if the file cannot be created and mapped at that
+    //   size, see ErrorString()
+    bool Open(const QString &path, qint64 maxBytes);
+    // Stop recording, the file stays mapped so the recording can still
+    //   be read and exported until the next Open()
+    void Close();
+    bool IsOpen() const { return open; }
+    // Recording stopped because the file is full or the sweep
+    //   layout changed
+    bool IsFull() const { return full; }
+    // Why Open() failed, or why recording stopped on its own
+    QString ErrorString() const;
+
+    // Add one full sweep, returns false if it was not recorded
+    // Recording stops, IsOpen() false, if the first sweep cannot be
+    //   laid out within the size limit
+    bool Append(const Trace *sweep);
+
+    qint64 Rows() const;
+    int Bins() const;
+    double StartFreq() const { return header.startFreq; }
+    double BinSize() const { return header.binSize; }
+    // Milliseconds since epoch of a row
+    qint64 RowTime(qint64 row) const;
+
+    // Max of region resampled to rows x cols, oldest row first,
+    //   dst holds rows * cols values
+    // The lock is only held for a few rows at a time, recording goes on
+    //   during a long read
+    // Returns false if nothing is recorded in the region
+    bool Read(SpectrogramRegion region, int rows, int cols, float *dst);
+
+    // Newest row at the top, colored like the waterfall over the
+    //   reference level and division the recording started with
+    bool ExportImage(const QString &path, SpectrogramRegion region, QSize size);
+    // Time in ms and one column per bin in MHz, at most maxRows by
+    //   maxCols values
+    bool ExportCSV(const QString &path, SpectrogramRegion region, int maxRows, int maxCols);
+
+private:
+    struct Level {
+        qint64 offset; // Bytes into the file
+        qint64 rows; // Capacity
+        int cols;
+        int tilesAcross;
+    };
+
+    // Size and map the file for the layout of the first sweep
+    bool Create(const Trace *sweep);
+    // Rows read per hold of storeMutex in Read()
+    static const int READ_CHUNK_ROWS = 16;
+    // Output rows resampled at once by ExportCSV()
+    static const int CSV_BLOCK_ROWS = 256;
+    // Unmap and close the file, forgetting the recording
+    void Release();
+    const Level& GetLevel(int t, int f) const {
+        return levels[t * header.freqLevels + f];
+    }
+    void WriteRow(const Level &l, qint64 row, const float *src);
+    // Bins [c0, c1) of a level row
+    void ReadRow(const Level &l, qint64 row, int c0, int c1, float *dst) const;
+    // Fill a region resolved against what is recorded
+    bool Resolve(SpectrogramRegion &region) const;
+
+    mutable std::mutex storeMutex;
+
+    QString path;
+    qint64 maxBytes;
+    bool open;
+    bool full;
+    QString error;
+    // Counts Release(), a read in progress gives up when it changes
+    int generation;
+
+    QFile file;
+    uchar *map;
+    SpectrogramFileHeader header;
+    Amplitude refLevel;
+    double div;
+    qint64 *times;
+    std::vector<Level> levels;
+    // Scratch for one row of each frequency level, and two rows for
+    //   the time levels
+    std::vector<std::vector<float>> rowBufs;
+    std::vector<float> pairA, pairB;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SpectrogramStore)
+};
+
+#endif // SPECTROGRAM_STORE_H
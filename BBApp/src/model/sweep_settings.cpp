@@ -403,6 +403,14 @@ void SweepSettings::setSpan(Frequency f)
     UpdateProgram();
 }
 
+void SweepSettings::SetSegmentRange(Frequency segStart, Frequency segStop)
+{
+    start = segStart;
+    stop = segStop;
+    span = stop - start;
+    center = start + (span / 2.0);
+}
+
 void SweepSettings::increaseSpan(bool inc)
 {
     double new_span = bb_lib::sequence_span(span, inc);
@@ -78,6 +78,10 @@ public:
     // Returns true if settings fine for CP/OCBW
     bool IsAveragePower() const;
 
+    // Narrow the frequency range without adjusting any bandwidths
+    // Used to split one sweep across several devices, does not emit
+    void SetSegmentRange(Frequency segStart, Frequency segStop);
+
     Amplitude refLevel;
 
     int tgSweepSize;
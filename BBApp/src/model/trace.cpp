@@ -1,5 +1,6 @@
 #include "trace.h"
 #include "lib/bb_lib.h"
+#include "lib/simd_kernels.h"
 
 #include <QSettings>
 #include <QFile>
@@ -14,6 +15,13 @@ Trace::Trace(bool active, int size)
     _update = true;
     _type = OFF;
     _averageCount = 10;
+    _avgMode = AverageLog;
+    _powValid = false;
+    _avgRestart = false;
+    _percentile = 90.0;
+    _statValid = false;
+    _mathDirty = true;
+    _peaksValid = false;
 
     _size = 0;
     _minBuf = nullptr;
@@ -21,6 +29,8 @@ Trace::Trace(bool active, int size)
 
     _binSize = 0.0;
     _start = 0.0;
+    _updateStart = 0;
+    _updateStop = 0;
 
     msFromEpoch = 0;
 
@@ -45,12 +55,36 @@ void Trace::Copy(const Trace &other)
 
     Alloc(other._size);
 
-    for(int i = 0; i < _size; i++) {
-        _minBuf[i] = other._minBuf[i];
-        _maxBuf[i] = other._maxBuf[i];
+    simdCopy_32f(other._minBuf, _minBuf, _size);
+    simdCopy_32f(other._maxBuf, _maxBuf, _size);
+
+    _peaksValid = other._peaksValid;
+    if(_peaksValid) {
+        _peaks.CopyFrom(other._peaks);
     }
 }
 
+void Trace::CopyForDisplay(const Trace &other)
+{
+    settings = other.settings;
+    color = other.color;
+    _active = other._active;
+    _update = other._update;
+    _type = other._type;
+    _averageCount = other._averageCount;
+    _avgMode = other._avgMode;
+    _percentile = other._percentile;
+    _math.SetExpression(other._math.Expression());
+    _updateStart = other._updateStart;
+    _updateStop = other._updateStop;
+    msFromEpoch = other.msFromEpoch;
+
+    // Nothing reads the buffers of an inactive trace
+    if(!_active) return;
+
+    Copy(other);
+}
+
 // Destroy buffers and set to null
 void Trace::Destroy()
 {
@@ -71,6 +105,10 @@ void Trace::Alloc(int newSize)
 
     // Sizes different, delete and re-alloc
     Destroy();
+    _powValid = false;
+    _statValid = false;
+    _mathDirty = true;
+    _peaksValid = false;
 
     _size = newSize;
     _minBuf = new float[_size];
@@ -86,6 +124,10 @@ void Trace::Alloc(int newSize)
 //   to zero, which triggers a copy
 void Trace::Clear() {
     _size = 0;
+    _powValid = false;
+    _statValid = false;
+    _mathDirty = true;
+    _peaksValid = false;
 }
 
 void Trace::SetType(TraceType type)
@@ -111,6 +153,33 @@ void Trace::SetAvgCount(int count)
     Clear();
 }
 
+void Trace::SetAvgMode(AverageMode mode)
+{
+    if(_avgMode == mode) {
+        return;
+    }
+
+    _avgMode = mode;
+    Clear();
+}
+
+void Trace::SetMath(const TraceMathExpr &expr)
+{
+    _math.SetExpression(expr);
+    _mathDirty = true;
+}
+
+void Trace::SetPercentile(double percentile)
+{
+    bb_lib::clamp(percentile, 50.0, 99.9);
+    if(_percentile == percentile) {
+        return;
+    }
+
+    _percentile = percentile;
+    Clear();
+}
+
 // Returns negative frequency if not active to prevent
 //  marker from updating on non-active trace
 void Trace::GetSignalPeak(double *freq, double *amp) const
@@ -128,29 +197,32 @@ void Trace::GetSignalPeak(double *freq, double *amp) const
         return;
     }
 
-    double max = -1000.0;
-    int maxIndex = 0;
+    int maxIndex = GetPeakIndexInRange(0, _size);
 
-    // Find max amp and index
-    for(int i = 0; i < _size; i++) {
-        if(_maxBuf[i] > max) {
-            max = _maxBuf[i];
-            maxIndex = i;
-        }
-    }
-
-    if(amp) *amp = max;
+    if(amp) *amp = _maxBuf[maxIndex];
     if(freq) *freq = _start + maxIndex * _binSize;
 }
 
 int Trace::GetPeakIndex() const
 {
-    double max = -1000.0;
-    int maxIndex = 0;
+    return bb_lib::max2(GetPeakIndexInRange(0, _size), 0);
+}
 
-    for(int i = 0; i < _size; i++) {
-        if(_maxBuf[i] > max) {
-            max = _maxBuf[i];
+int Trace::GetPeakIndexInRange(int start, int stop) const
+{
+    start = bb_lib::max2(start, 0);
+    stop = bb_lib::min2(stop, _size);
+    if(start >= stop) {
+        return -1;
+    }
+
+    if(_peaksValid) {
+        return _peaks.ArgMax(_maxBuf, start, stop);
+    }
+
+    int maxIndex = start;
+    for(int i = start + 1; i < stop; i++) {
+        if(_maxBuf[i] > _maxBuf[maxIndex]) {
             maxIndex = i;
         }
     }
@@ -161,6 +233,10 @@ int Trace::GetPeakIndex() const
 // Mean
 double Trace::GetMean() const
 {
+    if(_peaksValid) {
+        return _peaks.Sum() / _size;
+    }
+
     double sum = 0.0;
 
     for(int i = 0; i < _size; i++)
@@ -185,6 +261,12 @@ double Trace::GetVariance() const
 
 double Trace::GetVarianceFromMean(const double mean) const
 {
+    if(_peaksValid) {
+        // E[x^2] - mean^2, with the sums held in double
+        double variance = _peaks.SumOfSquares() / _size - mean * mean;
+        return bb_lib::max2(variance, 0.0);
+    }
+
     double variance = 0.0;
 
     for(int i = 0; i < _size; i++) {
@@ -201,42 +283,91 @@ double Trace::GetStandardDeviation() const
     return sqrt(GetVariance());
 }
 
-// Return a list of indices representing the acceptable peaks
-// Clear the list before beginning
-void Trace::GetPeakList(std::vector<int> &peak_index_list) const
+const PeakIndex& Trace::GetPeakSearchIndex(PeakIndex &scratch) const
 {
-    peak_index_list.clear();
-    double mean = GetMean();
-    double stddev = sqrt(GetVarianceFromMean(mean));
+    if(_peaksValid) {
+        return _peaks;
+    }
 
-    // Find the "beginning" of a peak
-    for(int loc = 0; loc < _size - 2; loc++) {
-        // Next point must be above the entry
-        if((_maxBuf[loc] > (mean + stddev * 1.2))
-            && (_maxBuf[loc+1] > _maxBuf[loc])) {
+    scratch.Reset(_size);
+    scratch.Refresh(_maxBuf, 0, _size);
+    return scratch;
+}
 
-            double peakVal = _maxBuf[loc];
-            unsigned int ix_peak = loc;
+// Run of bins above the mean containing ix
+void Trace::GetPeakRun(const PeakIndex &peaks, int ix, double mean, int *start, int *stop) const
+{
+    *start = peaks.LastAtOrBelow(_maxBuf, 0, ix, mean) + 1;
+    *stop = peaks.FirstAtOrBelow(_maxBuf, ix, _size, mean);
+    if(*stop < 0) *stop = _size;
+}
 
-            // Find range
-            while((_maxBuf[loc] > (mean)) && loc < _size) {
-                loc++;
+int Trace::GetNextPeakLeft(int ix) const
+{
+    if(_size < 3) return -1;
 
-                if(_maxBuf[loc] > peakVal) {
-                    peakVal = _maxBuf[loc];
-                    ix_peak = loc;
-                }
-            }
+    PeakIndex scratch;
+    const PeakIndex &peaks = GetPeakSearchIndex(scratch);
+    double mean = GetMean();
+    double threshold = mean + sqrt(GetVarianceFromMean(mean)) * 1.2;
+
+    // Walk left one run at a time, the run holding ix may peak right of it
+    int pos = bb_lib::min2(ix, _size);
+    while(pos > 0) {
+        int above = peaks.LastAbove(_maxBuf, 0, pos, threshold);
+        if(above < 0) {
+            return -1;
+        }
+        int runStart, runStop;
+        GetPeakRun(peaks, above, mean, &runStart, &runStop);
+        int peak = peaks.ArgMax(_maxBuf, runStart, runStop);
+        if(peak < ix) {
+            return peak;
+        }
+        pos = runStart;
+    }
+
+    return -1;
+}
 
-            peak_index_list.push_back(ix_peak);
+int Trace::GetNextPeakRight(int ix) const
+{
+    if(_size < 3) return -1;
+
+    PeakIndex scratch;
+    const PeakIndex &peaks = GetPeakSearchIndex(scratch);
+    double mean = GetMean();
+    double threshold = mean + sqrt(GetVarianceFromMean(mean)) * 1.2;
+
+    int pos = bb_lib::max2(ix + 1, 0);
+    while(pos < _size) {
+        int above = peaks.FirstAbove(_maxBuf, pos, _size, threshold);
+        if(above < 0) {
+            return -1;
+        }
+        int runStart, runStop;
+        GetPeakRun(peaks, above, mean, &runStart, &runStop);
+        int peak = peaks.ArgMax(_maxBuf, runStart, runStop);
+        if(peak > ix) {
+            return peak;
         }
+        pos = runStop;
     }
+
+    return -1;
 }
 
 void Trace::Update(const Trace &other)
+{
+    if(BeginUpdate(other)) {
+        UpdateRange(other, _updateStart, _updateStop);
+    }
+}
+
+bool Trace::BeginUpdate(const Trace &other)
 {
     if(!_update) {
-        return;
+        return false;
     }
 
     // Check if equal? if not, set equal
@@ -254,51 +385,177 @@ void Trace::Update(const Trace &other)
 
     if(_type == OFF) {
         _active = false;
-        return;
+        return false;
     } else {
         _active = true;
     }
 
+    if(!_peaksValid) {
+        _peaks.Reset(_size);
+        _peaks.Refresh(_maxBuf, 0, _size);
+        _peaksValid = true;
+    }
+
+    if(_type == AVERAGE) {
+        _avgRestart = (_maxBuf[_updateStart] < -199.0);
+
+        if(_avgMode == AveragePower && (!_powValid || (int)_minPow.size() != _size)) {
+            // First sweep of the average is already in the display buffers
+            bool logScale = settings.RefLevel().IsLogScale();
+            _minPow.resize(_size);
+            _maxPow.resize(_size);
+            TraceToPower_32f(_minBuf, &_minPow[0], _size, logScale);
+            TraceToPower_32f(_maxBuf, &_maxPow[0], _size, logScale);
+            _powValid = true;
+            _avgRestart = true;
+        }
+    }
+
+    if((_type == MEAN_STD_DEV || _type == PERCENTILE) &&
+            (!_statValid || (int)_statCount.size() != _size)) {
+        // Statistics start over with the next samples
+        _statCount.assign(_size, 0);
+        if(_type == MEAN_STD_DEV) {
+            _statMean.assign(_size, 0.0);
+            _statM2.assign(_size, 0.0);
+        } else {
+            _p2Median.assign(_size * 8, 0.0f);
+            _p2Upper.assign(_size * 8, 0.0f);
+        }
+        _statValid = true;
+    }
+
+    return true;
+}
+
+void Trace::UpdateRange(const Trace &other, int start, int stop)
+{
+    Q_ASSERT(start >= _updateStart && stop <= _updateStop);
+    int len = stop - start;
+
     switch(_type) {
     case NORMAL:
-        for(int i = _updateStart; i < _updateStop; i++) {
-            _minBuf[i] = other._minBuf[i];
-            _maxBuf[i] = other._maxBuf[i];
-        }
+        simdCopy_32f(other._minBuf + start, _minBuf + start, len);
+        simdCopy_32f(other._maxBuf + start, _maxBuf + start, len);
         break;
     case MAX_HOLD:
-        for(int i = _updateStart; i < _updateStop; i++) {
-            _maxBuf[i] = _minBuf[i] = bb_lib::max2(_maxBuf[i], other._maxBuf[i]);
-        }
+        simdMax_32f(_maxBuf + start, other._maxBuf + start, _maxBuf + start, len);
+        simdCopy_32f(_maxBuf + start, _minBuf + start, len);
         break;
     case MIN_HOLD:
-        for(int i = _updateStart; i < _updateStop; i++) {
-            _maxBuf[i] = _minBuf[i] = bb_lib::min2(_minBuf[i], other._minBuf[i]);
-        }
+        simdMin_32f(_minBuf + start, other._minBuf + start, _minBuf + start, len);
+        simdCopy_32f(_minBuf + start, _maxBuf + start, len);
         break;
     case MIN_AND_MAX:
-        for(int i = _updateStart; i < _updateStop; i++) {
-            _minBuf[i] = bb_lib::min2(_minBuf[i], other._minBuf[i]);
-            _maxBuf[i] = bb_lib::max2(_maxBuf[i], other._maxBuf[i]);
-        }
+        simdMin_32f(_minBuf + start, other._minBuf + start, _minBuf + start, len);
+        simdMax_32f(_maxBuf + start, other._maxBuf + start, _maxBuf + start, len);
         break;
-    case AVERAGE:
-        //std::cout << _maxBuf[_updateStart] << "\n";
+    case AVERAGE: {
         float add = 1.0 / _averageCount;
-        float remove = 1.0 - add;
-        if(_maxBuf[_updateStart] < -199.0) {
-            for(int i = _updateStart; i < _updateStop; i++) {
-                _minBuf[i] = other._minBuf[i];
-                _maxBuf[i] = other._maxBuf[i];
-            }
+        if(_avgMode == AveragePower) {
+            UpdatePowerAverage(other, add, start, stop);
+        } else if(_avgRestart) {
+            simdCopy_32f(other._minBuf + start, _minBuf + start, len);
+            simdCopy_32f(other._maxBuf + start, _maxBuf + start, len);
         } else {
-            for(int i = _updateStart; i < _updateStop; i++) {
-                _minBuf[i] = _minBuf[i]*remove + other._minBuf[i]*add;
-                _maxBuf[i] = _maxBuf[i]*remove + other._maxBuf[i]*add;
-            }
+            simdBlend_32f(other._minBuf + start, _minBuf + start, add, len);
+            simdBlend_32f(other._maxBuf + start, _maxBuf + start, add, len);
         }
         break;
     }
+    case MEAN_STD_DEV:
+    case PERCENTILE:
+        UpdateStatistics(other, start, stop);
+        break;
+    default:
+        break;
+    }
+
+    if(_peaksValid) {
+        _peaks.Refresh(_maxBuf, start, stop);
+    }
+}
+
+// The running average is kept in power units across sweeps, only the
+//   new sweep is converted in and the result converted back out
+void Trace::UpdatePowerAverage(const Trace &other, float weight, int start, int stop)
+{
+    bool logScale = settings.RefLevel().IsLogScale();
+    int len = stop - start;
+
+    if(_avgRestart) {
+        TraceToPower_32f(other._minBuf + start, &_minPow[start], len, logScale);
+        TraceToPower_32f(other._maxBuf + start, &_maxPow[start], len, logScale);
+    } else {
+        if((int)_powScratch.size() < len) {
+            _powScratch.resize(len);
+        }
+        TraceToPower_32f(other._minBuf + start, &_powScratch[0], len, logScale);
+        simdBlend_32f(&_powScratch[0], &_minPow[start], weight, len);
+        TraceToPower_32f(other._maxBuf + start, &_powScratch[0], len, logScale);
+        simdBlend_32f(&_powScratch[0], &_maxPow[start], weight, len);
+    }
+
+    PowerToTrace_32f(&_minPow[start], _minBuf + start, len, logScale);
+    PowerToTrace_32f(&_maxPow[start], _maxBuf + start, len, logScale);
+}
+
+void Trace::UpdateMath(const Trace *a, const Trace *b)
+{
+    if(_math.Expression().op == MathOffset) {
+        b = a;
+    }
+    if(!a || !b || !a->Active() || !b->Active() ||
+            a->Length() != _size || b->Length() != _size) {
+        _mathDirty = true;
+        return;
+    }
+
+    int start = _mathDirty ? 0 : _updateStart;
+    int stop = _mathDirty ? _size : _updateStop;
+    bool logScale = settings.RefLevel().IsLogScale();
+
+    _math.Evaluate(a->_minBuf + start, b->_minBuf + start, _minBuf + start,
+                   stop - start, logScale);
+    _math.Evaluate(a->_maxBuf + start, b->_maxBuf + start, _maxBuf + start,
+                   stop - start, logScale);
+    _mathDirty = false;
+
+    if(_peaksValid) {
+        _peaks.Refresh(_maxBuf, start, stop);
+    }
+}
+
+// Every bin of the range takes the sweep max as one more sample
+void Trace::UpdateStatistics(const Trace &other, int start, int stop)
+{
+    // Counts converted for the kernels, small enough to stay in L1
+    const int CHUNK = 256;
+    float count[CHUNK];
+
+    while(start < stop) {
+        int len = bb_lib::min2(CHUNK, stop - start);
+        const float *src = other._maxBuf + start;
+
+        for(int i = 0; i < len; i++) {
+            count[i] = (float)_statCount[start + i];
+        }
+
+        if(_type == MEAN_STD_DEV) {
+            simdWelford_32f(src, count, &_statMean[start], &_statM2[start],
+                            _minBuf + start, _maxBuf + start, len);
+        } else {
+            simdP2Quantile_32f(src, count, 0.5f, &_p2Median[start], _size,
+                               _minBuf + start, len);
+            simdP2Quantile_32f(src, count, _percentile / 100.0, &_p2Upper[start], _size,
+                               _maxBuf + start, len);
+        }
+
+        for(int i = 0; i < len; i++) {
+            _statCount[start + i]++;
+        }
+        start += len;
+    }
 }
 
 // Returns true if successful(path exists)
@@ -325,49 +582,16 @@ bool Trace::Export(const QString &path) const
     return true;
 }
 
-bool Trace::GetChannelPower(double ch_start, double ch_stop, double *power) const
-{
-    if(ch_start < StartFreq() || ch_stop > StopFreq()) {
-        *power = 0.0;
-        return false;
-    }
-
-    pfn_convert to_lin, to_log;
-    if(GetSettings()->RefLevel().IsLogScale()) {
-        to_lin = DBMtoMW;
-        to_log = MWtoDBM;
-    } else {
-        to_lin = MVtoMV2;
-        to_log = MV2toMV;
-    }
-
-    int index = (int)((ch_start - StartFreq()) / BinSize()) + 1;
-    bb_lib::clamp<int>(index, 0, Length());
-
-    double step_freq = StartFreq() + BinSize() * index;
-    double sum = 0.0;
-
-    while(step_freq < ch_stop && index < Length()) {
-        sum += to_lin(Max()[index]);
-        step_freq += BinSize();
-        index++;
-    }
-
-    sum /= GetSettings()->GetWindowBandwidth();
-    *power = to_log(sum);
-
-    return true;
-}
-
 void Trace::ApplyOffset(double dB) {
+    _peaksValid = false;
     if(settings.RefLevel().IsLogScale()) {
-        for(int i = 0; i < _size; i++) {
+        for(int i = _updateStart; i < _updateStop; i++) {
             _minBuf[i] += dB;
             _maxBuf[i] += dB;
         }
     } else {
         double scalar = pow(10, dB / 20.0);
-        for(int i = 0; i < _size; i++) {
+        for(int i = _updateStart; i < _updateStop; i++) {
             _minBuf[i] *= scalar;
             _maxBuf[i] *= scalar;
         }
@@ -381,132 +605,3 @@ void Trace::SetUpdateRange(int start, int stop)
     Q_ASSERT(_updateStart >= 0 && _updateStart <= _size);
     Q_ASSERT(_updateStop > _updateStart && _updateStop <= _size);
 }
-
-void Trace::GetOccupiedBandwidth(OccupiedBandwidthInfo &info) const
-{
-    Q_ASSERT(info.percentPower >= MIN_OCBW_PERCENT_POWER &&
-             info.percentPower <= MAX_OCBW_PERCENT_POWER);
-
-    // Sum up total channel power
-    double power = 0.0;
-    pfn_convert to_lin, to_log;
-    if(GetSettings()->RefLevel().IsLogScale()) {
-        to_lin = DBMtoMW;
-        to_log = MWtoDBM;
-    } else {
-        to_lin = MVtoMV2;
-        to_log = MV2toMV;
-    }
-
-    info.traceLen = Length();
-
-    for(int i = 0; i < Length(); i++) {
-        power += to_lin(Max()[i]);
-    }
-
-    double halfMissing = ((100.0 - info.percentPower) / 2.0) / 100.0;
-    halfMissing *= power;
-
-    // Move in on each end until 1/2 the missing power is subtracted
-    info.lix = 0;
-    info.rix = Length() - 1;
-
-    double leftSum = 0.0, rightSum = 0.0;
-    while(leftSum < halfMissing && info.lix < info.rix) {
-        leftSum += to_lin(Max()[info.lix++]);
-    }
-
-    while(rightSum < halfMissing && info.rix > info.lix) {
-        rightSum += to_lin(Max()[info.rix--]);
-    }
-
-    Frequency leftFreq = StartFreq() + BinSize() * info.lix;
-
-    info.leftMarker.Place(StartFreq() + BinSize() * info.lix);
-    //info.leftMarker.Place(info.lix);
-    info.leftMarker.UpdateMarker(this, this->GetSettings());
-
-    info.rightMarker.Place(StartFreq() + BinSize() * info.rix);
-    //info.rightMarker.Place(info.rix);
-    info.rightMarker.UpdateMarker(this, this->GetSettings());
-
-    info.bandwidth = info.rightMarker.Freq() - info.leftMarker.Freq();
-    power -= (leftSum + rightSum);
-    power = to_log(power / GetSettings()->GetWindowBandwidth());
-    AmpUnits powerUnits = GetSettings()->RefLevel().Units();
-    if(powerUnits == MV) {
-        info.totalPower = Amplitude(power, GetSettings()->RefLevel().Units());
-    } else {
-        info.totalPower = Amplitude(power).ConvertToUnits(powerUnits);
-    }
-}
-
-ChannelPower::ChannelPower() :
-    enabled(false)
-{
-
-}
-
-ChannelPower::~ChannelPower()
-{
-
-}
-
-void ChannelPower::Configure(bool ch_enable, double ch_width, double ch_spacing)
-{
-    enabled = ch_enable;
-    width = ch_width;
-    spacing = ch_spacing;
-    in_view[0] = in_view[1] = in_view[2] = false;
-    ch_power[0] = ch_power[1] = ch_power[2] = 0.0;
-}
-
-void ChannelPower::Update(const Trace *trace)
-{
-    if(!enabled) return;
-
-    double center = trace->GetSettings()->Center();
-
-    ch_start[0] = center - spacing - (width / 2.0);
-    ch_stop[0] = ch_start[0] + width;
-    ch_start[1] = center - (width / 2.0);
-    ch_stop[1] = center + (width / 2.0);
-    ch_start[2] = center + spacing - (width / 2.0);
-    ch_stop[2] = ch_start[2] + width;
-
-    for(int i = 0; i < 3; i++) {
-        in_view[i] = trace->GetChannelPower(ch_start[i], ch_stop[i], &ch_power[i]);
-    }
-}
-
-bool ChannelPower::IsChannelInView(int channel) const
-{
-    if(channel < 0 || channel > 2)
-        return false;
-
-    return in_view[channel];
-}
-
-double ChannelPower::GetChannelStart(int channel) const
-{
-    if(channel < 0 || channel > 2)
-        return 0.0;
-
-    return ch_start[channel];
-}
-
-double ChannelPower::GetChannelStop(int channel) const
-{
-    if(channel < 0 || channel > 2)
-        return 0.0;
-
-    return ch_stop[channel];
-}
-
-double ChannelPower::GetChannelPower(int channel) const
-{
-    if(channel < 0 || channel > 2)
-        return 0.0;
-
-    return ch_power[channel];
-}
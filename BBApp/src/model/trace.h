@@ -3,7 +3,9 @@
 
 #include "sweep_settings.h"
 #include "marker.h"
+#include "trace_math.h"
 #include "lib/macros.h"
+#include "lib/peak_index.h"
 
 #include <QColor>
 #include <QSize>
@@ -14,7 +16,19 @@ enum TraceType {
     MAX_HOLD    = 2,
     MIN_HOLD    = 3,
     MIN_AND_MAX = 4,
-    AVERAGE  = 5
+    AVERAGE  = 5,
+    // Per-bin statistics of the sweep max across every sweep since
+    //   the trace was cleared, in displayed units
+    MEAN_STD_DEV = 6, // Max/Min = mean +/- one standard deviation
+    PERCENTILE = 7, // Max = percentile, Min = median
+    MATH = 8 // Derived from two other traces, see TraceMath
+};
+
+// Domain the AVERAGE trace type averages in
+// Must match the combo-box indices
+enum AverageMode {
+    AverageLog   = 0, // Average of the displayed dB (or mV) values
+    AveragePower = 1  // RMS, average of mW (or mV^2)
 };
 
 // N/A for now
@@ -70,6 +84,9 @@ public:
 
     // Use instead of the operator= overload, more descriptive
     void Copy(const Trace &other);
+    // Copy() plus the type, color, settings and everything else a
+    //   view or marker reads, buffers are skipped for inactive traces
+    void CopyForDisplay(const Trace &other);
 
     void Destroy(void);
     void Clear(void); // Sweep size = 0
@@ -93,6 +110,16 @@ public:
     TraceType GetType() const { return _type; }
     void SetAvgCount(int count);
     int GetAvgCount() const { return _averageCount; }
+    void SetAvgMode(AverageMode mode);
+    AverageMode GetAvgMode() const { return _avgMode; }
+    // Upper percentile of the PERCENTILE type, [50,99.9]
+    void SetPercentile(double percentile);
+    double GetPercentile() const { return _percentile; }
+    // Expression of the MATH type, recomputed in full on the next update
+    void SetMath(const TraceMathExpr &expr);
+    const TraceMathExpr& GetMath() const { return _math.Expression(); }
+    // Operands changed, the next UpdateMath() recomputes every bin
+    void SetMathDirty() { _mathDirty = true; }
 
     int Length(void) const { return _size; }
 
@@ -103,11 +130,20 @@ public:
     double BinSize() const { return _binSize; }
     void GetSignalPeak(double *freq, double *amp) const;
     int GetPeakIndex() const;
+    // Index of the max in [start,stop), -1 if the range is empty
+    int GetPeakIndexInRange(int start, int stop) const;
     double GetMean() const;
     double GetVariance() const;
     double GetVarianceFromMean(const double mean) const;
     double GetStandardDeviation() const;
-    void GetPeakList(std::vector<int> &peak_index_list) const;
+    // Nearest peak strictly left/right of index ix, -1 if none
+    // A peak is the max of a run of bins above the mean that
+    //   reaches 1.2 standard deviations above the mean
+    int GetNextPeakLeft(int ix) const;
+    int GetNextPeakRight(int ix) const;
+    // Index over the max buffer, kept for traces filled through
+    //   Update()/UpdateRange(), built into scratch otherwise
+    const PeakIndex& GetPeakSearchIndex(PeakIndex &scratch) const;
     float* Min() const { return _minBuf; }
     float* Max() const { return _maxBuf; }
     qint64 Time() const { return msFromEpoch; }
@@ -115,23 +151,32 @@ public:
     int UpdateStop() const { return _updateStop; }
 
     void Update(const Trace &other);
+    // Update() in two steps, so many traces can be updated block by
+    //   block while each block of other is still in cache
+    // Returns false if this trace does not take the update
+    bool BeginUpdate(const Trace &other);
+    // Update bins [start,stop) within the update range of other
+    void UpdateRange(const Trace &other, int start, int stop);
+    // Update a MATH trace from its operands after BeginUpdate(), over the
+    //   update range, or all of it when dirty
+    // A null or mismatched operand leaves the trace as is until it is valid
+    void UpdateMath(const Trace *a, const Trace *b);
     // Export to path, with a given bin size spacing
     // Spacing accomplished via lerping
     bool Export(const QString &path) const;
-    // Get the power of the band from [start,stop]
-    // Sum up power units, div by
-    bool GetChannelPower(double ch_start, double ch_stop, double *power) const;
-    // Apply a flat offset, either in linear or logarithmic scale
+    // Apply a flat offset, either in linear or logarithmic scale, over
+    //   the update range
     void ApplyOffset(double dB);
     void SetUpdateRange(int start, int stop);
     // Returns true if the last data retrieved finished the sweep
     // Only relevant on SA fast sweep
     bool IsFullSweep() const { return _updateStop == _size; }
 
-    void GetOccupiedBandwidth(OccupiedBandwidthInfo &info) const;
-
 private:
     void Alloc(int newSize);  // Allocate both buffers length n
+    void UpdatePowerAverage(const Trace &other, float weight, int start, int stop);
+    void UpdateStatistics(const Trace &other, int start, int stop);
+    void GetPeakRun(const PeakIndex &peaks, int ix, double mean, int *start, int *stop) const;
 
     SweepSettings settings;
 
@@ -140,6 +185,7 @@ private:
     bool _update;
     TraceType _type;
     int _averageCount;
+    AverageMode _avgMode;
 
     int _size;
 
@@ -151,33 +197,36 @@ private:
     int _updateStart;
     int _updateStop;
 
+    // Running power average, only allocated for AveragePower
+    std::vector<float> _minPow, _maxPow, _powScratch;
+    bool _powValid;
+    bool _avgRestart; // Set by BeginUpdate(), next average starts over
+
+    // Streaming statistics, only allocated for the statistics types
+    // Welford mean/m2 for MEAN_STD_DEV, P-square markers for the median
+    //   and upper percentile for PERCENTILE, 8 rows of _size each
+    double _percentile;
+    // Samples per bin, integer so the count keeps going past 2^24, the
+    //   kernels take it converted to float a chunk at a time
+    std::vector<quint32> _statCount;
+    std::vector<double> _statMean, _statM2;
+    std::vector<float> _p2Median, _p2Upper;
+    bool _statValid;
+
+    TraceMath _math;
+    bool _mathDirty;
+
+    // Kept up to date over each update range, writes through Min()/Max()
+    //   do not touch it, so it is only trusted while _peaksValid
+    // Copy() duplicates it, a few values per 64 bins, so a snapshot
+    //   searches without a rescan and without sharing the live index
+    PeakIndex _peaks;
+    bool _peaksValid;
+
     qint64 msFromEpoch;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(Trace)
 };
 
-class ChannelPower {
-public:
-    ChannelPower();
-    ~ChannelPower();
-
-    void Configure(bool ch_enable, double ch_width, double ch_spacing);
-    void Update(const Trace *trace);
-
-    bool IsEnabled() const { return enabled; }
-
-    bool IsChannelInView(int channel) const;
-    double GetChannelStart(int channel) const;
-    double GetChannelStop(int channel) const;
-    double GetChannelPower(int channel) const;
-
-private:
-    bool enabled;
-    double width;
-    double spacing;
-    bool in_view[3];
-    double ch_start[3], ch_stop[3], ch_power[3];
-};
-
 #endif // TRACE_H
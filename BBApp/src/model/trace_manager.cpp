@@ -1,11 +1,26 @@
 #include "trace_manager.h"
 #include "sweep_settings.h"
+#include "preferences.h"
 #include "../widgets/entry_widgets.h"
 
 #include <cassert>
 
 #include <QSettings>
 #include <QFileDialog>
+#include <QMessageBox>
+
+// Bins per block of the fused update, the min and max of one block
+//   of the incoming sweep stay in the L1 cache while every trace is
+//   updated from it
+static const int UPDATE_BLOCK_BINS = 2048;
+
+// Sweeps queued for the persistence and waterfall, the view drains
+//   them every paint
+static const int TRACE_BUFFER_SWEEPS = 32;
+
+// Partial sweeps are published at most this often, each publish copies
+//   every active trace, and the view redraws no faster than this
+static const int PARTIAL_PUBLISH_MS = 16;
 
 static QColor default_trace_colors[TRACE_COUNT] = {
     QColor(0, 0, 0),
@@ -16,8 +31,19 @@ static QColor default_trace_colors[TRACE_COUNT] = {
     QColor(150, 150, 150)
 };
 
-TraceManager::TraceManager()
+TraceManager::TraceManager() :
+    trace_buffer(TRACE_BUFFER_SWEEPS),
+    occupancyTrace(true)
 {
+    trace_buffer.SetOverflowPolicy(SPSCDropOldest);
+
+    QSettings s(QSettings::IniFormat, QSettings::UserScope,
+                "SignalHound", "Preferences");
+    traceCount = s.value("TraceCount", TRACE_COUNT).toInt();
+    bb_lib::clamp(traceCount, 1, MAX_TRACE_COUNT);
+    traces = new Trace[traceCount];
+    updating.reserve(traceCount);
+
     LoadColors();
 
     activeTrace = 0;
@@ -31,11 +57,32 @@ TraceManager::TraceManager()
     ref_offset = 0.0;
 
     lastTraceAboveReference = false;
+    inputPeaksOffset = 0.0;
+
+    occupancyTrace.SetColor(QColor(255, 140, 0));
+
+    // Views always have a snapshot to read
+    lastPublish.start();
+    PublishSnapshot();
+    RefreshSnapshot();
 }
 
 TraceManager::~TraceManager()
 {
     SaveColors();
+    delete [] traces;
+}
+
+QString TraceManager::TraceName(int index)
+{
+    static const char *names[TRACE_COUNT] = {
+        "One", "Two", "Three", "Four", "Five", "Six"
+    };
+
+    if(index >= 0 && index < TRACE_COUNT) {
+        return names[index];
+    }
+    return QString::number(index + 1);
 }
 
 void TraceManager::LoadColors()
@@ -43,9 +90,12 @@ void TraceManager::LoadColors()
     QSettings s(QSettings::IniFormat, QSettings::UserScope,
                 "SignalHound", "Preferences");
 
-    for(int i = 0; i < TRACE_COUNT; i++) {
+    for(int i = 0; i < traceCount; i++) {
+        // Traces past the defaults get spread around the hue circle
+        QColor defaultColor = (i < TRACE_COUNT) ? default_trace_colors[i] :
+                                                  QColor::fromHsv((i * 67) % 360, 255, 200);
         traces[i].SetColor(s.value("TraceColor/Trace" + QVariant(i).toString(),
-                                   default_trace_colors[i]).value<QColor>());
+                                   defaultColor).value<QColor>());
     }
 }
 
@@ -54,7 +104,7 @@ void TraceManager::SaveColors()
     QSettings s(QSettings::IniFormat, QSettings::UserScope,
                 "SignalHound", "Preferences");
 
-    for(int i = 0; i < TRACE_COUNT; i++) {
+    for(int i = 0; i < traceCount; i++) {
         s.setValue("TraceColor/Trace" + QVariant(i).toString(), traces[i].Color());
     }
 }
@@ -63,10 +113,12 @@ void TraceManager::ClearAllTraces()
 {
     Lock();
 
-    for(int i = 0; i < TRACE_COUNT; i++) {
+    for(int i = 0; i < traceCount; i++) {
         traces[i].SetSize(0);
     }
+    inputPeaks.Reset(0);
 
+    PublishSnapshot();
     Unlock();
 }
 
@@ -75,7 +127,7 @@ void TraceManager::Reset()
     Lock();
 
     activeTrace = 0;
-    for(int i = 0; i < TRACE_COUNT; i++) {
+    for(int i = 0; i < traceCount; i++) {
         //traces[i].Activate(i == 0);
         if(i != 0) traces[i].Disable();
         traces[i].SetUpdate(true);
@@ -94,6 +146,7 @@ void TraceManager::Reset()
     pathLoss.Clear();
     limitLine.Clear();
 
+    PublishSnapshot();
     Unlock();
 
     emit updated();
@@ -111,9 +164,20 @@ void TraceManager::UpdateTraces(Trace *trace)
     pathLoss.Apply(trace);
 
     // Determine if the maximum value is above the reference level
-    double peak_freq, peak_amp;
+    // Only the update range changed since the last sweep, bins outside
+    //   of it keep their place in the index
+    // The whole buffer is current, partial sweeps are merged upstream,
+    //   so start over from all of it when the layout or offset changed
+    if(inputPeaks.Length() != trace->Length() || inputPeaksOffset != ref_offset) {
+        inputPeaks.Reset(trace->Length());
+        inputPeaks.Refresh(trace->Max(), 0, trace->Length());
+        inputPeaksOffset = ref_offset;
+    } else {
+        inputPeaks.Refresh(trace->Max(), trace->UpdateStart(), trace->UpdateStop());
+    }
+    int peak_ix = inputPeaks.ArgMax(trace->Max(), 0, trace->Length());
+    double peak_amp = (peak_ix < 0) ? 0.0 : trace->Max()[peak_ix];
     Amplitude ref = trace->GetSettings()->RefLevel();
-    trace->GetSignalPeak(&peak_freq, &peak_amp);
     if(!ref.IsLogScale()) {
         lastTraceAboveReference = (peak_amp > ref.Val());
     } else {
@@ -124,23 +188,77 @@ void TraceManager::UpdateTraces(Trace *trace)
     // Limit lines should be tested after any amplitude offsets
     limitLine.Apply(trace);
 
-    // Iterate through and update all traces
-    for(int i = 0; i < TRACE_COUNT; i++) {
-        traces[i].Update(*trace);
+    // Fused update, every trace is updated from one block of the sweep
+    //   before moving to the next, so the sweep is read from memory once
+    //   no matter how many traces there are
+    updating.clear();
+    for(int i = 0; i < traceCount; i++) {
+        if(traces[i].GetType() == MATH) continue;
+        if(traces[i].BeginUpdate(*trace)) {
+            updating.push_back(&traces[i]);
+        }
     }
 
-    Unlock();
+    if(!updating.empty()) {
+        int stop = trace->UpdateStop();
+        for(int start = trace->UpdateStart(); start < stop; start += UPDATE_BLOCK_BINS) {
+            int blockStop = bb_lib::min2(start + UPDATE_BLOCK_BINS, stop);
+            for(Trace *t : updating) {
+                t->UpdateRange(*trace, start, blockStop);
+            }
+        }
+    }
+
+    // Derived traces once every operand is current
+    for(int i = 0; i < traceCount; i++) {
+        if(traces[i].GetType() == MATH && traces[i].BeginUpdate(*trace)) {
+            const TraceMathExpr &expr = traces[i].GetMath();
+            traces[i].UpdateMath(GetMathOperand(i, expr.a), GetMathOperand(i, expr.b));
+        }
+    }
 
+    // Search the active trace, or the sweep itself while it is off
     if(trace->IsFullSweep()) {
-        // Place trace in our persist/waterfall buffer
-        normalize_trace(trace, *trace_buffer.Front(), QPoint(1280, 720));
-        trace_buffer.IncrementFront();
+        if(traces[activeTrace].Active()) {
+            peakTable.Update(&traces[activeTrace]);
+        } else {
+            peakTable.Update(trace);
+        }
+    }
+
+    // Counted from the sweep itself, before any trace processing
+    if(occupancy.IsEnabled()) {
+        occupancy.Update(trace);
+        if(trace->IsFullSweep()) {
+            occupancy.GetTrace(&occupancyTrace);
+        }
     }
 
-    channel_power.Update(trace);
+    // One conversion to linear power serves every channel and OCBW
+    if(channel_power.IsEnabled() || ocbw.enabled) {
+        bandPower.Build(trace);
+        channel_power.Update(trace, bandPower);
+        if(ocbw.enabled) {
+            bandPower.GetOccupiedBandwidth(trace, ocbw);
+        }
+    }
+
+    // Full sweeps are always seen, partial ones only show progress
+    if(trace->IsFullSweep() || lastPublish.elapsed() >= PARTIAL_PUBLISH_MS) {
+        PublishSnapshot();
+    }
+    Unlock();
 
-    if(ocbw.enabled) {
-        trace->GetOccupiedBandwidth(ocbw);
+    if(trace->IsFullSweep()) {
+        if(spectrogram.IsOpen() && !spectrogram.Append(trace) && !spectrogram.IsOpen()) {
+            emit spectrogramStopped(spectrogram.ErrorString());
+        }
+        // Place trace in our persist/waterfall buffer
+        GLVector *v = trace_buffer.WriteSlot();
+        if(v) {
+            normalize_trace(trace, *v, QPoint(1280, 720), bufferPlan);
+            trace_buffer.CommitWrite();
+        }
     }
 }
 
@@ -172,19 +290,54 @@ int TraceManager::SolveMarkersForPhaseNoise(const SweepSettings *s)
 //    return GetVisibleMarkerCount();
 //}
 
+void TraceManager::PublishSnapshot()
+{
+    TraceSet &set = snapshots.Back();
+    set.Resize(traceCount);
+    for(int i = 0; i < traceCount; i++) {
+        set.traces[i].CopyForDisplay(traces[i]);
+    }
+    set.peaks = peakTable.Peaks();
+    if(occupancy.IsEnabled()) {
+        set.occupancy.CopyForDisplay(occupancyTrace);
+    } else {
+        set.occupancy.Disable();
+    }
+    snapshots.Publish();
+    lastPublish.restart();
+}
+
+// Operands are other non-math traces
+const Trace* TraceManager::GetMathOperand(int index, int operand) const
+{
+    if(operand < 0 || operand >= traceCount || operand == index ||
+            traces[operand].GetType() == MATH) {
+        return nullptr;
+    }
+
+    return &traces[operand];
+}
+
+void TraceManager::InvalidateMath()
+{
+    for(int i = 0; i < traceCount; i++) {
+        traces[i].SetMathDirty();
+    }
+}
+
 const Trace* TraceManager::GetTrace(int index)
 {
-    assert(index >= 0 && index < TRACE_COUNT);
+    assert(index >= 0 && index < traceCount);
 
-    if(index < 0 || index >= TRACE_COUNT)
+    if(index < 0 || index >= traceCount)
         return 0;
 
-    return &traces[index];
+    return &snapshots.Front().traces[index];
 }
 
 int TraceManager::GetFirstActiveTrace() const
 {
-    for(int t = 0; t < TRACE_COUNT; t++) {
+    for(int t = 0; t < traceCount; t++) {
         if(traces[t].Active()) {
             return t;
         }
@@ -272,9 +425,9 @@ void TraceManager::BumpMarker(bool right)
 
 void TraceManager::setActiveIndex(int index)
 {
-    assert(index >= 0 && index < TRACE_COUNT);
+    assert(index >= 0 && index < traceCount);
 
-    if(index < 0 || index >= TRACE_COUNT)
+    if(index < 0 || index >= traceCount)
         return;
 
     activeTrace = index;
@@ -289,25 +442,69 @@ void TraceManager::setActive(bool active)
 
 void TraceManager::setUpdate(bool update)
 {
+    Lock();
     GetActiveTrace()->SetUpdate(update);
+    InvalidateMath();
+    PublishSnapshot();
+    Unlock();
     emit updated();
 }
 
 void TraceManager::setType(int type)
 {
+    Lock();
     GetActiveTrace()->SetType((TraceType)type);
+    InvalidateMath();
+    PublishSnapshot();
+    Unlock();
     emit updated();
 }
 
 void TraceManager::setAvgCount(double count)
 {
+    Lock();
     GetActiveTrace()->SetAvgCount((int)count);
+    InvalidateMath();
+    PublishSnapshot();
+    Unlock();
+    emit updated();
+}
+
+void TraceManager::setAvgMode(int mode)
+{
+    Lock();
+    GetActiveTrace()->SetAvgMode((AverageMode)mode);
+    InvalidateMath();
+    PublishSnapshot();
+    Unlock();
+    emit updated();
+}
+
+void TraceManager::setPercentile(double percentile)
+{
+    Lock();
+    GetActiveTrace()->SetPercentile(percentile);
+    InvalidateMath();
+    PublishSnapshot();
+    Unlock();
+    emit updated();
+}
+
+void TraceManager::SetTraceMath(const TraceMathExpr &expr)
+{
+    Lock();
+    GetActiveTrace()->SetMath(expr);
+    PublishSnapshot();
+    Unlock();
     emit updated();
 }
 
 void TraceManager::setColor(QColor &color)
 {
+    Lock();
     GetActiveTrace()->SetColor(color);
+    PublishSnapshot();
+    Unlock();
     emit updated();
 }
 
@@ -318,7 +515,11 @@ void TraceManager::toFront()
 
 void TraceManager::clearTrace()
 {
+    Lock();
     GetActiveTrace()->Clear();
+    InvalidateMath();
+    PublishSnapshot();
+    Unlock();
 }
 
 void TraceManager::exportTrace()
@@ -357,7 +558,7 @@ void TraceManager::setActiveMarkerIndex(int index)
 
 void TraceManager::setMarkerOnTrace(int trace)
 {
-    assert(trace >= 0 && trace < TRACE_COUNT);
+    assert(trace >= 0 && trace < traceCount);
 
     if(GetActiveMarker()->OnTrace() == trace) {
         return;
@@ -407,37 +608,19 @@ void TraceManager::markerToRef()
 void TraceManager::markerPeakLeft()
 {
     Marker *marker_ptr = GetActiveMarker();
-    const Trace *trace_ptr = &traces[marker_ptr->OnTrace()];
+    const Trace *trace_ptr = GetTrace(marker_ptr->OnTrace());
 
     if(!marker_ptr->Active()) {
         markerPeakSearch();
         return;
     }
 
-    std::vector<int> peak_list;
-    trace_ptr->GetPeakList(peak_list);
-
-    if(peak_list.size() == 0) {
-        return;
-    }
-
-    int peak_ix = 0;
-    int old_ix = marker_ptr->Index();
-
-    while(peak_ix < peak_list.size()) {
-        if(peak_list[peak_ix] >= old_ix) {
-            break;
-        }
-        peak_ix++;
-    }
+    int peak_ix = trace_ptr->GetNextPeakLeft(marker_ptr->Index());
 
-    if(peak_ix == 0) {
-        // do nothing
-    } else {
+    // Do nothing if at the first peak
+    if(peak_ix >= 0) {
         marker_ptr->Place(trace_ptr->StartFreq() +
-                          trace_ptr->BinSize() * peak_list[peak_ix-1]);
-        //marker_ptr->Place((double)peak_list[peak_ix-1] / trace_ptr->Length());
-        //marker_ptr->Place(peak_list[peak_ix-1]);
+                          trace_ptr->BinSize() * peak_ix);
     }
 
     emit updated();
@@ -446,40 +629,19 @@ void TraceManager::markerPeakLeft()
 void TraceManager::markerPeakRight()
 {
     Marker *marker_ptr = GetActiveMarker();
-    const Trace *trace_ptr = &traces[marker_ptr->OnTrace()];
+    const Trace *trace_ptr = GetTrace(marker_ptr->OnTrace());
 
     if(!marker_ptr->Active()) {
         markerPeakSearch();
         return;
     }
 
-    std::vector<int> peak_list;
-    trace_ptr->GetPeakList(peak_list);
-
-    if(peak_list.size() == 0) {
-        return;
-    }
-
-    int peak_ix = 0;
-    int old_ix = marker_ptr->Index();
+    int peak_ix = trace_ptr->GetNextPeakRight(marker_ptr->Index());
 
-    while(peak_ix < peak_list.size()) {
-        if(peak_list[peak_ix] > old_ix) {
-            break;
-        }
-        peak_ix++;
-    }
-
-    //int final_ix = (peak_ix == 0) ? 0 : peak_ix + 1 ;
-    //if(peak_list[final_ix] == old_ix) final_ix++;
-
-    if(peak_ix >= peak_list.size()) {
-        // Do nothing if at last peak
-    } else {
+    // Do nothing if at the last peak
+    if(peak_ix >= 0) {
         marker_ptr->Place(trace_ptr->StartFreq() +
-                          trace_ptr->BinSize() * peak_list[peak_ix]);
-        //marker_ptr->Place((double)peak_list[peak_ix] / trace_ptr->Length());
-        //marker_ptr->Place(peak_list[peak_ix]);
+                          trace_ptr->BinSize() * peak_ix);
     }
 
     emit updated();
@@ -511,9 +673,133 @@ void TraceManager::setRefOffset(double offset)
     emit updated();
 }
 
-void TraceManager::SetChannelPower(bool enable, Frequency width, Frequency spacing)
+void TraceManager::SetChannelPower(bool enable, Frequency width, Frequency spacing,
+                                   int adjacent)
+{
+    Lock();
+    channel_power.Configure(enable, width, spacing, adjacent);
+    Unlock();
+}
+
+void TraceManager::SetPeakTable(bool enabled, int peaks, double excursion, double threshold)
+{
+    Lock();
+    peakTable.Configure(enabled, peaks, excursion, threshold);
+    PublishSnapshot();
+    Unlock();
+}
+
+void TraceManager::SetOccupancy(bool enabled, OccupancyThreshold mode,
+                                double threshold, double margin)
+{
+    Lock();
+    occupancy.Configure(enabled, mode, threshold, margin);
+    occupancyTrace.SetSize(0);
+    PublishSnapshot();
+    Unlock();
+}
+
+void TraceManager::resetOccupancy()
+{
+    Lock();
+    occupancy.Reset();
+    occupancyTrace.SetSize(0);
+    PublishSnapshot();
+    Unlock();
+}
+
+void TraceManager::exportOccupancy()
+{
+    QString fileName = QFileDialog::getSaveFileName(0,
+                                                    tr("Export File Name"),
+                                                    sh::GetDefaultExportDirectory(),
+                                                    tr("CSV Files (*.csv)"));
+
+    if(fileName.isNull()) return;
+
+    Lock();
+    occupancy.Export(fileName);
+    Unlock();
+
+    sh::SetDefaultExportDirectory(QFileInfo(fileName).absoluteDir().absolutePath());
+}
+
+bool TraceManager::SetSpectrogramRecording(bool enabled)
 {
-    channel_power.Configure(enable, width, spacing);
+    if(!enabled) {
+        spectrogram.Close();
+        return false;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(0,
+                                                    tr("Spectrogram File Name"),
+                                                    sh::GetDefaultExportDirectory(),
+                                                    tr("Spectrogram Files (*.spec)"));
+
+    if(fileName.isNull()) return false;
+
+    sh::SetDefaultExportDirectory(QFileInfo(fileName).absoluteDir().absolutePath());
+
+    // Same size limit as playback recordings
+    if(!spectrogram.Open(fileName, (qint64)platformMaxFileSize << 30)) {
+        QMessageBox::warning(0, tr("Recording Failed"),
+                             tr("Unable to record the spectrogram to ") + fileName +
+                             "\n" + spectrogram.ErrorString());
+        return false;
+    }
+
+    return true;
+}
+
+// Whole recording, one pixel per bin and row up to about a screen
+void TraceManager::exportSpectrogramImage()
+{
+    if(spectrogram.Rows() <= 0) {
+        QMessageBox::information(0, tr("Nothing to Export"),
+                                 tr("No spectrogram has been recorded"));
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(0,
+                                                    tr("Export File Name"),
+                                                    sh::GetDefaultExportDirectory(),
+                                                    tr("PNG Files (*.png)"));
+
+    if(fileName.isNull()) return;
+
+    QSize size(bb_lib::min2(spectrogram.Bins(), 1920),
+               (int)bb_lib::min2(spectrogram.Rows(), (qint64)1080));
+    if(!spectrogram.ExportImage(fileName, SpectrogramRegion(), size)) {
+        QMessageBox::warning(0, tr("Export Failed"),
+                             tr("Unable to export the spectrogram to ") + fileName);
+        return;
+    }
+
+    sh::SetDefaultExportDirectory(QFileInfo(fileName).absoluteDir().absolutePath());
+}
+
+void TraceManager::exportSpectrogramCSV()
+{
+    if(spectrogram.Rows() <= 0) {
+        QMessageBox::information(0, tr("Nothing to Export"),
+                                 tr("No spectrogram has been recorded"));
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(0,
+                                                    tr("Export File Name"),
+                                                    sh::GetDefaultExportDirectory(),
+                                                    tr("CSV Files (*.csv)"));
+
+    if(fileName.isNull()) return;
+
+    if(!spectrogram.ExportCSV(fileName, SpectrogramRegion(), 10000, 4000)) {
+        QMessageBox::warning(0, tr("Export Failed"),
+                             tr("Unable to export the spectrogram to ") + fileName);
+        return;
+    }
+
+    sh::SetDefaultExportDirectory(QFileInfo(fileName).absoluteDir().absolutePath());
 }
 
 void TraceManager::SetOccupiedBandwidth(bool enabled, double percentPower)
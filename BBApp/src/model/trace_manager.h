@@ -2,23 +2,53 @@
 #define TRACE_MANAGER_H
 
 #include <array>
+#include <vector>
 
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QObject>
 
 #include "../lib/macros.h"
-#include "../lib/threadsafe_queue.h"
+#include "../lib/spsc_ring.h"
+#include "../lib/triple_buffer.h"
 #include "trace.h"
 #include "marker.h"
 #include "persistence.h"
 #include "import_table.h"
+#include "peak_table.h"
+#include "channel_power.h"
+#include "occupancy.h"
+#include "spectrogram_store.h"
 
 class Settings;
 class DemodSettings;
 
+// One published copy of every trace, see TraceManager::RefreshSnapshot()
+struct TraceSet {
+    TraceSet() : traces(nullptr), count(0) {}
+    ~TraceSet() { delete [] traces; }
+
+    void Resize(int n) {
+        if(n == count) return;
+        delete [] traces;
+        traces = new Trace[n];
+        count = n;
+    }
+
+    Trace *traces;
+    int count;
+    // Peak table of the last full sweep
+    std::vector<PeakTableEntry> peaks;
+    // Occupancy percent as of the last full sweep, inactive when off
+    Trace occupancy;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TraceSet)
+};
+
 /*
  * One copy found in the Session class.
- * Represents 6 traces and 6 markers
+ * Represents TraceCount() traces and 6 markers
  * Has one "active" trace at a time.
  * Most methods forward messages to that trace.
  * This prevents anyone from having non-const
@@ -33,7 +63,8 @@ public:
     TraceManager();
     ~TraceManager();
 
-    // Lock and Unlock access to the traces
+    // Lock and Unlock access to the live traces
+    // The views do not need the lock, they read the snapshot
     void Lock() { modMutex.lock(); }
     void Unlock() { modMutex.unlock(); }
 
@@ -59,7 +90,22 @@ public:
         return activeTrace;
     }
 
+    // Number of traces, "TraceCount" in the preferences .ini,
+    //   fixed for the lifetime of the manager
+    int TraceCount() const { return traceCount; }
+    // Display name of a trace, "One" through "Six" then numbered
+    static QString TraceName(int index);
+
+    // Take the newest published copy of the traces, GUI thread only
+    // Call once per paint, GetTrace() returns from this copy until the
+    //   next call so a paint never sees a half updated trace
+    // Returns true if the copy changed
+    bool RefreshSnapshot() { return snapshots.Update(); }
+    // Updates published while the GUI was busy and never drawn
+    qint64 SkippedSnapshots() const { return snapshots.Skipped(); }
+
     // Get traces
+    // The active trace is the live one, GetTrace() is from the snapshot
     Trace* GetActiveTrace() { return &traces[activeTrace]; }
     const Trace* GetTrace(int index);
     // Return the index of the first found active trace
@@ -85,14 +131,39 @@ public:
 
     double RefOffset() const { return ref_offset; }
 
-    void SetChannelPower(bool enable, Frequency width, Frequency spacing);
+    // Main channel plus adjacent channels on either side
+    void SetChannelPower(bool enable, Frequency width, Frequency spacing, int adjacent);
     const ChannelPower* GetChannelPowerInfo() const { return &channel_power; }
 
     void SetOccupiedBandwidth(bool enabled, double percentPower);
     const OccupiedBandwidthInfo& GetOccupiedBandwidthInfo() const { return ocbw; }
 
-    // Real-Time and Waterfall trace buffer
-    ThreadSafeQueue<GLVector, 32> trace_buffer;
+    // Peak table of the active trace, searched after every full sweep
+    void SetPeakTable(bool enabled, int peaks, double excursion, double threshold);
+    bool IsPeakTableEnabled() const { return peakTable.IsEnabled(); }
+    // From the snapshot, see RefreshSnapshot()
+    const std::vector<PeakTableEntry>& GetPeakTable() const {
+        return snapshots.Front().peaks;
+    }
+
+    // Expression of the active trace, used when its type is MATH
+    void SetTraceMath(const TraceMathExpr &expr);
+
+    // Occupancy of the incoming sweeps, changing the settings starts
+    //   a new run
+    void SetOccupancy(bool enabled, OccupancyThreshold mode, double threshold, double margin);
+    // From the snapshot, percent in [0,100], Active() when enabled
+    const Trace* GetOccupancyTrace() const { return &snapshots.Front().occupancy; }
+
+    // Record every full sweep to a spectrogram file, prompts for the
+    //   file when enabled, returns whether a recording is running
+    bool SetSpectrogramRecording(bool enabled);
+
+    // Persistence and waterfall feed, full sweeps normalized on the
+    //   update thread, drained by the TraceView
+    // The oldest sweeps are dropped when the view falls behind, see
+    //   SPSCRing::Dropped()
+    SPSCRing<GLVector> trace_buffer;
 
     RealTimeFrame realTimeFrame;
 
@@ -101,14 +172,28 @@ public:
 protected:
 
 private:
-    // 6 traces and current index
+    // Copy the traces into the snapshot buffer, modMutex must be held
+    void PublishSnapshot();
+    // Operand of the math trace at index, null if it cannot be one
+    const Trace* GetMathOperand(int index, int operand) const;
+    // A trace changed outside of an update, math traces recompute in full
+    void InvalidateMath();
+
+    // Traces and current index
     int activeTrace;
-    Trace traces[TRACE_COUNT];
+    int traceCount;
+    Trace *traces;
+    // Traces taking the current update, see UpdateTraces()
+    std::vector<Trace*> updating;
     // 6 markers and current index
     int activeMarker;
     Marker markers[MARKER_COUNT];
     // Use to lock access to traces
     QMutex modMutex;
+    // Copies of the traces handed from the update thread to the GUI
+    TripleBuffer<TraceSet> snapshots;
+    // Since the last PublishSnapshot(), throttles partial sweeps
+    QElapsedTimer lastPublish;
 
     PathLossTable pathLoss;
     LimitLineTable limitLine;
@@ -116,9 +201,19 @@ private:
     double ref_offset; // dB
 
     ChannelPower channel_power;
+    BandPower bandPower;
     OccupiedBandwidthInfo ocbw;
+    PeakTable peakTable;
+    Occupancy occupancy;
+    Trace occupancyTrace;
+    SpectrogramStore spectrogram;
 
     bool lastTraceAboveReference;
+    // Max of the incoming sweeps, refreshed over each update range
+    PeakIndex inputPeaks;
+    // Normalizes full sweeps into trace_buffer
+    DecimationPlan bufferPlan;
+    double inputPeaksOffset; // ref_offset the index was built with
 
 public slots:
     // Modifies the active trace or sets the active trace
@@ -127,6 +222,8 @@ public slots:
     void setUpdate(bool);
     void setType(int);
     void setAvgCount(double);
+    void setAvgMode(int);
+    void setPercentile(double);
     void setColor(QColor &);
     void toFront();
     void clearTrace();
@@ -153,6 +250,12 @@ public slots:
     void importLimitLines();
     void clearLimitLines();
 
+    void exportOccupancy();
+    void resetOccupancy();
+
+    void exportSpectrogramImage();
+    void exportSpectrogramCSV();
+
 //    void setChannelPower(bool enable);
 //    void setChannelWidth(Frequency width);
 //    void setChannelSpacing(Frequency spacing);
@@ -163,6 +266,9 @@ signals:
     //
     void changeCenterFrequency(Frequency center);
     void changeReferenceLevel(Amplitude amplitude);
+    // Spectrogram recording stopped on its own, emitted from the
+    //   update thread
+    void spectrogramStopped(const QString &reason);
 
 private:
     DISALLOW_COPY_AND_ASSIGN(TraceManager)
@@ -0,0 +1,58 @@
+#include "trace_math.h"
+#include "lib/amplitude.h"
+#include "lib/simd_kernels.h"
+
+#include <cmath>
+
+namespace {
+
+const int MATH_BLOCK = 4096;
+
+} // namespace
+
+void TraceMath::Evaluate(const float *a, const float *b, float *dst, int len, bool logScale)
+{
+    if((int)scratchA.size() < MATH_BLOCK) {
+        scratchA.resize(MATH_BLOCK);
+        scratchB.resize(MATH_BLOCK);
+    }
+
+    for(int i = 0; i < len; i += MATH_BLOCK) {
+        int n = (len - i < MATH_BLOCK) ? (len - i) : MATH_BLOCK;
+        EvaluateBlock(a + i, b + i, dst + i, n, logScale);
+    }
+}
+
+void TraceMath::EvaluateBlock(const float *a, const float *b, float *dst, int len, bool logScale)
+{
+    // Weight of B, A always has weight one
+    float wb = 0.0f;
+    if(expr.op == MathAMinusB || expr.op == MathNormalize) {
+        wb = -1.0f;
+    } else if(expr.op == MathAPlusB) {
+        wb = 1.0f;
+    }
+
+    float *sa = &scratchA[0], *sb = &scratchB[0];
+
+    if(expr.domain == MathDomainPower && expr.op != MathNormalize) {
+        // The constant is a gain on the power
+        float gain = pow(10.0, expr.constant / 10.0);
+        TraceToPower_32f(a, sa, len, logScale);
+        TraceToPower_32f(b, sb, len, logScale);
+        simdCombine_32f(sa, gain, sb, wb * gain, 0.0f, sa, len);
+        if(wb < 0.0f) {
+            for(int i = 0; i < len; i++) {
+                sa[i] = (sa[i] > 0.0f) ? sa[i] : 0.0f;
+            }
+        }
+        PowerToTrace_32f(sa, dst, len, logScale);
+    } else if(logScale) {
+        simdCombine_32f(a, 1.0f, b, wb, expr.constant, dst, len);
+    } else {
+        unit_convert_32f(a, sa, len, MV, DBM);
+        unit_convert_32f(b, sb, len, MV, DBM);
+        simdCombine_32f(sa, 1.0f, sb, wb, expr.constant, sa, len);
+        unit_convert_32f(sa, dst, len, DBM, MV);
+    }
+}
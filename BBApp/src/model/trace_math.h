@@ -0,0 +1,62 @@
+#ifndef TRACE_MATH_H
+#define TRACE_MATH_H
+
+#include <vector>
+
+#include "lib/macros.h"
+
+// Must match the combo-box indices
+enum TraceMathOp {
+    MathAMinusB   = 0,
+    MathAPlusB    = 1,
+    MathNormalize = 2, // A - B in dB whatever the domain, the offset is
+                       //   the level a flat response sits at
+    MathOffset    = 3  // A alone
+};
+
+// Must match the combo-box indices
+enum TraceMathDomain {
+    MathDomainLog   = 0, // dB, linear traces are converted to dBm
+    MathDomainPower = 1  // mW or mV^2
+};
+
+struct TraceMathExpr {
+    TraceMathExpr() : op(MathAMinusB), a(0), b(1),
+        constant(0.0), domain(MathDomainLog) {}
+
+    TraceMathOp op;
+    int a, b; // Operand trace indices
+    double constant; // dB added to the result
+    TraceMathDomain domain;
+};
+
+/*
+ * Evaluates an expression over two operand buffers into a derived trace
+ * Log domain math is one combine pass over the displayed values, power
+ *   domain math converts the operands to power and back, a difference
+ *   below zero power is floored at zero.
+ * Works through a fixed size scratch block so a dirty range of any
+ *   length stays in cache.
+ */
+class TraceMath {
+public:
+    TraceMath() {}
+    ~TraceMath() {}
+
+    void SetExpression(const TraceMathExpr &e) { expr = e; }
+    const TraceMathExpr& Expression() const { return expr; }
+
+    // dst[i] = expr(a[i], b[i]), all in trace units
+    void Evaluate(const float *a, const float *b, float *dst, int len, bool logScale);
+
+private:
+    void EvaluateBlock(const float *a, const float *b, float *dst, int len, bool logScale);
+
+    TraceMathExpr expr;
+    std::vector<float> scratchA, scratchB;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TraceMath)
+};
+
+#endif // TRACE_MATH_H
@@ -0,0 +1,161 @@
+#ifndef TRACE_POOL_H
+#define TRACE_POOL_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "trace.h"
+#include "lib/macros.h"
+
+// One buffer handed between the acquisition and processing stages
+struct SweepPacket {
+    SweepPacket() : trace(true), generation(-1) {}
+
+    Trace trace;
+    RealTimeFrame frame;
+    // Configuration the packet was acquired under
+    int generation;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SweepPacket)
+};
+
+/*
+ * Fixed set of pre-allocated sweep buffers cycling between a
+ *   producer (device fetch) and a consumer (trace processing).
+ * Buffers are never freed while streaming, only resized when the
+ *   configuration changes.
+ * If the consumer falls behind and no free buffer remains, the
+ *   oldest unprocessed sweep is reclaimed and counted as dropped,
+ *   so the device is never left waiting on the host.
+ */
+class TracePool {
+public:
+    // Requires depth >= 3, one buffer per stage plus one in flight
+    TracePool(int depth = DEFAULT_DEPTH) :
+        packets(depth)
+    {
+        for(int i = 0; i < depth; i++) {
+            packets[i] = new SweepPacket;
+            freeList.push_back(packets[i]);
+        }
+        ResetCounters();
+    }
+
+    ~TracePool()
+    {
+        for(SweepPacket *p : packets) {
+            delete p;
+        }
+    }
+
+    // Producer, always returns a buffer, dropping the oldest
+    //   ready sweep when none are free
+    SweepPacket* AcquireFree()
+    {
+        std::lock_guard<std::mutex> lg(lock);
+        SweepPacket *p;
+        if(!freeList.empty()) {
+            p = freeList.front();
+            freeList.pop_front();
+        } else {
+            p = readyList.front();
+            readyList.pop_front();
+            dropped++;
+        }
+        return p;
+    }
+
+    // Producer, hand a filled buffer to the consumer
+    void PushReady(SweepPacket *p)
+    {
+        {
+            std::lock_guard<std::mutex> lg(lock);
+            readyList.push_back(p);
+            produced++;
+            if((int)readyList.size() > peakDepth) {
+                peakDepth = readyList.size();
+            }
+        }
+        readyCond.notify_one();
+    }
+
+    // Producer, return an unused buffer
+    void ReturnFree(SweepPacket *p)
+    {
+        std::lock_guard<std::mutex> lg(lock);
+        freeList.push_front(p);
+    }
+
+    // Consumer, wait up to timeoutMs for the oldest ready sweep
+    // Returns nullptr on timeout
+    SweepPacket* PopReady(int timeoutMs)
+    {
+        std::unique_lock<std::mutex> lg(lock);
+        if(!readyCond.wait_for(lg, std::chrono::milliseconds(timeoutMs),
+                               [this]{ return !readyList.empty(); })) {
+            return nullptr;
+        }
+        SweepPacket *p = readyList.front();
+        readyList.pop_front();
+        // The consumer owns p until Release(), it is in neither list
+        return p;
+    }
+
+    // Consumer, finished with the buffer
+    void Release(SweepPacket *p)
+    {
+        std::lock_guard<std::mutex> lg(lock);
+        consumed++;
+        freeList.push_back(p);
+    }
+
+    // Discard all unprocessed sweeps, used on reconfiguration
+    // Buffers held by either stage are returned through the
+    //   normal Release()/ReturnFree() path
+    void Flush()
+    {
+        std::lock_guard<std::mutex> lg(lock);
+        while(!readyList.empty()) {
+            freeList.push_back(readyList.front());
+            readyList.pop_front();
+        }
+    }
+
+    void ResetCounters()
+    {
+        std::lock_guard<std::mutex> lg(lock);
+        produced = consumed = dropped = 0;
+        peakDepth = 0;
+    }
+
+    int Capacity() const { return packets.size(); }
+    // Sweeps acquired but not yet picked up by the consumer
+    int QueueDepth() const
+    {
+        std::lock_guard<std::mutex> lg(lock);
+        return readyList.size();
+    }
+    int PeakQueueDepth() const { return peakDepth; }
+    qint64 Produced() const { return produced; }
+    qint64 Consumed() const { return consumed; }
+    qint64 Dropped() const { return dropped; }
+
+    static const int DEFAULT_DEPTH = 4;
+
+private:
+    std::vector<SweepPacket*> packets;
+    std::deque<SweepPacket*> freeList, readyList;
+    mutable std::mutex lock;
+    std::condition_variable readyCond;
+
+    std::atomic<qint64> produced, consumed, dropped;
+    std::atomic<int> peakDepth;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TracePool)
+};
+
+#endif // TRACE_POOL_H
@@ -3,71 +3,20 @@
 #include "demod_iq_time_plot.h"
 #include "demod_spectrum_plot.h"
 #include "demod_sweep_plot.h"
+#include "../mainwindow.h"
 
 #include <QXmlStreamWriter>
 #include <iostream>
 
-//CircularBuffer::CircularBuffer()
-//{
-
-//}
-
-//CircularBuffer::~CircularBuffer()
-//{
-
-//}
-
-//void CircularBuffer::Resize(int captureSize)
-//{
-//    bufferLock.lock();
-//    buffer.resize(captureSize * TOTAL_PACKETS);
-//    packetLen = captureSize;
-//    available = 0;
-//    storeIx = 0;
-//    retreiveIx = 0;
-//    bufferLock.unlock();
-//}
-
-//void CircularBuffer::Store(std::vector<complex_f> &src)
-//{
-//    bufferLock.lock();
-//    std::copy(src.begin(), src.end(), buffer.begin() + storeIx);
-//    bufferLock.unlock();
-
-//    available += packetLen;
-//    packetRecieved.notify();
-//    storeIx += packetLen;
-//    if(storeIx >= TOTAL_PACKETS * packetLen) storeIx = 0;
-//}
-
-//void CircularBuffer::GetCapture(IQSweep &sweep)
-//{
-//    retreiveIx = storeIx;
-//    available = 0;
-//    auto iter = sweep.iq.begin();
-
-//    int toGet = sweep.sweepLen;
-//    while(toGet > 0) {
-//        packetRecieved.wait();
-//        size_t toCopy = std::min(toGet, packetLen);
-//        toCopy = std::min(toCopy, buffer.size() - retreiveIx);
-//        if(toCopy > available) continue;
-//        iter = std::copy(buffer.begin() + retreiveIx,
-//                         buffer.begin() + retreiveIx + toCopy,
-//                         iter);
-//        toGet -= toCopy;
-//        available -= toCopy;
-//        retreiveIx += toCopy;
-//        if(retreiveIx >= buffer.size()) retreiveIx = 0;
-//    }
-//}
-
 DemodCentral::DemodCentral(Session *sPtr,
                            QToolBar *toolBar,
                            QWidget *parent,
                            Qt::WindowFlags f) :
     CentralWidget(parent, f),
     sessionPtr(sPtr),
+    collecting(false),
+    holdingPacket(false),
+    dropBaseline(0),
     reconfigure(false),
     recordBinary(true),
     recordDialog(this)
@@ -187,6 +136,9 @@ DemodCentral::DemodCentral(Session *sPtr,
 
     connect(sessionPtr->demod_settings, SIGNAL(updated(const DemodSettings*)),
             this, SLOT(updateSettings(const DemodSettings*)));
+
+    statsTimer.setInterval(500);
+    connect(&statsTimer, SIGNAL(timeout()), this, SLOT(updateOverflowStats()));
 }
 
 DemodCentral::~DemodCentral()
@@ -244,6 +196,26 @@ void DemodCentral::resizeEvent(QResizeEvent *)
     recordToolBar->move(0, height() - 30);
 }
 
+void DemodCentral::showEvent(QShowEvent *)
+{
+    statsTimer.start();
+}
+
+void DemodCentral::hideEvent(QHideEvent *)
+{
+    statsTimer.stop();
+    MainWindow::GetStatusBar()->SetPipelineStats("");
+}
+
+// Packets lost since the last reconfigure, the captures are not
+//   gapless while this is non-zero
+void DemodCentral::updateOverflowStats()
+{
+    qint64 overflows = IQOverflows();
+    MainWindow::GetStatusBar()->SetPipelineStats(
+                overflows > 0 ? QString("%1 I/Q overflows").arg(overflows) : QString(""));
+}
+
 void DemodCentral::changeMode(int newState)
 {
     StopStreaming();
@@ -256,16 +228,26 @@ void DemodCentral::changeMode(int newState)
     }
 }
 
-void DemodCentral::Reconfigure(DemodSettings *ds, IQCapture *iqc, IQSweep &iqs)
+void DemodCentral::Reconfigure(DemodSettings *ds, IQSweep &iqs)
 {
+    StopCollecting();
+
     if(!sessionPtr->device->Reconfigure(ds, &iqs.descriptor)) {
         *ds = lastConfig;
     } else {
         lastConfig = *ds;
     }
 
-    // Resize single capture size and full sweep
-    iqc->capture.resize(iqs.descriptor.returnLen);
+    // Buffer ~250ms of I/Q so demod and drawing can stall without
+    //   losing samples, at most 256 packets at the full sample rate
+    double packetTime = iqs.descriptor.returnLen * iqs.descriptor.timeDelta;
+    int packets = (packetTime > 0.0) ? (int)(0.25 / packetTime) : 0;
+    bb_lib::clamp(packets, MIN_IQ_RING_PACKETS, MAX_IQ_RING_PACKETS);
+    iqRing.Resize(packets);
+    dropBaseline = 0;
+    for(int i = 0; i < iqRing.SlotCount(); i++) {
+        iqRing.Slot(i).capture.resize(iqs.descriptor.returnLen);
+    }
 
     int sweepLen = ds->SweepTime().Val() / iqs.descriptor.timeDelta;
     int fullLen = bb_lib::next_multiple_of(iqs.descriptor.returnLen,
@@ -276,11 +258,100 @@ void DemodCentral::Reconfigure(DemodSettings *ds, IQCapture *iqc, IQSweep &iqs)
     iqs.preTrigger = (int)(ds->TrigPosition() * 0.01 * sweepLen);
     iqs.settings = *ds;
 
+    StartCollecting(sessionPtr->device);
     reconfigure = false;
 }
 
+void DemodCentral::StartCollecting(Device *device)
+{
+    holdingPacket = false;
+    collecting = true;
+    collectHandle = std::thread(&DemodCentral::CollectThread, this, device);
+}
+
+void DemodCentral::StopCollecting()
+{
+    collecting = false;
+    if(collectHandle.joinable()) {
+        collectHandle.join();
+    }
+    holdingPacket = false;
+}
+
+// Producer
+// Never waits on the consumer, if the ring is full the packet is
+//   fetched anyway to keep the device from backing up, and counted
+void DemodCentral::CollectThread(Device *device)
+{
+    IQCapture scratch;
+    scratch.capture.resize(iqRing.Slot(0).capture.size());
+    device->SetAutoRecover(true);
+
+    while(collecting) {
+        IQCapture *slot = iqRing.WriteSlot();
+        if(!slot) {
+            slot = &scratch;
+        }
+
+        if(!device->GetIQ(slot)) {
+            // Reopen and restart the stream in place, the consumer sees
+            //   a gap in the I/Q
+            if(device->ConnectionLost() && device->Recover(collecting)) {
+                continue;
+            }
+            collecting = false;
+            break;
+        }
+
+        if(slot != &scratch) {
+            iqRing.CommitWrite();
+        }
+    }
+
+    device->SetAutoRecover(false);
+}
+
+const IQCapture* DemodCentral::NextIQPacket()
+{
+    if(holdingPacket) {
+        iqRing.CommitRead();
+        holdingPacket = false;
+    }
+
+    IQCapture *packet;
+    int spins = 0;
+    while(!(packet = iqRing.ReadSlot())) {
+        // Stopped, either by a reconfigure or a device error
+        if(!collecting) {
+            return nullptr;
+        }
+        // Packets arrive every few hundred microseconds at the higher
+        //   sample rates, yield before giving up the time slice
+        if(spins++ < 64) {
+            std::this_thread::yield();
+        } else {
+            Sleep(1);
+        }
+    }
+
+    holdingPacket = true;
+    return packet;
+}
+
+void DemodCentral::DrainIQ()
+{
+    if(holdingPacket) {
+        iqRing.CommitRead();
+        holdingPacket = false;
+    }
+    while(iqRing.ReadSlot()) {
+        iqRing.CommitRead();
+    }
+    // Nothing was waiting on the packets lost so far
+    dropBaseline = iqRing.Dropped();
+}
+
 bool DemodCentral::GetCapture(const DemodSettings *ds,
-                              IQCapture &iqc,
                               IQSweep &iqs,
                               Device *device)
 {
@@ -289,21 +360,27 @@ bool DemodCentral::GetCapture(const DemodSettings *ds,
     int forceTriggerPacketCount = 4 * (0x1 << ds->DecimationFactor());
     forceTriggerPacketCount = qMin(forceTriggerPacketCount,
                                    500 / device->MsPerIQCapture());
-    buffer.resize(forceTriggerPacketCount * iqc.capture.size());
+    int returnLen = iqs.descriptor.returnLen;
+    buffer.resize(qMax(forceTriggerPacketCount * returnLen, (int)iqs.iq.size()));
 
     int retrieved = 0;
     int toRetrieve = iqs.sweepLen;
     int preTrigger = iqs.preTrigger; // Samples before the trigger
     int firstIx = 0; // Start index in first capture
-    bool flush = iqs.triggered; // Clear the API buffer?
+    bool flush = iqs.triggered; // Skip to the newest data?
     iqs.triggered = false;
 
+    // Each capture starts on fresh data, everything after the first
+    //   packet is contiguous
+    if(flush) {
+        DrainIQ();
+    }
+    const IQCapture *iqc = NextIQPacket();
+    if(!iqc) return false;
+
     if(ds->TrigType() == TriggerTypeNone) {
-        if(!device->GetIQFlush(&iqc, flush)) return false;
         iqs.triggered = true;
     } else {
-        // Start with flush
-        if(!device->GetIQFlush(&iqc, flush)) return false;
         if(ds->TrigType() == TriggerTypeVideo || ds->TrigType() == TriggerTypeExternal) {
             double trigVal = ds->TrigAmplitude().ConvertToUnits(DBM);
             trigVal = pow(10.0, (trigVal/10.0));
@@ -311,19 +388,19 @@ bool DemodCentral::GetCapture(const DemodSettings *ds,
             int placePos = 0;
             int mustWait = preTrigger;
             while(maxTimeForTrig++ < forceTriggerPacketCount) {
-                simdCopy_32fc(&iqc.capture[0], &buffer[placePos], iqc.capture.size());
+                simdCopy_32fc(&iqc->capture[0], &buffer[placePos], returnLen);
 
-                if(mustWait < iqc.capture.size()) {
+                if(mustWait < returnLen) {
                     if(ds->TrigType() == TriggerTypeVideo) {
                         if(ds->TrigEdge() == TriggerEdgeRising) {
-                            firstIx = find_rising_trigger(&iqc.capture[mustWait],
-                                                          trigVal, iqc.capture.size() - mustWait);
+                            firstIx = find_rising_trigger(&iqc->capture[mustWait],
+                                                          trigVal, returnLen - mustWait);
                         } else {
-                            firstIx = find_falling_trigger(&iqc.capture[mustWait],
-                                                           trigVal, iqc.capture.size() - mustWait);
+                            firstIx = find_falling_trigger(&iqc->capture[mustWait],
+                                                           trigVal, returnLen - mustWait);
                         }
                     } else if(ds->TrigType() == TriggerTypeExternal) {
-                        firstIx = iqc.triggers[0];
+                        firstIx = iqc->triggers[0];
                         if(firstIx != 0) {
                             firstIx /= ((0x1 << ds->DecimationFactor()) * 2);
                             if(firstIx < mustWait) firstIx = -1;
@@ -347,11 +424,12 @@ bool DemodCentral::GetCapture(const DemodSettings *ds,
                     break;
                 }
 
-                device->GetIQ(&iqc);
+                iqc = NextIQPacket();
+                if(!iqc) return false;
                 firstIx = 0;
-                mustWait -= iqc.capture.size();
+                mustWait -= returnLen;
                 if(mustWait < 0) mustWait = 0;
-                placePos += iqc.capture.size();
+                placePos += returnLen;
             }
         }
     }
@@ -359,17 +437,21 @@ bool DemodCentral::GetCapture(const DemodSettings *ds,
     // Retrieve the rest of the capture after the trigger, or retrieve the
     //   entire capture if there is no trigger
     while(toRetrieve > 0) {
-        int toCopy = bb_lib::min2(iqs.descriptor.returnLen,
-                                  iqs.descriptor.returnLen - firstIx);
-        simdCopy_32fc(&iqc.capture[firstIx], &buffer[retrieved], toCopy);
+        int toCopy = returnLen - firstIx;
+        if(retrieved + toCopy > (int)buffer.size()) {
+            buffer.resize(retrieved + toCopy);
+        }
+        simdCopy_32fc(&iqc->capture[firstIx], &buffer[retrieved], toCopy);
         firstIx = 0;
         toRetrieve -= toCopy;
         retrieved += toCopy;
         if(toRetrieve > 0) {
-            device->GetIQ(&iqc);
+            iqc = NextIQPacket();
+            if(!iqc) return false;
         }
     }
 
+    retrieved = qMin(retrieved, (int)iqs.iq.size());
     simdCopy_32fc(&buffer[0], &iqs.iq[0], retrieved);
 
     // Store how many total samples we have access to
@@ -379,25 +461,25 @@ bool DemodCentral::GetCapture(const DemodSettings *ds,
 
 void DemodCentral::StreamThread()
 {
-    IQCapture iqc;
     IQSweep sweep;
 
-    Reconfigure(sessionPtr->demod_settings, &iqc, sweep);
+    Reconfigure(sessionPtr->demod_settings, sweep);
 
     while(streaming) {
         if(captureCount) {
             if(reconfigure) {
-                Reconfigure(sessionPtr->demod_settings, &iqc, sweep);
+                Reconfigure(sessionPtr->demod_settings, sweep);
             }
             qint64 start = bb_lib::get_ms_since_epoch();
 
-            if(!GetCapture(sessionPtr->demod_settings, iqc, sweep, sessionPtr->device)) {
+            if(!GetCapture(sessionPtr->demod_settings, sweep, sessionPtr->device)) {
+                StopCollecting();
                 streaming = false;
                 return;
             }
 
             if(recordNext && sweep.triggered) {
-                RecordIQCapture(sweep, iqc, sessionPtr->device);
+                RecordIQCapture(sweep);
             }
 
             if(demodArea->viewLock.try_lock()) {
@@ -421,14 +503,19 @@ void DemodCentral::StreamThread()
                 }
             }
         } else {
+            // Idle, nothing collected meanwhile is of interest
+            DrainIQ();
             Sleep(MAX_ZERO_SPAN_UPDATE_RATE);
         }
     }
 
+    StopCollecting();
     sessionPtr->device->Abort();
 }
 
-void DemodCentral::RecordIQCapture(const IQSweep &sweep, IQCapture &capture, Device *device)
+// The rest of the recording continues from the packet after the
+//   last one in the sweep, with no gap between them
+void DemodCentral::RecordIQCapture(const IQSweep &sweep)
 {
     emit showRecordingDialog(true);
 
@@ -452,8 +539,11 @@ void DemodCentral::RecordIQCapture(const IQSweep &sweep, IQCapture &capture, Dev
 
     int fetches = 0, retrieved = toGet;
     while(retrieved > 0) {
-        device->GetIQ(&capture);
-        simdCopy_32fc(&capture.capture[0],
+        const IQCapture *capture = NextIQPacket();
+        if(!capture) {
+            break;
+        }
+        simdCopy_32fc(&capture->capture[0],
                 &rest[fetches * sweep.descriptor.returnLen],
                 sweep.descriptor.returnLen);
         fetches++;
@@ -512,76 +602,6 @@ void DemodCentral::RecordIQCapture(const IQSweep &sweep, IQCapture &capture, Dev
     recordNext = false;
 }
 
-//void DemodCentral::CollectThread(Device *device, int captureLen)
-//{
-//    IQCapture packet;
-//    packet.capture.resize(captureLen);
-//    //circularBuffer.Resize(captureLen);
-
-//    while(!reconfigure) {
-//        device->GetIQ(&packet);
-//        //circularBuffer.Store(packet.capture);
-//    }
-//}
-
-//void DemodCentral::StreamThread()
-//{
-//    std::thread collectThreadHandle;
-//    IQCapture iqc;
-//    IQSweep sweep;
-
-//    Reconfigure(sessionPtr->demod_settings, &iqc, sweep);
-//    circularBuffer.Resize(sweep.descriptor.returnLen);
-//    collectThreadHandle = std::thread(&DemodCentral::CollectThread, this,
-//                                      sessionPtr->device, sweep.descriptor.returnLen);
-
-//    while(streaming) {
-//        if(captureCount) {
-//            if(reconfigure) {
-//                collectThreadHandle.join();
-//                Reconfigure(sessionPtr->demod_settings, &iqc, sweep);
-//                circularBuffer.Resize(sweep.descriptor.returnLen);
-//                collectThreadHandle = std::thread(&DemodCentral::CollectThread, this,
-//                                                  sessionPtr->device, sweep.descriptor.returnLen);
-//            }
-//            qint64 start = bb_lib::get_ms_since_epoch();
-
-//            circularBuffer.GetCapture(sweep);
-
-////            GetCapture(sessionPtr->demod_settings, iqc, sweep, sessionPtr->device);
-////            if(recordNext && sweep.triggered) {
-////                RecordIQCapture(sweep, iqc, sessionPtr->device);
-////            }
-
-//            if(demodArea->viewLock.try_lock()) {
-//                sweep.Demod();
-//                if(sweep.settings.MAEnabled()) {
-//                    sweep.CalculateReceiverStats();
-//                }
-//                sessionPtr->iq_capture = sweep;
-//                UpdateView();
-//                demodArea->viewLock.unlock();
-//            }
-
-//            // Force 30 fps update rate
-//            qint64 elapsed = bb_lib::get_ms_since_epoch() - start;
-//            if(elapsed < MAX_ZERO_SPAN_UPDATE_RATE) {
-//                Sleep(MAX_ZERO_SPAN_UPDATE_RATE - elapsed);
-//            }
-//            if(captureCount > 0) {
-//                if(sweep.triggered) {
-//                    captureCount--;
-//                }
-//            }
-//        } else {
-//            Sleep(MAX_ZERO_SPAN_UPDATE_RATE);
-//        }
-//    }
-
-//    reconfigure = true;
-//    collectThreadHandle.join();
-//}
-
 void DemodCentral::updateSettings(const DemodSettings *ds)
 {
     reconfigure = true;
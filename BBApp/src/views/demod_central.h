@@ -7,10 +7,12 @@
 #include <QMdiSubWindow>
 #include <QPaintEvent>
 #include <QMessageBox>
+#include <QTimer>
 
 #include <mutex>
 
 #include "lib/bb_lib.h"
+#include "lib/spsc_ring.h"
 #include "model/session.h"
 #include "central_stack.h"
 #include "gl_sub_view.h"
@@ -64,26 +66,6 @@ private:
     DISALLOW_COPY_AND_ASSIGN(MdiArea)
 };
 
-//class CircularBuffer {
-//public:
-//    CircularBuffer();
-//    ~CircularBuffer();
-
-//    void Resize(int captureSize);
-//    void Store(std::vector<complex_f> &src);
-//    void GetCapture(IQSweep &sweep);
-//    void GetData(complex_f *dst, int len);
-
-//private:
-//    static const int TOTAL_PACKETS = 40;
-//    int packetLen;
-//    std::mutex bufferLock;
-//    semaphore packetRecieved;
-//    std::atomic<int> available;
-//    std::vector<complex_f> buffer;
-//    int storeIx, retreiveIx;
-//};
-
 class DemodCentral : public CentralWidget {
     Q_OBJECT
 
@@ -99,21 +81,46 @@ public:
     void ResetView();
     void GetViewImage(QImage &image);
     Frequency GetCurrentCenterFreq() const;
+    // I/Q packets the collector had to discard while a capture was
+    //   reading the stream, non-zero means a capture was not gapless
+    // Packets dropped while idle are discarded by DrainIQ() anyway and
+    //   are not counted
+    qint64 IQOverflows() const { return iqRing.Dropped() - dropBaseline; }
 
 protected:
     void resizeEvent(QResizeEvent *);
+    void showEvent(QShowEvent *);
+    void hideEvent(QHideEvent *);
 
 private:
-    void Reconfigure(DemodSettings *ds, IQCapture *iqc, IQSweep &iqSweep);
-    bool GetCapture(const DemodSettings *ds, IQCapture &iqc,
-                    IQSweep &iq, Device *device);
-    //void CollectThread(Device *device, int captureLen);
+    void Reconfigure(DemodSettings *ds, IQSweep &iqSweep);
+    bool GetCapture(const DemodSettings *ds, IQSweep &iq, Device *device);
+    // Continuously fetches I/Q into iqRing, the only thread which
+    //   talks to the device while streaming
+    void CollectThread(Device *device);
+    void StartCollecting(Device *device);
+    void StopCollecting();
+    // Consumer side of iqRing, the returned packet is valid until the
+    //   next call, nullptr if the collector stopped
+    const IQCapture* NextIQPacket();
+    // Discard everything collected so far, the next packet is fresh
+    void DrainIQ();
     void StreamThread();
     void UpdateView();
-    void RecordIQCapture(const IQSweep &sweep, IQCapture &capture, Device *device);
+    void RecordIQCapture(const IQSweep &sweep);
 
     Session *sessionPtr; // Copy, does not own
-    //CircularBuffer circularBuffer;
+
+    SPSCRing<IQCapture> iqRing;
+    std::thread collectHandle;
+    std::atomic<bool> collecting;
+    bool holdingPacket; // Consumer has a ring slot checked out
+    // iqRing.Dropped() as of the last DrainIQ()
+    std::atomic<qint64> dropBaseline;
+    static const int MIN_IQ_RING_PACKETS = 16;
+    static const int MAX_IQ_RING_PACKETS = 256;
+    // Refreshes the overflow count in the status bar while shown
+    QTimer statsTimer;
 
     QToolBar *recordToolBar;
     MdiArea *demodArea;
@@ -146,6 +153,7 @@ private slots:
 
     void changeRecordDirectory();
     void recordLengthChanged();
+    void updateOverflowStats();
 
 signals:
     void updateViews();
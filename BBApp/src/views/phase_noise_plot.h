@@ -37,7 +37,7 @@ private:
                      grat_sz.x(), grat_sz.y()).contains(p);
     }
 
-    GLVector traces[TRACE_COUNT]; // Normalized traces
+    std::vector<GLVector> traces; // Normalized traces, one per trace
     GLuint traceBufferObject;
     GLVector normalizedTrace;
 
@@ -0,0 +1,212 @@
+#include "software_renderer.h"
+#include "model/persistence.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Fewer pixels than this render on the calling thread only
+const int MIN_PIXELS_PER_BAND = 64 * 1024;
+
+static inline float clampUnit(float f)
+{
+    return (f < 0.0f) ? 0.0f : ((f > 1.0f) ? 1.0f : f);
+}
+
+SoftwareRenderer::SoftwareRenderer() :
+    threadCount(0),
+    job(nullptr),
+    jobRows(0),
+    jobBands(0),
+    jobGeneration(0),
+    jobPending(0),
+    stopWorkers(false)
+{
+    BuildColorMaps();
+}
+
+SoftwareRenderer::~SoftwareRenderer()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopWorkers = true;
+    }
+    jobStart.notify_all();
+    for(std::thread &w : workers) {
+        w.join();
+    }
+}
+
+void SoftwareRenderer::SetThreadCount(int threads)
+{
+    threadCount = bb_lib::max2(threads, 0);
+}
+
+// Persistence uses the ramp of persist_fs, the spectrogram samples the
+//   waterfall texture down its height
+void SoftwareRenderer::BuildColorMaps()
+{
+    persistColors.resize(256 * 4);
+    for(int i = 0; i < 256; i++) {
+        float L = i / 255.0f;
+        float R = clampUnit((L - 0.5f) * 4.0f);
+        float MG = clampUnit(4.0f * L - 3.0f);
+        float G = clampUnit(4.0f * L) - MG;
+        float B = clampUnit((0.5f - L) * 4.0f);
+        unsigned char *c = &persistColors[i * 4];
+        c[0] = (unsigned char)(R * 255.0f + 0.5f);
+        c[1] = (unsigned char)(G * 255.0f + 0.5f);
+        c[2] = (unsigned char)(B * 255.0f + 0.5f);
+        c[3] = 255;
+    }
+
+    spectrogramColors.assign(256 * 4, 255);
+    QImage ramp(":/color_spectrogram.png");
+    if(ramp.isNull()) return;
+    for(int i = 0; i < 256; i++) {
+        QRgb px = ramp.pixel(ramp.width() / 2, i * (ramp.height() - 1) / 255);
+        // The waterfall texture is uploaded with red and blue swapped,
+        //   see get_texture_from_file(), match what is on screen
+        unsigned char *c = &spectrogramColors[i * 4];
+        c[0] = qBlue(px);
+        c[1] = qGreen(px);
+        c[2] = qRed(px);
+    }
+}
+
+void SoftwareRenderer::StartWorkers(int n)
+{
+    while((int)workers.size() < n) {
+        workers.push_back(std::thread(&SoftwareRenderer::WorkerLoop, this,
+                                      (int)workers.size() + 1));
+    }
+}
+
+void SoftwareRenderer::WorkerLoop(int index)
+{
+    int seen = 0;
+    std::unique_lock<std::mutex> lock(jobMutex);
+    while(true) {
+        jobStart.wait(lock, [&]{ return stopWorkers || jobGeneration != seen; });
+        if(stopWorkers) return;
+        seen = jobGeneration;
+        if(index >= jobBands) continue;
+
+        const std::function<void(int, int)> &fn = *job;
+        int first = jobRows * index / jobBands;
+        int last = jobRows * (index + 1) / jobBands;
+        lock.unlock();
+        fn(first, last);
+        lock.lock();
+
+        if(--jobPending == 0) {
+            jobDone.notify_one();
+        }
+    }
+}
+
+void SoftwareRenderer::RunBands(int rows, int columns, const std::function<void(int, int)> &fn)
+{
+    int bands = threadCount;
+    if(bands <= 0) {
+        bands = bb_lib::max2((int)std::thread::hardware_concurrency(), 1);
+    }
+    bands = bb_lib::min2(bands, bb_lib::max2((rows * columns) / MIN_PIXELS_PER_BAND, 1));
+    bands = bb_lib::min2(bands, bb_lib::max2(rows, 1));
+
+    if(bands <= 1) {
+        fn(0, rows);
+        return;
+    }
+
+    StartWorkers(bands - 1);
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        job = &fn;
+        jobRows = rows;
+        jobBands = bands;
+        jobPending = bands - 1;
+        jobGeneration++;
+    }
+    jobStart.notify_all();
+
+    fn(0, rows / bands);
+
+    std::unique_lock<std::mutex> lock(jobMutex);
+    jobDone.wait(lock, [&]{ return jobPending == 0; });
+    job = nullptr;
+}
+
+void SoftwareRenderer::RenderPersistence(Persistence *persistence, QImage &image)
+{
+    if(image.isNull()) return;
+    if(image.format() != QImage::Format_RGBA8888) {
+        image = QImage(image.size(), QImage::Format_RGBA8888);
+    }
+
+    const int w = image.width(), h = image.height();
+    const int mapW = persistence->Width(), mapH = persistence->Height();
+    const float *map = persistence->GetImage();
+    if(!map || mapW <= 0) {
+        image.fill(Qt::transparent);
+        return;
+    }
+
+    columnMap.resize(w);
+    for(int x = 0; x < w; x++) {
+        columnMap[x] = (int)((qint64)x * mapW / w);
+    }
+
+    // Detach once here, scanLine() is not safe across threads
+    unsigned char *bits = image.bits();
+    const int stride = image.bytesPerLine();
+
+    // Map rows are bottom first, image rows top first
+    RunBands(h, w, [&](int first, int last) {
+        for(int y = first; y < last; y++) {
+            const float *src = map + ((qint64)(h - 1 - y) * mapH / h) * mapW * 4;
+            unsigned char *dst = bits + (qint64)y * stride;
+            for(int x = 0; x < w; x++) {
+                const float *cell = src + columnMap[x] * 4;
+                if(cell[3] <= 0.0f) {
+                    memset(dst + x * 4, 0, 4);
+                    continue;
+                }
+                int L = (int)(bb_lib::min2(cell[0], 1.0f) * 255.0f);
+                memcpy(dst + x * 4, &persistColors[L * 4], 4);
+            }
+        }
+    });
+}
+
+void SoftwareRenderer::RenderIntensity(const float *values, int columns, int rows, QImage &image)
+{
+    if(image.isNull()) return;
+    if(image.format() != QImage::Format_RGBA8888) {
+        image = QImage(image.size(), QImage::Format_RGBA8888);
+    }
+
+    const int w = image.width(), h = image.height();
+    if(!values || columns <= 0 || rows <= 0) {
+        image.fill(Qt::transparent);
+        return;
+    }
+
+    columnMap.resize(w);
+    for(int x = 0; x < w; x++) {
+        columnMap[x] = (int)((qint64)x * columns / w);
+    }
+
+    unsigned char *bits = image.bits();
+    const int stride = image.bytesPerLine();
+
+    RunBands(h, w, [&](int first, int last) {
+        for(int y = first; y < last; y++) {
+            const float *src = values + ((qint64)y * rows / h) * columns;
+            unsigned char *dst = bits + (qint64)y * stride;
+            for(int x = 0; x < w; x++) {
+                int L = (int)(clampUnit(src[columnMap[x]]) * 255.0f);
+                memcpy(dst + x * 4, &spectrogramColors[L * 4], 4);
+            }
+        }
+    });
+}
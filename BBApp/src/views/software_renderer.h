@@ -0,0 +1,71 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <QImage>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "lib/macros.h"
+#include "lib/bb_lib.h"
+
+class Persistence;
+
+/*
+ * Draws persistence and spectrogram images into a QImage without
+ *   OpenGL, for spectrogram exports and for machines without
+ *   framebuffer objects
+ * Images are split into bands of rows colored on a pool of threads
+ *   started on first use and kept until destruction, so drawing a
+ *   frame does not create threads
+ * Output images are Format_RGBA8888, the byte order OpenGL expects
+ */
+class SoftwareRenderer {
+public:
+    SoftwareRenderer();
+    ~SoftwareRenderer();
+
+    // Bands rendered at once, 0 for one per hardware thread
+    void SetThreadCount(int threads);
+
+    // Persistence map scaled to image, colored like the persistence
+    //   shader, cells never hit are transparent
+    void RenderPersistence(Persistence *persistence, QImage &image);
+    // Rows of intensities in [0,1], top row first, scaled to image
+    //   and colored like the spectrogram
+    void RenderIntensity(const float *values, int columns, int rows, QImage &image);
+
+private:
+    // fn(first, last) over rows [0, rows) split across the threads
+    void RunBands(int rows, int columns, const std::function<void(int, int)> &fn);
+    // Grow the pool to at least n threads
+    void StartWorkers(int n);
+    // Body of pool thread index, runs band index of each job
+    void WorkerLoop(int index);
+    void BuildColorMaps();
+
+    int threadCount;
+    // Source column for each image column
+    std::vector<int> columnMap;
+    // RGBA bytes indexed by intensity in [0,255]
+    std::vector<unsigned char> persistColors;
+    std::vector<unsigned char> spectrogramColors;
+
+    // Band pool, the calling thread runs band 0, pool thread i band i
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::condition_variable jobStart, jobDone;
+    const std::function<void(int, int)> *job;
+    int jobRows, jobBands;
+    // Bumped for each job, pending counts bands not yet finished
+    int jobGeneration, jobPending;
+    bool stopWorkers;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SoftwareRenderer)
+};
+
+#endif // SOFTWARE_RENDERER_H
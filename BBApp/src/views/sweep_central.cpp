@@ -21,6 +21,7 @@ SweepCentral::SweepCentral(Session *sPtr,
     : CentralWidget(parent, f),
       session_ptr(sPtr),
       trace(true),
+      viewVisible(false),
       programClosing(false)
 {
     trace_view = new TraceView(session_ptr, this);
@@ -57,13 +58,6 @@ SweepCentral::SweepCentral(Session *sPtr,
     sweepOnlyActions.push_back(toolBar->addWidget(persistence_clear));
     connect(persistence_clear, SIGNAL(clicked()), trace_view, SLOT(clearPersistence()));
 
-    if(!trace_view->HasOpenGL3()) {
-        persistence_check->setEnabled(false);
-        persistence_check->setToolTip(tr("Persistence requires OpenGL version 3.0 or greater"));
-        persistence_clear->setEnabled(false);
-        persistence_clear->setToolTip(tr("Persistence requires OpenGL version 3.0 or greater"));
-    }
-
     realTimePersistenceCheck = new QCheckBox("Persistence");
     realTimePersistenceCheck->setObjectName("SH_CheckBox");
     realTimePersistenceCheck->setFixedSize(120, 25);
@@ -84,7 +78,17 @@ SweepCentral::SweepCentral(Session *sPtr,
     intensitySlider->setSliderPosition(25);
     realTimeActions.push_back(toolBar->addWidget(intensitySlider));
     connect(intensitySlider, SIGNAL(valueChanged(int)),
-            trace_view, SLOT(intensityChanged(int)));
+            this, SLOT(intensityChanged(int)));
+
+    realTimeActions.push_back(toolBar->addWidget(new FixedSpacer(QSize(10, TOOLBAR_H))));
+    colormapCombo = new ComboBox(toolBar);
+    colormapCombo->setFixedSize(120, 25);
+    QStringList colormapList;
+    colormapList << tr("Spectrum") << tr("Gray") << tr("Hot");
+    colormapCombo->insertItems(0, colormapList);
+    realTimeActions.push_back(toolBar->addWidget(colormapCombo));
+    connect(colormapCombo, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(colormapChanged(int)));
 
     if(!trace_view->CanDrawRealTimePersistence()) {
         realTimePersistenceCheck->setEnabled(false);
@@ -93,6 +97,7 @@ SweepCentral::SweepCentral(Session *sPtr,
         intensitySlider->setEnabled(false);
         intensitySlider->setToolTip("Real-time persistence is not supported by your "
                                     "graphics card.");
+        colormapCombo->setEnabled(false);
     }
 
     for(QAction *a : realTimeActions) {
@@ -109,6 +114,8 @@ SweepCentral::SweepCentral(Session *sPtr,
     sweeping = true;
     sweep_count = -1;
     reconfigure = false;
+    configGeneration = 0;
+    mirrorGeneration = -1;
 
     connect(session_ptr->sweep_settings, SIGNAL(updated(const SweepSettings*)),
             this, SLOT(settingsChanged(const SweepSettings*)));
@@ -117,6 +124,9 @@ SweepCentral::SweepCentral(Session *sPtr,
     connect(playback, SIGNAL(startPlaying(bool)),
             this, SLOT(playFromFile(bool)));
 
+    statsTimer.setInterval(500);
+    connect(&statsTimer, SIGNAL(timeout()), this, SLOT(updatePipelineStats()));
+
     //StartStreaming();
     setFocusPolicy(Qt::StrongFocus);
 }
@@ -199,8 +209,36 @@ void SweepCentral::wheelEvent(QWheelEvent *we)
     trace_view->update();
 }
 
+void SweepCentral::showEvent(QShowEvent *)
+{
+    viewVisible = true;
+    statsTimer.start();
+}
+
+void SweepCentral::hideEvent(QHideEvent *)
+{
+    viewVisible = false;
+    statsTimer.stop();
+    MainWindow::GetStatusBar()->SetPipelineStats("");
+}
+
+// Sweeps waiting on the processing thread, and those it fell too far
+//   behind to keep
+void SweepCentral::updatePipelineStats()
+{
+    QString str = QString("Queue %1/%2, peak %3")
+            .arg(SweepQueueDepth())
+            .arg(tracePool.Capacity())
+            .arg(PeakSweepQueueDepth());
+    if(DroppedSweeps() > 0) {
+        str += QString(", %1 dropped").arg(DroppedSweeps());
+    }
+    MainWindow::GetStatusBar()->SetPipelineStats(str);
+}
+
 // Try new settings
 // If new settings fail, revert to old settings
+// Called from the acquisition thread only
 void SweepCentral::Reconfigure()
 {
     if(!session_ptr->device->Reconfigure(session_ptr->sweep_settings, &trace)) {
@@ -213,14 +251,67 @@ void SweepCentral::Reconfigure()
         rtFrame.SetDimensions(session_ptr->device->RealTimeFrameSize());
     }
 
+    // Sweeps queued under the old configuration are discarded
+    tracePool.Flush();
+    configGeneration++;
+
     if(sweep_count == 0) {
         sweep_count = 1;
     }
     reconfigure = false;
 }
 
-// Main sweep loop
+// Processing stage
+// Pulls finished sweeps from the pool and updates the traces/views
+//   while the acquisition thread is already fetching the next sweep
 void SweepCentral::SweepThread()
+{
+    tracePool.ResetCounters();
+    session_ptr->device->SetAutoRecover(true);
+    acquire_handle = std::thread(&SweepCentral::AcquisitionThread, this);
+
+    while(sweeping) {
+        SweepPacket *packet = tracePool.PopReady(10);
+        if(!packet) {
+            continue;
+        }
+
+        if(packet->generation != configGeneration) {
+            tracePool.Release(packet);
+            continue;
+        }
+
+        Trace *t = &packet->trace;
+        if(t->UpdateStart() != 0 || t->UpdateStop() != t->Length()) {
+            MergePartialSweep(*t, packet->generation);
+            t = &partialMirror;
+        }
+        if(t->IsFullSweep()) {
+            playback->PutTrace(t);
+        }
+
+        session_ptr->trace_manager->UpdateTraces(t);
+        // Nobody sees the persistence image while hidden, the
+        //   trace itself is still updated
+        if(t->GetSettings()->IsRealTime() && viewVisible) {
+            rtColorizer.Colorize(packet->frame);
+            session_ptr->trace_manager->realTimeFrame = packet->frame;
+        }
+
+        tracePool.Release(packet);
+
+        emit updateView();
+    }
+
+    if(acquire_handle.joinable()) {
+        acquire_handle.join();
+    }
+    session_ptr->device->SetAutoRecover(false);
+}
+
+// Acquisition stage
+// Fetches into free pool buffers, never waits on trace processing
+void SweepCentral::AcquisitionThread()
 {
     Reconfigure();
 
@@ -231,36 +322,45 @@ void SweepCentral::SweepThread()
         }
 
         if(sweep_count) {
-//            if(!session_ptr->device->GetSweep(session_ptr->sweep_settings, &trace)) {
-//                sweeping = false;
-//                return;
-//            }
+            SweepPacket *packet = tracePool.AcquireFree();
+            Trace &t = packet->trace;
+
+            // Bring the buffer up to date with the current configuration
+            //   only allocates when the sweep size changed
+            if(packet->generation != configGeneration) {
+                t.SetSettings(last_config);
+                t.SetSize(trace.Length());
+                t.SetFreq(trace.BinSize(), trace.StartFreq());
+                t.SetUpdateRange(0, trace.Length());
+                if(last_config.Mode() == MODE_REAL_TIME) {
+                    packet->frame.SetDimensions(rtFrame.dim);
+                }
+                packet->generation = configGeneration;
+            }
 
             bool sweepSuccess;
             if(last_config.Mode() == MODE_REAL_TIME) {
-                sweepSuccess = session_ptr->device->GetRealTimeFrame(trace, rtFrame);
+                sweepSuccess = session_ptr->device->GetRealTimeFrame(t, packet->frame);
             } else {
-                sweepSuccess = session_ptr->device->GetSweep(&last_config, &trace);
+                sweepSuccess = session_ptr->device->GetSweep(&last_config, &t);
             }
 
             if(!sweepSuccess) {
+                tracePool.ReturnFree(packet);
+                // Reopen and replay the configuration, the sweep layout
+                //   is unchanged so the pool buffers remain valid
+                if(session_ptr->device->ConnectionLost() &&
+                        session_ptr->device->Recover(sweeping)) {
+                    continue;
+                }
                 sweeping = false;
                 return;
             }
 
-            if(trace.IsFullSweep()) {
-                playback->PutTrace(&trace);
-            }
-
-            session_ptr->trace_manager->UpdateTraces(&trace);
-            if(last_config.IsRealTime()) {
-                session_ptr->trace_manager->realTimeFrame = rtFrame;
-            }
-
-            emit updateView();
+            tracePool.PushReady(packet);
 
             // Non-negative sweep count means we only collect 'n' more sweeps
-            if(sweep_count > 0 && trace.IsFullSweep()) {
+            if(sweep_count > 0 && t.IsFullSweep()) {
                 sweep_count--;
             }
 
@@ -277,6 +377,28 @@ void SweepCentral::SweepThread()
     session_ptr->device->Abort();
 }
 
+// Pool buffers rotate, so bins outside a partial update hold data
+//   from an older sweep. Keep a mirror of the latest value of every
+//   bin, copy only the update range into it and process the mirror.
+// Bins outside the range were offset and path loss corrected when
+//   they were new, TraceManager only corrects the update range
+void SweepCentral::MergePartialSweep(const Trace &t, int generation)
+{
+    int start = t.UpdateStart(), stop = t.UpdateStop();
+
+    if(generation != mirrorGeneration) {
+        partialMirror.SetSettings(*t.GetSettings());
+        partialMirror.Copy(t);
+        mirrorGeneration = generation;
+    } else {
+        simdCopy_32f(t.Min() + start, partialMirror.Min() + start, stop - start);
+        simdCopy_32f(t.Max() + start, partialMirror.Max() + start, stop - start);
+    }
+
+    partialMirror.SetUpdateRange(start, stop);
+    partialMirror.SetTime(t.Time());
+}
+
 /*
  * Save current settings and title to temporaries
  * When finally complete, restore them
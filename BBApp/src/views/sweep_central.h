@@ -4,8 +4,12 @@
 #include <thread>
 #include <atomic>
 
+#include <QTimer>
+
 #include "views/central_stack.h"
 #include "../model/session.h"
+#include "../model/trace_pool.h"
+#include "../model/realtime_colorizer.h"
 #include "../widgets/entry_widgets.h"
 
 class QToolBar;
@@ -30,6 +34,10 @@ public:
     void GetViewImage(QImage &image);
     Frequency GetCurrentCenterFreq() const {
         return session_ptr->sweep_settings->Center(); }
+    // Acquisition -> processing pipeline statistics
+    int SweepQueueDepth() const { return tracePool.QueueDepth(); }
+    int PeakSweepQueueDepth() const { return tracePool.PeakQueueDepth(); }
+    qint64 DroppedSweeps() const { return tracePool.Dropped(); }
     // Force view back to initial start-up values
     // No persistence, waterfall, etc.
 
@@ -37,18 +45,37 @@ protected:
     void resizeEvent(QResizeEvent*);
     void keyPressEvent(QKeyEvent*);
     void wheelEvent(QWheelEvent*);
+    void showEvent(QShowEvent*);
+    void hideEvent(QHideEvent*);
 
 private:
     void Reconfigure();
+    // Processing stage, owns the acquisition thread
     void SweepThread();
+    // Acquisition stage, only this thread talks to the device
+    void AcquisitionThread();
+    // Fold a partial (SA fast sweep) update into partialMirror, on
+    //   the processing thread, the mirror is processed in its place
+    void MergePartialSweep(const Trace &t, int generation);
     void PlaybackThread();
 
     bool reconfigure;
-    Trace trace;
+    Trace trace; // Configuration template and playback buffer
+    Trace partialMirror; // Last known value of every bin
+    int mirrorGeneration; // Configuration the mirror was built for
     RealTimeFrame rtFrame;
     SweepSettings last_config; // Last known working settings
 
+    TracePool tracePool;
+    std::atomic<int> configGeneration;
+    // Real-time frames are colorized on the processing thread, and
+    //   only while they can be seen
+    RealTimeColorizer rtColorizer;
+    std::atomic<bool> viewVisible;
+
     TraceView *trace_view;
+    // Refreshes the pipeline statistics in the status bar while shown
+    QTimer statsTimer;
 
     ComboBox *waterfall_combo;
     // Line persistence
@@ -57,6 +84,7 @@ private:
     // Real-time persistence
     QCheckBox *realTimePersistenceCheck;
     QSlider *intensitySlider;
+    ComboBox *colormapCombo;
     QList<QAction*> sweepOnlyActions, realTimeActions;
 
     PlaybackToolBar *playback;
@@ -65,6 +93,7 @@ private:
     Session *session_ptr;
 
     std::thread thread_handle;
+    std::thread acquire_handle;
     bool programClosing;
     std::atomic<bool> sweeping;
     std::atomic<int> sweep_count;
@@ -84,7 +113,10 @@ private slots:
     void continuousSweepPressed();
     // Update the view behind the scenes
     void forceUpdateView();
+    void updatePipelineStats();
     void playFromFile(bool play);
+    void intensityChanged(int intensity) { rtColorizer.SetIntensity(intensity); }
+    void colormapChanged(int map) { rtColorizer.SetColormap((RealTimeColormap)map); }
 };
 
 #endif // SWEEP_CENTRAL_H
@@ -192,10 +192,13 @@ void TGPlot::DrawTraces()
     glBlendEquation(GL_FUNC_ADD);
     glLineWidth(GetSession()->prefs.trace_width);
 
-    manager->Lock();
+    // Draw and solve markers from one copy of the traces, the
+    //   update thread keeps running while we paint
+    manager->RefreshSnapshot();
+    traces.resize(manager->TraceCount());
 
     // Loop through each trace
-    for(int i = 0; i < TRACE_COUNT; i++) {
+    for(int i = 0; i < manager->TraceCount(); i++) {
         // If Trace is active, normalize and draw it
         const Trace *trace = manager->GetTrace(i);
 
@@ -206,8 +209,6 @@ void TGPlot::DrawTraces()
         }
     }
 
-    manager->Unlock();
-
     // Disable nice lines
     glLineWidth(1.0);
     glDisable(GL_BLEND);
@@ -36,7 +36,7 @@ private:
     QTime time; // Used for sweep time display
     GLuint traceVBO;
     GLFont textFont, divFont;
-    GLVector traces[TRACE_COUNT];
+    std::vector<GLVector> traces;
     double tgStepSize;
 
 private:
@@ -70,12 +70,13 @@ TraceView::TraceView(Session *session, QWidget *parent)
       persist_on(false),
       clear_persistence(false),
       waterfall_state(WaterfallOFF),
+      waterfall_uploaded(0),
+      waterfall_generation(-1),
       textFont(12),
       divFont(12),
       hasOpenGL3(false),
       canDrawRealTimePersistence(false),
-      realTimePersistOn(true),
-      realTimeIntensity(25)
+      realTimePersistOn(true)
 {
     setAutoBufferSwap(false);
     setMouseTracking(true);
@@ -124,6 +125,7 @@ TraceView::TraceView(Session *session, QWidget *parent)
 
     glGenBuffers(1, &traceVBO);
     glGenBuffers(1, &textureVBO);
+    glGenBuffers(1, &waterfallVBO);
     glGenBuffers(1, &gratVBO);
     glGenBuffers(1, &borderVBO);
 
@@ -145,18 +147,18 @@ TraceView::TraceView(Session *session, QWidget *parent)
     }
 
     // See if we can draw real-time persistence images
-    if(hasOpenGLFeature(QOpenGLFunctions::Shaders)
-            && hasOpenGLFeature(QOpenGLFunctions::NPOTTextures)) {
-        realTimeShader = std::unique_ptr<GLProgram>(
-                    new GLProgram(dot_persist_temp_vs, dot_persist_temp_fs));
-        realTimeShader->Compile(this);
-        realTimeScalar = glGetUniformLocation(realTimeShader->ProgramHandle(), "scale");
+    // Frames arrive colorized, only a non power of two texture is needed
+    if(hasOpenGLFeature(QOpenGLFunctions::NPOTTextures)) {
         canDrawRealTimePersistence = true;
     }
 
     waterfall_tex = get_texture_from_file(":/color_spectrogram.png");
 
     glGenTextures(1, &realTimeTexture);
+    glGenTextures(1, &soft_persist_tex);
+    // Power of two, the texture is scaled over the graticule
+    int persistRes = GetSession()->prefs.persistResolution;
+    soft_persist_image = QImage(persistRes, persistRes, QImage::Format_RGBA8888);
 
     doneCurrent();
 
@@ -174,16 +176,17 @@ TraceView::~TraceView()
     makeCurrent();
     glDeleteBuffers(1, &traceVBO);
     glDeleteBuffers(1, &textureVBO);
+    glDeleteBuffers(1, &waterfallVBO);
     glDeleteBuffers(1, &gratVBO);
     glDeleteBuffers(1, &borderVBO);
 
     glDeleteTextures(1, &waterfall_tex);
     glDeleteTextures(1, &realTimeTexture);
+    glDeleteTextures(1, &soft_persist_tex);
 
     doneCurrent();
 
     delete swap_thread;
-    ClearWaterfall();
 
     Sleep(100); // Odd crashes on closing too quick? Still exist?
 }
@@ -428,6 +431,7 @@ void TraceView::Paint()
         RenderMarkers();
         RenderChannelPower();
         RenderOccupiedBandwidth();
+        RenderPeakTable();
     }
 
     glPushAttrib(GL_ALL_ATTRIB_BITS);
@@ -529,6 +533,14 @@ void TraceView::RenderGratText(QPainter &p)
 
     p.setFont(textFont.Font());
     str.sprintf("%d pts in %d ms", tm->GetTrace(0)->Length(), elapsed.toInt());
+    if(tm->SkippedSnapshots() > 0) {
+        // Sweeps that arrived faster than we could draw them
+        str += QString(", %1 not drawn").arg(tm->SkippedSnapshots());
+    }
+    if((persist_on || waterfall_state != WaterfallOFF) && tm->trace_buffer.Dropped() > 0) {
+        // Sweeps lost from the persistence/waterfall feed
+        str += QString(", %1 not accumulated").arg(tm->trace_buffer.Dropped());
+    }
     DrawString(p, str, grat_ll.x()+grat_sz.x()-5,
                grat_ll.y()-textHeight*2, RIGHT_ALIGNED);
     DrawString(p, "Center " + s->Center().GetFreqString(),
@@ -622,17 +634,34 @@ void TraceView::RenderTraces()
 {
     TraceManager *manager = GetSession()->trace_manager;
 
+    if(clear_persistence && !HasOpenGL3()) {
+        soft_persist.Clear();
+        clear_persistence = false;
+    }
+
     // Un-buffer persist/waterfall data
     if(persist_on || (waterfall_state != WaterfallOFF)) {
         GLVector *v_ptr = nullptr;
-        while(v_ptr = manager->trace_buffer.Back()) {
+        while((v_ptr = manager->trace_buffer.ReadSlot())) {
             if(persist_on) {
-                AddToPersistence(*v_ptr);
+                if(HasOpenGL3()) {
+                    AddToPersistence(*v_ptr);
+                } else {
+                    int persistRes = GetSession()->prefs.persistResolution;
+                    soft_persist.SetResolution(persistRes, persistRes);
+                    soft_persist.Accumulate(*v_ptr);
+                }
             }
             if(waterfall_state != WaterfallOFF) {
                 AddToWaterfall(*v_ptr);
             }
-            manager->trace_buffer.IncrementBack();
+            manager->trace_buffer.CommitRead();
+        }
+    } else {
+        // Keep the feed empty so the drop count only reflects a
+        //   view falling behind
+        while(manager->trace_buffer.ReadSlot()) {
+            manager->trace_buffer.CommitRead();
         }
     }
 
@@ -643,6 +672,9 @@ void TraceView::RenderTraces()
     } else if(persist_on && HasOpenGL3()) {
         DrawPersistence();
         return;
+    } else if(persist_on) {
+        DrawSoftwarePersistence();
+        return;
     }
 
     // Prep viewport
@@ -668,31 +700,41 @@ void TraceView::RenderTraces()
     glBlendEquation(GL_FUNC_ADD);
     glLineWidth(GetSession()->prefs.trace_width);
 
-    manager->Lock();
+    // Draw and solve markers from one copy of the traces, the
+    //   update thread keeps running while we paint
+    manager->RefreshSnapshot();
+    traces.resize(manager->TraceCount());
 
     // Loop through each trace
-    for(int i = 0; i < TRACE_COUNT; i++) {
+    for(int i = 0; i < manager->TraceCount(); i++) {
         // If Trace is active, normalize and draw it
         const Trace *trace = manager->GetTrace(i);
 
         if(trace->Active()) {
-            normalize_trace(trace, traces[i], grat_sz);
+            normalize_trace(trace, traces[i], grat_sz, tracePlans[i]);
             DrawTrace(trace, traces[i]);
         }
     }
 
-    manager->Unlock();
-
     if(manager->GetLimitLine()->Active()) {
         const SweepSettings *ss = GetSession()->sweep_settings;
         normalize_trace(&manager->GetLimitLine()->store,
                         traces[0],
                         grat_sz,
                         ss->RefLevel(),
-                        ss->Div());
+                        ss->Div(),
+                        limitPlan);
         DrawLimitLines(&manager->GetLimitLine()->store, traces[0]);
     }
 
+    // Occupancy spans the graticule, 0% at the bottom to 100% at the top
+    const Trace *occupancy = manager->GetOccupancyTrace();
+    if(occupancy->Active()) {
+        normalize_trace(occupancy, traces[0], grat_sz, Amplitude(100.0, MV), 10.0,
+                        occupancyPlan);
+        DrawTrace(occupancy, traces[0]);
+    }
+
     // Disable nice lines
     glLineWidth(1.0);
     glDisable(GL_BLEND);
@@ -929,19 +971,20 @@ void TraceView::RenderChannelPower()
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    for(int i = 0; i < 3; i++) {
+    int ref = cp->ReferenceChannel();
+    for(int i = 0; i < cp->ChannelCount(); i++) {
         if(!cp->IsChannelInView(i)) continue;
 
         double x1 = (cp->GetChannelStart(i) - start) / span,
                 x2 = (cp->GetChannelStop(i) - start) / span;
         double xCen = (x1 + x2) / 2.0;
 
-        if(i != 1) { // Push channel text out 100 px?
+        if(i == ref - 1 || i == ref + 1) { // Push channel text out 100 px?
             int realCenter = grat_sz.x() / 2;
             // Get largest possible width with extra space
             int textWidth = textFont.GetTextWidth(" -12.345 dBm");
             if(abs(xCen*grat_sz.x() - realCenter) < textWidth) {
-                xCen = double(realCenter + (i-1)*textWidth) / grat_sz.x();
+                xCen = double(realCenter + (i-ref)*textWidth) / grat_sz.x();
             }
         }
 
@@ -965,8 +1008,8 @@ void TraceView::RenderChannelPower()
                         CENTER_ALIGNED, textFont.Font(), GetSession()->colors.text);
 
         // Draw adjacent channel power text
-        if(i == 0 || i == 2) {
-            cp_string.sprintf("%.2f %s", cp->GetChannelPower(i) - cp->GetChannelPower(1),
+        if(i != ref) {
+            cp_string.sprintf("%.2f %s", cp->GetRelativePower(i),
                               (printUnits == MV) ? "mV" : "dBc");
 //            DrawString(cp_string, textFont, xCen * grat_sz.x(),
 //                       textFont.GetTextHeight()*2 + 2, CENTER_ALIGNED);
@@ -1032,6 +1075,71 @@ void TraceView::RenderOccupiedBandwidth()
     glPopAttrib();
 }
 
+// Numbered ticks along the top of the graticule and a table of the
+//   peaks in the upper right, largest first
+void TraceView::RenderPeakTable()
+{
+    const TraceManager *tm = GetSession()->trace_manager;
+    if(!tm->IsPeakTableEnabled()) return;
+
+    const std::vector<PeakTableEntry> &peaks = tm->GetPeakTable();
+    if(peaks.empty()) return;
+
+    double start = GetSession()->sweep_settings->Start();
+    double span = GetSession()->sweep_settings->Stop() - start;
+    if(span == 0.0) return;
+
+    bool linear = (GetSession()->sweep_settings->RefLevel().Units() == MV);
+    int textHeight = textFont.GetTextHeight();
+    int tableWidth = textFont.GetTextWidth("00  0000.000000 MHz  -000.00 dBm") + 10;
+
+    glPushAttrib(GL_VIEWPORT_BIT);
+    glViewport(grat_ll.x(), grat_ll.y(), grat_sz.x(), grat_sz.y());
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, grat_sz.x(), 0, grat_sz.y(), -1, 1);
+
+    DrawBackdrop(QPoint(grat_sz.x() - tableWidth, grat_sz.y() - textHeight * peaks.size() - 4),
+                 QPoint(tableWidth, textHeight * peaks.size() + 4));
+
+    glQColor(GetSession()->colors.markerBorder);
+    for(size_t i = 0; i < peaks.size(); i++) {
+        double x = (peaks[i].freq - start) / span * grat_sz.x();
+        if(x < 0.0 || x > grat_sz.x()) continue;
+
+        glBegin(GL_TRIANGLES);
+        glVertex2f(x, grat_sz.y() - 10);
+        glVertex2f(x - 4, grat_sz.y());
+        glVertex2f(x + 4, grat_sz.y());
+        glEnd();
+
+        AddTextToRender(QString::number(i + 1),
+                        QPoint(x + grat_ll.x(), grat_sz.y() - 10 - textHeight + grat_ll.y()),
+                        CENTER_ALIGNED, textFont.Font(), GetSession()->colors.markerBorder);
+    }
+
+    for(size_t i = 0; i < peaks.size(); i++) {
+        Amplitude amp(peaks[i].amp, linear ? MV : DBM);
+        QString str = QString("%1  %2  %3").arg(i + 1)
+                .arg(Frequency(peaks[i].freq).GetFreqString())
+                .arg(amp.GetString());
+        AddTextToRender(str,
+                        QPoint(grat_ll.x() + grat_sz.x() - 5,
+                               grat_ll.y() + grat_sz.y() - textHeight * (i + 1)),
+                        RIGHT_ALIGNED, textFont.Font(), GetSession()->colors.text);
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+}
+
 void TraceView::DrawPersistence()
 {
     // Draw a single quad over our grat
@@ -1063,6 +1171,56 @@ void TraceView::DrawPersistence()
     glUseProgram(0);
 }
 
+void TraceView::DrawSoftwarePersistence()
+{
+    int persistRes = GetSession()->prefs.persistResolution;
+    if(soft_persist_image.width() != persistRes || soft_persist_image.height() != persistRes) {
+        soft_persist_image = QImage(persistRes, persistRes, QImage::Format_RGBA8888);
+    }
+    soft_render.RenderPersistence(&soft_persist, soft_persist_image);
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, soft_persist_tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGBA,
+                 soft_persist_image.width(),
+                 soft_persist_image.height(),
+                 0,
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 soft_persist_image.constBits());
+
+    glColor4f(1.0, 1.0, 1.0, 1.0);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glTranslatef(grat_ll.x(), grat_ll.y(), 0.0);
+    glScalef(grat_sz.x(), grat_sz.y(), 1.0);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Image rows are top first
+    glBegin(GL_QUADS);
+    glTexCoord2f(0,1); glVertex2f(0,0);
+    glTexCoord2f(0,0); glVertex2f(0,1);
+    glTexCoord2f(1,0); glVertex2f(1,1);
+    glTexCoord2f(1,1); glVertex2f(1,0);
+    glEnd();
+
+    glDisable(GL_BLEND);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    glPopMatrix();
+}
+
 void TraceView::DrawRealTimeFrame()
 {
     RealTimeFrame &frame = GetSession()->trace_manager->realTimeFrame;
@@ -1088,8 +1246,8 @@ void TraceView::DrawRealTimeFrame()
                  &frame.rgbFrame[0]);
 
     // Draw a single quad over our grat
-    glUseProgram(realTimeShader->ProgramHandle());
-    glUniform1f(realTimeScalar, 100.0 / (100 - realTimeIntensity));
+    glColor4f(1.0, 1.0, 1.0, 1.0);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
     glMatrixMode(GL_MODELVIEW);
     glPushMatrix();
@@ -1248,78 +1406,47 @@ void TraceView::AddToPersistence(const GLVector &v)
 
 void TraceView::AddToWaterfall(const GLVector &v)
 {
-    bool degenHack = false; // prevents degenerate polygons
-    float x, z;
+    if(v.size() <= 0) return;
 
+    waterfall.SetDepth(GetSession()->prefs.waterfallDepth);
     // Gonna have to remove 'n' falls based on the actual
     //      view height / pixPerFall
-    if(v.size() <= 0) return;
-
-    // Remove all buffers past max size
-    while (waterfall_verts.size() >= MAX_WATERFALL_LINES) {
-        delete waterfall_verts.back();
-        waterfall_verts.pop_back();
-        delete waterfall_coords.back();
-        waterfall_coords.pop_back();
-    }
-
-    if(v.size() * 0.25 > grat_sz.x() * 0.5) degenHack = true;
-
-    waterfall_verts.insert(waterfall_verts.begin(), new GLVector);
-    waterfall_coords.insert(waterfall_coords.begin(), new GLVector);
-
-    waterfall_verts[0]->reserve((v.size() * 3) >> 1); // Re-look at these values
-    waterfall_coords[0]->reserve(v.size() * 2);
-
-    // Center samples, if/else on degen hack, to draw poly's greater than 1 pixel wide
-    for(unsigned i = 0; i < v.size(); i += 4) {
-
-        if(degenHack) {
-            // Get max for three points, one on each side of sample in question
-            x = v[i];
-            z = bb_lib::max3(v[bb_lib::max2(1, (int)i-1)], // Sample to left
-                    v[i+1], v[bb_lib::min2(i+3, (unsigned)v.size()-3)]);
-        } else {
-            // x & z for every sample
-            x = v[i];
-            z = v[i+1];
-        }
-
-        // Best place to clamp. This clamps the tex coord and pos
-        // Must clamp height in waterfall because we don't have
-        //   the luxury of clipping with a viewport.
-        bb_lib::clamp(z, 0.0f, 1.0f);
-
-        // Max Point
-        waterfall_verts[0]->push_back(x);
-        waterfall_verts[0]->push_back(0.0);
-        waterfall_verts[0]->push_back(z);
-
-        // Min Point
-        waterfall_verts[0]->push_back(x);
-        waterfall_verts[0]->push_back(0.0);
-        waterfall_verts[0]->push_back(0.0);
-
-        // Set Tex Coords
-        waterfall_coords[0]->push_back(x);
-        waterfall_coords[0]->push_back(z);
-
-        waterfall_coords[0]->push_back(x);
-        waterfall_coords[0]->push_back(0.0);
-    }
+    waterfall.Add(v, v.size() * 0.25 > grat_sz.x() * 0.5);
 }
 
-void TraceView::ClearWaterfall()
+// A full upload after a clear or once every slot has been rewritten,
+//   otherwise only the new lines
+void TraceView::UploadWaterfall()
 {
-    while(!waterfall_verts.empty()) {
-        delete waterfall_verts.back();
-        waterfall_verts.pop_back();
+    const int slotVerts = waterfall.SlotVerts();
+    const int slotCoords = waterfall.SlotCoords();
+    qint64 fresh = waterfall.Written() - waterfall_uploaded;
+
+    if(waterfall.Generation() != waterfall_generation || fresh >= waterfall.Depth()) {
+        glBindBuffer(GL_ARRAY_BUFFER, waterfallVBO);
+        glBufferData(GL_ARRAY_BUFFER, waterfall.Depth() * slotVerts * sizeof(float),
+                     waterfall.Verts(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, textureVBO);
+        glBufferData(GL_ARRAY_BUFFER, waterfall.Depth() * slotCoords * sizeof(float),
+                     waterfall.Coords(), GL_DYNAMIC_DRAW);
+    } else {
+        for(int age = (int)fresh - 1; age >= 0; age--) {
+            int slot = waterfall.Slot(age);
+            int points = waterfall.LinePoints(slot);
+            glBindBuffer(GL_ARRAY_BUFFER, waterfallVBO);
+            glBufferSubData(GL_ARRAY_BUFFER, slot * slotVerts * sizeof(float),
+                            points * 6 * sizeof(float),
+                            waterfall.Verts() + slot * slotVerts);
+            glBindBuffer(GL_ARRAY_BUFFER, textureVBO);
+            glBufferSubData(GL_ARRAY_BUFFER, slot * slotCoords * sizeof(float),
+                            points * 4 * sizeof(float),
+                            waterfall.Coords() + slot * slotCoords);
+        }
     }
 
-    while(!waterfall_coords.empty()) {
-        delete waterfall_coords.back();
-        waterfall_coords.pop_back();
-    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    waterfall_uploaded = waterfall.Written();
+    waterfall_generation = waterfall.Generation();
 }
 
 /*
@@ -1396,50 +1523,46 @@ void TraceView::DrawWaterfall()
     // Step 2 :
     // Data Buffering and drawing
     //
-    for(unsigned i = 0; i < waterfall_verts.size(); i++) { // Loop through all traces
-        std::vector<float> &r = *waterfall_verts[i]; // The trace
-        std::vector<float> &t = *waterfall_coords[i]; // Trace tex coords
+    UploadWaterfall();
 
-        // Buffer the data, each 2D and 3D handle setting pointers
-        glBindBuffer(GL_ARRAY_BUFFER, textureVBO);
-        glBufferData(GL_ARRAY_BUFFER, t.size() * sizeof(float),
-                     &t[0], GL_DYNAMIC_DRAW);
-
-        glBindBuffer(GL_ARRAY_BUFFER, traceVBO);
-        glBufferData(GL_ARRAY_BUFFER, r.size() * sizeof(float),
-                     &r[0], GL_DYNAMIC_DRAW);
+    for(int age = 0; age < waterfall.Count(); age++) { // Newest first
+        int slot = waterfall.Slot(age);
+        int points = waterfall.LinePoints(slot);
+        // Byte offsets of the line in the VBOs
+        GLvoid *r = (GLvoid*)(slot * waterfall.SlotVerts() * sizeof(float));
+        GLvoid *t = (GLvoid*)(slot * waterfall.SlotCoords() * sizeof(float));
 
         if(waterfall_state == Waterfall2D) {
             // Reset glPointers, draw line across top of trace, then shift
             glLineWidth(2.0);
             glBindBuffer(GL_ARRAY_BUFFER, textureVBO);
-            glTexCoordPointer(2, GL_FLOAT, 16, (GLvoid*)0);
-            glBindBuffer(GL_ARRAY_BUFFER, traceVBO);
-            glVertexPointer(3, GL_FLOAT, 24, (GLvoid*)0);
-            glDrawArrays(GL_LINE_STRIP, 0, r.size() / 6);
+            glTexCoordPointer(2, GL_FLOAT, 16, t);
+            glBindBuffer(GL_ARRAY_BUFFER, waterfallVBO);
+            glVertexPointer(3, GL_FLOAT, 24, r);
+            glDrawArrays(GL_LINE_STRIP, 0, points);
             glTranslatef(0.0, 2.0, 0.0);
             glLineWidth(1.0);
 
         } else if (waterfall_state == Waterfall3D) {
             // Main draw and pointers
             glBindBuffer(GL_ARRAY_BUFFER, textureVBO);
-            glTexCoordPointer(2, GL_FLOAT, 0, (GLvoid*)0);
-            glBindBuffer(GL_ARRAY_BUFFER, traceVBO);
-            glVertexPointer(3, GL_FLOAT, 0, (GLvoid*)0);
-            glDrawArrays(GL_QUAD_STRIP, 0, r.size() / 3);
+            glTexCoordPointer(2, GL_FLOAT, 0, t);
+            glBindBuffer(GL_ARRAY_BUFFER, waterfallVBO);
+            glVertexPointer(3, GL_FLOAT, 0, r);
+            glDrawArrays(GL_QUAD_STRIP, 0, points * 2);
 
             // Draw the waterfall outline
             glDisable(GL_TEXTURE_2D);
             glColor3f(0.0, 0.0, 0.0);
-            glBindBuffer(GL_ARRAY_BUFFER, traceVBO);
-            glVertexPointer(3, GL_FLOAT, 24, (GLvoid*)0);
-            glDrawArrays(GL_LINE_STRIP, 0, r.size() / 6);
+            glVertexPointer(3, GL_FLOAT, 24, r);
+            glDrawArrays(GL_LINE_STRIP, 0, points);
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
             glEnable(GL_TEXTURE_2D);
 
             glTranslatef(0, 0.05f, 0);
         }
     }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     // Step 3 :
     // Clean up/Revert GL state
@@ -13,9 +13,9 @@
 
 #include "lib/bb_lib.h"
 #include "gl_sub_view.h"
-
-//#define MAX_WATERFALL_LINES 128
-#define MAX_WATERFALL_LINES 256
+#include "software_renderer.h"
+#include "waterfall_ring.h"
+#include "model/persistence.h"
 
 class Session;
 class SwapThread;
@@ -58,15 +58,19 @@ protected:
     void DrawDeltaMarker(int x, int y, int num);
     void RenderChannelPower();
     void RenderOccupiedBandwidth();
+    void RenderPeakTable();
     void DrawOCBWMarker(int x, int y, bool left);
     void DrawPersistence();
+    // Without framebuffer objects, see soft_persist
+    void DrawSoftwarePersistence();
     void DrawRealTimeFrame();
     void DrawLimitLines(const Trace *limitTrace, const GLVector &v);
     void DrawBackdrop(QPoint pos, QPoint size);
 
     void AddToPersistence(const GLVector &v);
     void AddToWaterfall(const GLVector &v);
-    void ClearWaterfall();
+    // Copy the waterfall lines added since the last frame to the VBOs
+    void UploadWaterfall();
     void DrawWaterfall();
 
 private:
@@ -91,8 +95,11 @@ private:
     std::mutex drawMutex;
     semaphore paintCondition;
 
-    GLVector traces[TRACE_COUNT]; // Normalized traces
-    GLuint traceVBO, textureVBO;
+    std::vector<GLVector> traces; // Normalized traces, one per trace
+    // Bin to pixel mappings, kept while the sweep and view are unchanged
+    DecimationPlan tracePlans[MAX_TRACE_COUNT];
+    DecimationPlan limitPlan, occupancyPlan;
+    GLuint traceVBO, textureVBO, waterfallVBO;
 
     QString plotTitle;
     GLFont textFont, divFont;
@@ -102,19 +109,24 @@ private:
     bool canDrawRealTimePersistence;
     bool clear_persistence; // When true, clears buffer next frame update
     std::unique_ptr<GLProgram> persist_program; // Shaders for persistence
-    std::unique_ptr<GLProgram> realTimeShader; // Shader for real-time
     GLuint persist_fbo; // Frame-Buffer-Object for persistent
     GLuint persist_depth; // FBO depth buffer
     GLuint persist_tex; // Offscreen persist buffer
-    GLuint realTimeTexture, realTimeScalar;
+    GLuint realTimeTexture; // Colorized before it reaches the view
+    // Line persistence drawn on the CPU when there is no OpenGL 3
+    Persistence soft_persist;
+    SoftwareRenderer soft_render;
+    QImage soft_persist_image;
+    GLuint soft_persist_tex;
 
     WaterfallState waterfall_state;
     GLuint waterfall_tex; // Waterfall spectrum texture
-    std::vector<GLVector*> waterfall_verts;
-    std::vector<GLVector*> waterfall_coords;
+    // Mirrored in waterfallVBO (vertices) and textureVBO (tex coords)
+    WaterfallRing waterfall;
+    qint64 waterfall_uploaded; // waterfall.Written() at the last upload
+    int waterfall_generation;
 
     bool realTimePersistOn;
-    int realTimeIntensity;
 
 public slots:
     void enablePersistence(int enable) { persist_on = (enable == Qt::Checked); }
@@ -127,9 +139,6 @@ public slots:
     void enableRealTimePersist(int enable) {
         realTimePersistOn = (enable == Qt::Checked);
     }
-    void intensityChanged(int intensity) {
-        realTimeIntensity = intensity;
-    }
 };
 
 /*
@@ -0,0 +1,83 @@
+#include "waterfall_ring.h"
+
+WaterfallRing::WaterfallRing() :
+    depth(WATERFALL_DEFAULT_DEPTH),
+    slotPoints(0),
+    head(0),
+    count(0),
+    written(0),
+    generation(0)
+{
+
+}
+
+void WaterfallRing::SetDepth(int lines)
+{
+    bb_lib::clamp(lines, WATERFALL_MIN_DEPTH, WATERFALL_MAX_DEPTH);
+    if(lines == depth) return;
+
+    depth = lines;
+    Allocate(slotPoints);
+}
+
+void WaterfallRing::Clear()
+{
+    head = 0;
+    count = 0;
+    generation++;
+}
+
+void WaterfallRing::Allocate(int points)
+{
+    slotPoints = points;
+    verts.resize(depth * SlotVerts());
+    coords.resize(depth * SlotCoords());
+    linePoints.assign(depth, 0);
+    Clear();
+}
+
+void WaterfallRing::Add(const GLVector &v, bool degenHack)
+{
+    int points = (int)v.size() / 4;
+    if(points <= 0) return;
+
+    if(points > slotPoints) {
+        Allocate(points);
+    }
+
+    float *r = &verts[head * SlotVerts()];
+    float *t = &coords[head * SlotCoords()];
+    const int last = (int)v.size() - 3;
+    float x, z;
+
+    // Center samples, if/else on degen hack, to draw poly's greater than 1 pixel wide
+    for(int i = 0; i < points * 4; i += 4) {
+        x = v[i];
+        if(degenHack) {
+            // Get max for three points, one on each side of sample in question
+            z = bb_lib::max3(v[bb_lib::max2(1, i - 1)], // Sample to left
+                    v[i+1], v[bb_lib::min2(i + 3, last)]);
+        } else {
+            z = v[i+1];
+        }
+
+        // Best place to clamp. This clamps the tex coord and pos
+        // Must clamp height in waterfall because we don't have
+        //   the luxury of clipping with a viewport.
+        bb_lib::clamp(z, 0.0f, 1.0f);
+
+        // Max Point
+        *r++ = x; *r++ = 0.0f; *r++ = z;
+        // Min Point
+        *r++ = x; *r++ = 0.0f; *r++ = 0.0f;
+
+        // Set Tex Coords
+        *t++ = x; *t++ = z;
+        *t++ = x; *t++ = 0.0f;
+    }
+
+    linePoints[head] = points;
+    if(++head >= depth) head = 0;
+    if(count < depth) count++;
+    written++;
+}
@@ -0,0 +1,81 @@
+#ifndef WATERFALL_RING_H
+#define WATERFALL_RING_H
+
+#include "lib/macros.h"
+#include "lib/bb_lib.h"
+
+// Lines of waterfall history, see Preferences::waterfallDepth
+const int WATERFALL_DEFAULT_DEPTH = 256;
+const int WATERFALL_MIN_DEPTH = 16;
+const int WATERFALL_MAX_DEPTH = 4096;
+
+/*
+ * Fixed memory waterfall history for the TraceView
+ * Every line is a slot of one preallocated slab, a new line is written
+ *   over the oldest slot at the head, no allocation after the slab
+ *   is sized
+ * A slot holds SlotPoints() points, each a max vertex (x, 0, z) then a
+ *   min vertex (x, 0, 0), with texture coordinates (x, z) and (x, 0)
+ */
+class WaterfallRing {
+public:
+    WaterfallRing();
+    ~WaterfallRing() {}
+
+    // Lines kept, clamped to [WATERFALL_MIN_DEPTH, WATERFALL_MAX_DEPTH]
+    // Clears the history on change
+    void SetDepth(int lines);
+    int Depth() const { return depth; }
+    void Clear();
+
+    // Build a line from a trace normalized to the graticule, see
+    //   normalize_trace()
+    // If degenHack, each point takes the max of its neighbors so
+    //   lines narrower than a pixel are not lost
+    // A line wider than the slots regrows the slab and clears it
+    void Add(const GLVector &v, bool degenHack);
+
+    // Lines held, at most Depth()
+    int Count() const { return count; }
+    // Slot of the line age lines old, age 0 is the newest
+    int Slot(int age) const {
+        int s = head - 1 - age;
+        return (s < 0) ? s + depth : s;
+    }
+    // Points in the line at slot
+    int LinePoints(int slot) const { return linePoints[slot]; }
+
+    int SlotPoints() const { return slotPoints; }
+    // Floats per slot
+    int SlotVerts() const { return slotPoints * 6; }
+    int SlotCoords() const { return slotPoints * 4; }
+    // The whole slab, Depth() slots
+    const float* Verts() const { return verts.empty() ? nullptr : &verts[0]; }
+    const float* Coords() const { return coords.empty() ? nullptr : &coords[0]; }
+
+    // Lines added since construction, with Generation() tells a
+    //   consumer which slots changed since it last looked
+    qint64 Written() const { return written; }
+    // Incremented when the slab is cleared or resized, every slot
+    //   must then be read again
+    int Generation() const { return generation; }
+
+private:
+    void Allocate(int points);
+
+    int depth;
+    int slotPoints;
+    int head; // Next slot written
+    int count;
+    qint64 written;
+    int generation;
+
+    std::vector<float> verts;
+    std::vector<float> coords;
+    std::vector<int> linePoints;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(WaterfallRing)
+};
+
+#endif // WATERFALL_RING_H
@@ -453,6 +453,11 @@ ComboEntry::ComboEntry(const QString &label_text, QWidget *parent)
     connect(combo_box, SIGNAL(activated(int)), this, SIGNAL(comboIndexChanged(int)));
 }
 
+int ComboEntry::GetComboIndex() const
+{
+    return combo_box->currentIndex();
+}
+
 void ComboEntry::setComboIndex(int ix)
 {
     combo_box->setCurrentIndex(ix);
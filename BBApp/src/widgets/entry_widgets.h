@@ -386,6 +386,8 @@ public:
     ComboEntry(const QString &label_text, QWidget *parent = 0);
     ~ComboEntry() {}
 
+    int GetComboIndex() const;
+
 protected:
     void resizeEvent(QResizeEvent *);
 
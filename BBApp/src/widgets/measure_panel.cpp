@@ -16,30 +16,66 @@ MeasurePanel::MeasurePanel(const QString &title,
     DockPage *offset_page = new DockPage("Offsets");
     channel_power_page = new DockPage("Channel Power");
     occupied_bandwidth_page = new DockPage("Occupied Bandwidth");
+    peak_table_page = new DockPage("Peak Table");
+    occupancy_page = new DockPage("Occupancy");
+    spectrogram_page = new DockPage("Spectrogram");
 
     QStringList string_list;
 
     trace_select = new ComboEntry("Trace");
     trace_type = new ComboEntry("Type");
     trace_avg_count = new NumericEntry("Avg Count", 10, "");
+    trace_avg_mode = new ComboEntry("Avg Mode");
+    trace_percentile = new NumericEntry("Percentile", 90.0, "%");
+    trace_math_op = new ComboEntry("Math");
+    trace_math_a = new ComboEntry("Operand A");
+    trace_math_b = new ComboEntry("Operand B");
+    trace_math_domain = new ComboEntry("Math Domain");
+    trace_math_offset = new NumericEntry("Math Offset", 0.0, "dB");
     trace_color = new ColorEntry("Color");
     //trace_active = new CheckBoxEntry("Active");
     trace_updating = new CheckBoxEntry("Update");
     export_clear = new DualButtonEntry("Export", "Clear");
 
-    string_list << "One" << "Two" << "Three" << "Four" << "Five" << "Six";
+    for(int i = 0; i < trace_manager_ptr->TraceCount(); i++) {
+        string_list << TraceManager::TraceName(i);
+    }
     trace_select->setComboText(string_list);
+    trace_math_a->setComboText(string_list);
+    trace_math_b->setComboText(string_list);
     string_list.clear();
 
     // Must match TraceType enum list
     string_list << "Off" << "Clear & Write" << "Max Hold" << "Min Hold" <<
-                   "Min/Max Hold" << "Average";
+                   "Min/Max Hold" << "Average" << "Mean/Std Dev" << "Percentile" << "Math";
     trace_type->setComboText(string_list);
     string_list.clear();
 
+    // Must match AverageMode enum list
+    string_list << "Log" << "Power (RMS)";
+    trace_avg_mode->setComboText(string_list);
+    string_list.clear();
+
+    // Must match TraceMathOp enum list
+    string_list << "A - B" << "A + B" << "Normalize" << "Offset";
+    trace_math_op->setComboText(string_list);
+    string_list.clear();
+
+    // Must match TraceMathDomain enum list
+    string_list << "Log" << "Power";
+    trace_math_domain->setComboText(string_list);
+    string_list.clear();
+
     trace_page->AddWidget(trace_select);
     trace_page->AddWidget(trace_type);
     trace_page->AddWidget(trace_avg_count);
+    trace_page->AddWidget(trace_avg_mode);
+    trace_page->AddWidget(trace_percentile);
+    trace_page->AddWidget(trace_math_op);
+    trace_page->AddWidget(trace_math_a);
+    trace_page->AddWidget(trace_math_b);
+    trace_page->AddWidget(trace_math_domain);
+    trace_page->AddWidget(trace_math_offset);
     trace_page->AddWidget(trace_color);
     trace_page->AddWidget(trace_updating);
     trace_page->AddWidget(export_clear);
@@ -52,6 +88,15 @@ MeasurePanel::MeasurePanel(const QString &title,
             trace_manager_ptr, SLOT(setType(int)));
     connect(trace_avg_count, SIGNAL(valueChanged(double)),
             trace_manager_ptr, SLOT(setAvgCount(double)));
+    connect(trace_avg_mode, SIGNAL(comboIndexChanged(int)),
+            trace_manager_ptr, SLOT(setAvgMode(int)));
+    connect(trace_percentile, SIGNAL(valueChanged(double)),
+            trace_manager_ptr, SLOT(setPercentile(double)));
+    connect(trace_math_op, SIGNAL(comboIndexChanged(int)), SLOT(traceMathUpdated()));
+    connect(trace_math_a, SIGNAL(comboIndexChanged(int)), SLOT(traceMathUpdated()));
+    connect(trace_math_b, SIGNAL(comboIndexChanged(int)), SLOT(traceMathUpdated()));
+    connect(trace_math_domain, SIGNAL(comboIndexChanged(int)), SLOT(traceMathUpdated()));
+    connect(trace_math_offset, SIGNAL(valueChanged(double)), SLOT(traceMathUpdated()));
     connect(trace_color, SIGNAL(colorChanged(QColor&)),
             trace_manager_ptr, SLOT(setColor(QColor&)));
     connect(trace_updating, SIGNAL(clicked(bool)),
@@ -75,8 +120,9 @@ MeasurePanel::MeasurePanel(const QString &title,
     string_list << "One" << "Two" << "Three" << "Four" << "Five" << "Six";
     marker_select->setComboText(string_list);
     string_list.clear();
-    string_list << "Trace One" << "Trace Two" << "Trace Three"
-                << "Trace Four" << "Trace Five" << "Trace Six";
+    for(int i = 0; i < trace_manager_ptr->TraceCount(); i++) {
+        string_list << "Trace " + TraceManager::TraceName(i);
+    }
     on_trace_select->setComboText(string_list);
     string_list.clear();
 
@@ -128,10 +174,12 @@ MeasurePanel::MeasurePanel(const QString &title,
     channel_width = new FrequencyEntry("Width",
                                        20.0e6);
     channel_spacing = new FrequencyEntry("Spacing", 20.0e6);
+    channel_adjacent = new NumericEntry("Adjacent", 1.0, "");
     channel_power_enabled = new CheckBoxEntry("Enabled");
 
     channel_power_page->AddWidget(channel_width);
     channel_power_page->AddWidget(channel_spacing);
+    channel_power_page->AddWidget(channel_adjacent);
     channel_power_page->AddWidget(channel_power_enabled);
 
     AppendPage(channel_power_page);
@@ -140,6 +188,8 @@ MeasurePanel::MeasurePanel(const QString &title,
             this, SLOT(channelPowerUpdated()));
     connect(channel_spacing, SIGNAL(freqViewChanged(Frequency)),
             this, SLOT(channelPowerUpdated()));
+    connect(channel_adjacent, SIGNAL(valueChanged(double)),
+            this, SLOT(channelPowerUpdated()));
     connect(channel_power_enabled, SIGNAL(clicked(bool)),
             this, SLOT(channelPowerUpdated()));
 
@@ -155,6 +205,67 @@ MeasurePanel::MeasurePanel(const QString &title,
     connect(ocbw_enabled, SIGNAL(clicked(bool)), SLOT(occupiedBandwidthUpdated()));
     connect(percentPower, SIGNAL(valueChanged(double)), SLOT(occupiedBandwidthUpdated()));
 
+    peak_table_enabled = new CheckBoxEntry("Enabled");
+    peak_table_count = new NumericEntry("Peaks", 10.0, "");
+    peak_excursion = new NumericEntry("Excursion", 6.0, "dB");
+    peak_threshold = new NumericEntry("Threshold", -100.0, "dBm");
+
+    peak_table_page->AddWidget(peak_table_enabled);
+    peak_table_page->AddWidget(peak_table_count);
+    peak_table_page->AddWidget(peak_excursion);
+    peak_table_page->AddWidget(peak_threshold);
+
+    AppendPage(peak_table_page);
+
+    connect(peak_table_enabled, SIGNAL(clicked(bool)), SLOT(peakTableUpdated()));
+    connect(peak_table_count, SIGNAL(valueChanged(double)), SLOT(peakTableUpdated()));
+    connect(peak_excursion, SIGNAL(valueChanged(double)), SLOT(peakTableUpdated()));
+    connect(peak_threshold, SIGNAL(valueChanged(double)), SLOT(peakTableUpdated()));
+
+    occupancy_enabled = new CheckBoxEntry("Enabled");
+    occupancy_mode = new ComboEntry("Threshold");
+    occupancy_threshold = new NumericEntry("Level", -80.0, "dBm");
+    occupancy_margin = new NumericEntry("Above Noise", 10.0, "dB");
+    occupancy_export_reset = new DualButtonEntry("Export", "Reset");
+
+    // Must match OccupancyThreshold enum list
+    string_list << "Absolute" << "Above Noise";
+    occupancy_mode->setComboText(string_list);
+    string_list.clear();
+
+    occupancy_page->AddWidget(occupancy_enabled);
+    occupancy_page->AddWidget(occupancy_mode);
+    occupancy_page->AddWidget(occupancy_threshold);
+    occupancy_page->AddWidget(occupancy_margin);
+    occupancy_page->AddWidget(occupancy_export_reset);
+
+    AppendPage(occupancy_page);
+
+    connect(occupancy_enabled, SIGNAL(clicked(bool)), SLOT(occupancyUpdated()));
+    connect(occupancy_mode, SIGNAL(comboIndexChanged(int)), SLOT(occupancyUpdated()));
+    connect(occupancy_threshold, SIGNAL(valueChanged(double)), SLOT(occupancyUpdated()));
+    connect(occupancy_margin, SIGNAL(valueChanged(double)), SLOT(occupancyUpdated()));
+    connect(occupancy_export_reset, SIGNAL(leftPressed()),
+            trace_manager_ptr, SLOT(exportOccupancy()));
+    connect(occupancy_export_reset, SIGNAL(rightPressed()),
+            trace_manager_ptr, SLOT(resetOccupancy()));
+
+    spectrogram_record = new CheckBoxEntry("Record");
+    spectrogram_export = new DualButtonEntry("Export Image", "Export CSV");
+
+    spectrogram_page->AddWidget(spectrogram_record);
+    spectrogram_page->AddWidget(spectrogram_export);
+
+    AppendPage(spectrogram_page);
+
+    connect(spectrogram_record, SIGNAL(clicked(bool)), SLOT(spectrogramRecordUpdated()));
+    connect(trace_manager_ptr, SIGNAL(spectrogramStopped(const QString&)),
+            SLOT(spectrogramRecordStopped(const QString&)));
+    connect(spectrogram_export, SIGNAL(leftPressed()),
+            trace_manager_ptr, SLOT(exportSpectrogramImage()));
+    connect(spectrogram_export, SIGNAL(rightPressed()),
+            trace_manager_ptr, SLOT(exportSpectrogramCSV()));
+
     // Done connected DockPages to TraceManager
     updateTraceView(0);
     updateMarkerView(0);
@@ -184,6 +295,22 @@ void MeasurePanel::updateTraceView()
     trace_type->setComboIndex(type);
     //trace_avg_count->setEnabled(type == AVERAGE);
     trace_avg_count->SetValue(t->GetAvgCount());
+    trace_avg_mode->setComboIndex(t->GetAvgMode());
+    trace_percentile->SetValue(t->GetPercentile());
+
+    // Signals held until every field is set, one per field would apply
+    //   a half updated expression
+    QWidget *math_widgets[] = { trace_math_op, trace_math_a, trace_math_b,
+                                trace_math_domain, trace_math_offset };
+    for(QWidget *w : math_widgets) w->blockSignals(true);
+    TraceMathExpr expr = t->GetMath();
+    trace_math_op->setComboIndex(expr.op);
+    trace_math_a->setComboIndex(expr.a);
+    trace_math_b->setComboIndex(expr.b);
+    trace_math_domain->setComboIndex(expr.domain);
+    trace_math_offset->SetValue(expr.constant);
+    for(QWidget *w : math_widgets) w->blockSignals(false);
+
     trace_color->SetColor(t->Color());
     trace_updating->SetChecked(t->IsUpdating());
 
@@ -235,6 +362,9 @@ void MeasurePanel::setMode(OperationalMode mode)
 
     channel_power_page->SetPageEnabled(pagesEnabled);
     occupied_bandwidth_page->SetPageEnabled(pagesEnabled);
+    peak_table_page->SetPageEnabled(pagesEnabled);
+    occupancy_page->SetPageEnabled(pagesEnabled);
+    spectrogram_page->SetPageEnabled(pagesEnabled);
 }
 
 void MeasurePanel::channelPowerUpdated()
@@ -245,9 +375,16 @@ void MeasurePanel::channelPowerUpdated()
                              "Detector = Average\n"
                              "Video Units = Power");
     }
+    int adjacent = (int)channel_adjacent->GetValue();
+    if(adjacent < 0 || adjacent > ChannelPower::MAX_ADJACENT) {
+        bb_lib::clamp(adjacent, 0, ChannelPower::MAX_ADJACENT);
+        channel_adjacent->SetValue(adjacent);
+    }
+
     trace_manager_ptr->SetChannelPower(channel_power_enabled->IsChecked(),
                                        channel_width->GetFrequency(),
-                                       channel_spacing->GetFrequency());
+                                       channel_spacing->GetFrequency(),
+                                       adjacent);
 }
 
 void MeasurePanel::occupiedBandwidthUpdated()
@@ -266,6 +403,57 @@ void MeasurePanel::occupiedBandwidthUpdated()
                                             percentPower->GetValue());
 }
 
+void MeasurePanel::peakTableUpdated()
+{
+    int count = (int)peak_table_count->GetValue();
+    if(count < 1 || count > PeakTable::MAX_PEAKS) {
+        bb_lib::clamp(count, 1, PeakTable::MAX_PEAKS);
+        peak_table_count->SetValue(count);
+    }
+    if(peak_excursion->GetValue() < 0.0) peak_excursion->SetValue(0.0);
+
+    trace_manager_ptr->SetPeakTable(peak_table_enabled->IsChecked(),
+                                    count,
+                                    peak_excursion->GetValue(),
+                                    peak_threshold->GetValue());
+}
+
+void MeasurePanel::traceMathUpdated()
+{
+    TraceMathExpr expr;
+    expr.op = (TraceMathOp)trace_math_op->GetComboIndex();
+    expr.a = trace_math_a->GetComboIndex();
+    expr.b = trace_math_b->GetComboIndex();
+    expr.domain = (TraceMathDomain)trace_math_domain->GetComboIndex();
+    expr.constant = trace_math_offset->GetValue();
+
+    trace_manager_ptr->SetTraceMath(expr);
+}
+
+void MeasurePanel::occupancyUpdated()
+{
+    if(occupancy_margin->GetValue() < 0.0) occupancy_margin->SetValue(0.0);
+
+    trace_manager_ptr->SetOccupancy(occupancy_enabled->IsChecked(),
+                                    (OccupancyThreshold)occupancy_mode->GetComboIndex(),
+                                    occupancy_threshold->GetValue(),
+                                    occupancy_margin->GetValue());
+}
+
+// Unchecked again if the file dialog is cancelled
+void MeasurePanel::spectrogramRecordUpdated()
+{
+    bool recording = trace_manager_ptr->SetSpectrogramRecording(spectrogram_record->IsChecked());
+    spectrogram_record->SetChecked(recording);
+}
+
+void MeasurePanel::spectrogramRecordStopped(const QString &reason)
+{
+    spectrogram_record->SetChecked(false);
+    QMessageBox::warning(this, tr("Recording Stopped"),
+                         tr("Spectrogram recording stopped\n") + reason);
+}
+
 void MeasurePanel::setMarkerFrequencyChanged(Frequency f)
 {
     if(f.Val() < 0.0) {
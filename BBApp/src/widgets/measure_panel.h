@@ -21,11 +21,21 @@ public:
 private:
     DockPage *channel_power_page;
     DockPage *occupied_bandwidth_page;
+    DockPage *peak_table_page;
+    DockPage *occupancy_page;
+    DockPage *spectrogram_page;
 
     // Trace Widgets
     ComboEntry *trace_select;
     ComboEntry *trace_type;
     NumericEntry *trace_avg_count;
+    ComboEntry *trace_avg_mode;
+    NumericEntry *trace_percentile;
+    ComboEntry *trace_math_op;
+    ComboEntry *trace_math_a;
+    ComboEntry *trace_math_b;
+    ComboEntry *trace_math_domain;
+    NumericEntry *trace_math_offset;
     ColorEntry *trace_color;
     CheckBoxEntry *trace_updating;
     DualButtonEntry *export_clear;
@@ -46,12 +56,30 @@ private:
     // Channel Power
     FrequencyEntry *channel_width;
     FrequencyEntry *channel_spacing;
+    NumericEntry *channel_adjacent;
     CheckBoxEntry *channel_power_enabled;
 
     // Occupied Bandwidth
     CheckBoxEntry *ocbw_enabled;
     NumericEntry *percentPower;
 
+    // Peak Table
+    CheckBoxEntry *peak_table_enabled;
+    NumericEntry *peak_table_count;
+    NumericEntry *peak_excursion;
+    NumericEntry *peak_threshold;
+
+    // Occupancy
+    CheckBoxEntry *occupancy_enabled;
+    ComboEntry *occupancy_mode;
+    NumericEntry *occupancy_threshold;
+    NumericEntry *occupancy_margin;
+    DualButtonEntry *occupancy_export_reset;
+
+    // Spectrogram recording
+    CheckBoxEntry *spectrogram_record;
+    DualButtonEntry *spectrogram_export;
+
     // Copy of the pointer, does not own
     TraceManager *trace_manager_ptr;
     const SweepSettings *settings_ptr;
@@ -66,6 +94,11 @@ public slots:
 private slots:
     void channelPowerUpdated();
     void occupiedBandwidthUpdated();
+    void peakTableUpdated();
+    void traceMathUpdated();
+    void occupancyUpdated();
+    void spectrogramRecordUpdated();
+    void spectrogramRecordStopped(const QString &reason);
 
     void setMarkerFrequencyChanged(Frequency);
 
@@ -76,10 +76,19 @@ PreferenceColorPanel::PreferenceColorPanel(const QString &panelTitle,
     graticuleWidth->setToolTip(tr("Set the drawing width of the graticule lines."));
     graticuleStipple = new CheckBoxEntry(tr("Graticule Dotted"));
     graticuleStipple->setToolTip(tr("Set whether the graticule is drawn with dotted lines."));
+    waterfallDepth = new NumericEntry(tr("Waterfall Lines"), 0.0, "");
+    waterfallDepth->setToolTip(tr("Number of sweeps kept in the waterfall, 16 to 4096. "
+                                  "Deeper histories use more memory"));
+    persistResolution = new NumericEntry(tr("Persistence Resolution"), 0.0, "");
+    persistResolution->setToolTip(tr("Width and height of the persistence image on graphics "
+                                     "cards without framebuffer objects, 16 to 2048, "
+                                     "rounded up to a power of two"));
 
     dockPage->AddWidget(traceWidth);
     dockPage->AddWidget(graticuleWidth);
     dockPage->AddWidget(graticuleStipple);
+    dockPage->AddWidget(waterfallDepth);
+    dockPage->AddWidget(persistResolution);
 
     AddPage(dockPage);
 
@@ -111,9 +120,13 @@ PreferenceColorPanel::PreferenceColorPanel(const QString &panelTitle,
     realTimeSweepTime = new NumericEntry(tr("Real-Time Frame Rate"), 0.0, tr("fps"));
     realTimeSweepTime->setToolTip(tr("Change the real-time update rate. "
                                      "15-30 fps is suggested"));
+    fastAmpConversion = new CheckBoxEntry(tr("Fast dB Conversion"));
+    fastAmpConversion->setToolTip(tr("Approximate trace conversions between dB and linear units. "
+                                     "Within 0.0001 dB of exact, uses less CPU"));
 
     dockPage->AddWidget(sweepDelay);
     dockPage->AddWidget(realTimeSweepTime);
+    dockPage->AddWidget(fastAmpConversion);
 
     AddPage(dockPage);
 
@@ -147,6 +160,8 @@ void PreferenceColorPanel::Populate(const Session *session)
     traceWidth->SetValue(session->prefs.trace_width);
     graticuleWidth->SetValue(session->prefs.graticule_width);
     graticuleStipple->SetChecked(session->prefs.graticule_stipple);
+    waterfallDepth->SetValue(session->prefs.waterfallDepth);
+    persistResolution->SetValue(session->prefs.persistResolution);
 
     const ColorPrefs &colors = session->colors;
 
@@ -160,6 +175,7 @@ void PreferenceColorPanel::Populate(const Session *session)
 
     sweepDelay->SetValue(session->prefs.sweepDelay);
     realTimeSweepTime->SetValue(session->prefs.realTimeFrameRate);
+    fastAmpConversion->SetChecked(session->prefs.fastAmplitudeConversion);
 
     playbackDelay->SetValue(session->prefs.playbackDelay);
     maxSaveFileSize->SetValue(session->prefs.playbackMaxFileSize);
@@ -181,6 +197,19 @@ void PreferenceColorPanel::Apply(Session *session)
 
     session->prefs.graticule_stipple = graticuleStipple->IsChecked();
 
+    int wDepth = waterfallDepth->GetValue();
+    bb_lib::clamp(wDepth, WATERFALL_MIN_DEPTH, WATERFALL_MAX_DEPTH);
+    session->prefs.waterfallDepth = wDepth;
+    waterfallDepth->SetValue(wDepth);
+
+    // Power of two, the image is uploaded as a texture
+    int pRes = persistResolution->GetValue();
+    bb_lib::clamp(pRes, PERSIST_MIN_DIM, PERSIST_MAX_DIM);
+    int pRes2 = PERSIST_MIN_DIM;
+    while(pRes2 < pRes) pRes2 <<= 1;
+    session->prefs.persistResolution = pRes2;
+    persistResolution->SetValue(pRes2);
+
     ColorPrefs &colors = session->colors;
 
     colors.background = background->GetColor();
@@ -203,6 +232,10 @@ void PreferenceColorPanel::Apply(Session *session)
     session->prefs.realTimeFrameRate = rtAccum;
     realTimeSweepTime->SetValue(rtAccum);
 
+    session->prefs.fastAmplitudeConversion = fastAmpConversion->IsChecked();
+    SetAmpConvertMode(session->prefs.fastAmplitudeConversion ?
+                          AmpConvertFast : AmpConvertExact);
+
     double pbDelay = playbackDelay->GetValue();
     if(pbDelay < 16.0) pbDelay = 16.0;
     if(pbDelay > 2048.0) pbDelay = 2048.0;
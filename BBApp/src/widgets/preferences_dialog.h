@@ -64,6 +64,8 @@ private:
     // View Page
     NumericEntry *traceWidth, *graticuleWidth;
     CheckBoxEntry *graticuleStipple;
+    NumericEntry *waterfallDepth;
+    NumericEntry *persistResolution;
     // Color Page
     ColorEntry *background, *text, *graticule;
     ColorEntry *markerBorder, *markerBackground, *markerText;
@@ -71,6 +73,7 @@ private:
     // Sweep Settings
     NumericEntry *sweepDelay;
     NumericEntry *realTimeSweepTime;
+    CheckBoxEntry *fastAmpConversion;
     // Playback Settings
     NumericEntry *playbackDelay;
     NumericEntry *maxSaveFileSize;
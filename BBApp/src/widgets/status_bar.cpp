@@ -7,6 +7,11 @@ BBStatusBar::BBStatusBar(QWidget *parent) :
     insertWidget(0, tempLabel, 2);
     tempLabel->setText("");
 
+    pipelineStats = new Label();
+    pipelineStats->setAlignment(Qt::AlignRight);
+    pipelineStats->setText("");
+    addPermanentWidget(pipelineStats, 0);
+
     cursorLoc = new Label();
     cursorLoc->setMinimumWidth(200);
     cursorLoc->setAlignment(Qt::AlignRight);
@@ -16,7 +16,11 @@ public:
     void SetCursorPos(const QString &locStr) { cursorLoc->setText(locStr); }
     void SetDeviceType(const QString &text) { deviceType->setText(text); }
     void UpdateDeviceInfo(const QString &text) { deviceInfo->setText(text); }
+
+public slots:
     void SetDiagnostics(const QString &text) { diagnostics->setText(text); }
+    // Queue depth and drop counts of the active view
+    void SetPipelineStats(const QString &text) { pipelineStats->setText(text); }
 
 private:
     Label *cursorLoc;
@@ -24,6 +28,7 @@ private:
     Label *deviceType; // What device is connected
     Label *deviceInfo; // SN and FW of device
     Label *diagnostics; // Operating diagnostics
+    Label *pipelineStats; // Acquisition queue health
 };
 
 #endif // STATUS_BAR_H